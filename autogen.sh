@@ -4,7 +4,7 @@ srcdir=`dirname $0`
 test -z "$srcdir" && srcdir=.
 
 mkdir -p m4
-aclocal #-I m4 
+aclocal -I m4
 autoheader 
 libtoolize --force --copy
 autoconf 
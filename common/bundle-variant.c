@@ -0,0 +1,484 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "bundle-variant.h"
+#include "features.h"
+#include "log.h"
+
+#include <gio/gio.h>
+#include <stdlib.h> /* free */
+
+static GVariant *
+_variant_map_get_packed (GVariant *v_data, const gchar *key)
+{
+    if (g_variant_n_children (v_data) != 1) return NULL;
+
+    return g_variant_lookup_value (v_data, key, G_VARIANT_TYPE_BYTESTRING);
+}
+
+static GVariant *
+_variant_map_get_encoded (GVariant *v_data)
+{
+    return _variant_map_get_packed (v_data, MSGPORT_ENCODED_BUNDLE_KEY);
+}
+
+/*
+ * Bundle values map to:
+ *   BUNDLE_TYPE_STR        - s
+ *   BUNDLE_TYPE_BYTE       - ay
+ *   BUNDLE_TYPE_STR_ARRAY  - as
+ *   BUNDLE_TYPE_BYTE_ARRAY - aay
+ * Byte arrays are copied as a whole, not element by element.
+ */
+static void
+_bundle_iter_cb (const char *key, const int type, const bundle_keyval_t *kv, void *user_data)
+{
+    GVariantBuilder *builder = (GVariantBuilder *)user_data;
+    GVariant *value = NULL;
+    void *val = NULL;
+    void **array = NULL;
+    size_t size = 0;
+    size_t *sizes = NULL;
+    unsigned int i, len = 0;
+
+    switch (bundle_keyval_get_type ((bundle_keyval_t*)kv)) {
+        case BUNDLE_TYPE_STR:
+            bundle_keyval_get_basic_val ((bundle_keyval_t*)kv, &val, &size);
+            value = g_variant_new_string ((const gchar *)val);
+            break;
+        case BUNDLE_TYPE_BYTE:
+            bundle_keyval_get_basic_val ((bundle_keyval_t*)kv, &val, &size);
+            value = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, val, size, 1);
+            break;
+        case BUNDLE_TYPE_STR_ARRAY: {
+            GVariantBuilder items;
+
+            /* unset elements are NULL, which g_variant_new_strv rejects */
+            bundle_keyval_get_array_val ((bundle_keyval_t*)kv, &array, &len, &sizes);
+            g_variant_builder_init (&items, G_VARIANT_TYPE_STRING_ARRAY);
+            for (i = 0; i < len; i++)
+                g_variant_builder_add (&items, "s", array[i] ? (const gchar *)array[i] : "");
+            value = g_variant_builder_end (&items);
+            break;
+        }
+        case BUNDLE_TYPE_BYTE_ARRAY: {
+            GVariantBuilder items;
+
+            bundle_keyval_get_array_val ((bundle_keyval_t*)kv, &array, &len, &sizes);
+            g_variant_builder_init (&items, G_VARIANT_TYPE ("aay"));
+            for (i = 0; i < len; i++)
+                g_variant_builder_add_value (&items,
+                        g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, array[i], sizes[i], 1));
+            value = g_variant_builder_end (&items);
+            break;
+        }
+        default:
+            WARN ("Ignoring value of '%s' with unsupported type %d", key, type);
+            return;
+    }
+
+    g_variant_builder_add (builder, "{sv}", key, value);
+}
+
+GVariant * bundle_to_variant_map (bundle *b)
+{
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+    bundle_foreach (b, _bundle_iter_cb, &builder);
+
+    return g_variant_builder_end (&builder);
+}
+
+static void
+_bundle_add_variant (bundle *b, const gchar *key, GVariant *value)
+{
+    gsize i, len = 0;
+
+    if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)) {
+        bundle_add (b, key, g_variant_get_string (value, NULL));
+    }
+    else if (g_variant_is_of_type (value, G_VARIANT_TYPE_BYTESTRING)) {
+        gconstpointer data = g_variant_get_fixed_array (value, &len, 1);
+        bundle_add_byte (b, key, data, len);
+    }
+    else if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING_ARRAY)) {
+        const gchar **strv = g_variant_get_strv (value, &len);
+        bundle_add_str_array (b, key, strv, (int)len);
+        g_free (strv);
+    }
+    else if (g_variant_is_of_type (value, G_VARIANT_TYPE_BYTESTRING_ARRAY)) {
+        len = g_variant_n_children (value);
+        bundle_add_byte_array (b, key, NULL, (unsigned int)len);
+        for (i = 0; i < len; i++) {
+            GVariant *item = g_variant_get_child_value (value, i);
+            gsize size = 0;
+            gconstpointer data = g_variant_get_fixed_array (item, &size, 1);
+
+            bundle_set_byte_array_element (b, key, (unsigned int)i, data, size);
+            g_variant_unref (item);
+        }
+    }
+    else if (g_variant_type_is_basic (g_variant_get_type (value))) {
+        /* numbers and booleans from other bindings, bundle has no such types */
+        gchar *str = g_variant_print (value, FALSE);
+        bundle_add (b, key, str);
+        g_free (str);
+    }
+    else {
+        WARN ("Ignoring value of '%s' with unsupported type '%s'", key, g_variant_get_type_string (value));
+    }
+}
+
+bundle * bundle_from_variant_map (GVariant *v_data)
+{
+    bundle *b = NULL;
+    GVariantIter iter;
+    gchar *key = NULL;
+    GVariant *value  = NULL;
+    GVariant *encoded = NULL;
+
+    if (!v_data) return b;
+
+    encoded = _variant_map_get_encoded (v_data);
+    if (encoded) {
+        gsize size = 0;
+        gconstpointer raw = g_variant_get_fixed_array (encoded, &size, 1);
+
+        b = bundle_decode_raw ((const bundle_raw *)raw, (int)size);
+        g_variant_unref (encoded);
+        if (b) return b;
+
+        WARN ("Failed to decode bundle of %lu bytes", (gulong)size);
+        return bundle_create ();
+    }
+
+    g_variant_iter_init (&iter, v_data);
+
+    b = bundle_create ();
+
+    while (g_variant_iter_next (&iter, "{sv}", &key, &value)) {
+        _bundle_add_variant (b, key, value);
+        g_free (key);
+        g_variant_unref (value);
+    }
+
+    return b;
+}
+
+/*
+ * The whole bundle as one opaque byte array, instead of boxing each value:
+ * { MSGPORT_ENCODED_BUNDLE_KEY: <ay> }. Only for peers that negotiated
+ * MSGPORT_FEATURE_ENCODED_BUNDLE.
+ */
+GVariant * bundle_to_encoded_variant_map (bundle *b)
+{
+    GVariantBuilder builder;
+    bundle_raw *raw = NULL;
+    int size = 0;
+
+    if (bundle_encode_raw (b, &raw, &size) != 0 || !raw) {
+        WARN ("Failed to encode bundle, sending it as a map");
+        return bundle_to_variant_map (b);
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", MSGPORT_ENCODED_BUNDLE_KEY,
+            g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING, raw, size, TRUE, free, raw));
+
+    return g_variant_builder_end (&builder);
+}
+
+gboolean msgport_variant_map_is_encoded (GVariant *v_data)
+{
+    GVariant *encoded = _variant_map_get_encoded (v_data);
+
+    if (!encoded) return FALSE;
+
+    g_variant_unref (encoded);
+    return TRUE;
+}
+
+/*
+ * Returns v_data rewritten to use only the given features, i.e, inflated,
+ * expanded from its schema and/or decoded for peers that did not negotiate
+ * those, or NULL if v_data already fits. Maps are packed in the order
+ * encoded or schema, then compressed, and are unpacked the other way round.
+ */
+GVariant * msgport_variant_map_unpack (GVariant *v_data, guint features, MsgPortSchemaLookupFunc lookup, gpointer userdata)
+{
+    bundle *b = NULL;
+    GVariant *inner = NULL;
+    GVariant *plain = NULL;
+    guint schema_id = 0;
+    const gchar * const *keys = NULL;
+
+    if ((features & MSGPORT_FEATURES_PACKING) == MSGPORT_FEATURES_PACKING) return NULL;
+
+    if ((inner = msgport_variant_map_decompress (v_data)) != NULL) {
+        plain = msgport_variant_map_unpack (inner, features, lookup, userdata);
+        if (plain) {
+            g_variant_unref (inner);
+            return plain;
+        }
+        if (!(features & MSGPORT_FEATURE_COMPRESSED_BUNDLE)) return inner;
+
+        /* the inner map fits, keep it compressed */
+        g_variant_unref (inner);
+        return NULL;
+    }
+
+    if (msgport_variant_map_get_schema_id (v_data, &schema_id)) {
+        if (features & MSGPORT_FEATURE_SCHEMA_BUNDLE) return NULL;
+
+        keys = lookup ? lookup (schema_id, userdata) : NULL;
+        if (!keys) {
+            WARN ("Unknown schema %u, message can not be expanded", schema_id);
+            return NULL;
+        }
+
+        /* schema values are never encoded */
+        return msgport_variant_map_from_schema (v_data, keys);
+    }
+
+    if ((features & MSGPORT_FEATURE_ENCODED_BUNDLE) || !msgport_variant_map_is_encoded (v_data))
+        return NULL;
+
+    b = bundle_from_variant_map (v_data);
+    plain = g_variant_ref_sink (bundle_to_variant_map (b));
+    bundle_free (b);
+
+    return plain;
+}
+
+/*
+ * Runs all of in through converter, failing if the output grows beyond max_size.
+ */
+static GBytes *
+_convert (GConverter *converter, const guint8 *in, gsize in_size, gsize max_size)
+{
+    GByteArray *out = g_byte_array_new ();
+    GConverterResult res;
+    GError *error = NULL;
+    guint8 buf[4096];
+    gsize n_read = 0, n_written = 0;
+
+    do {
+        res = g_converter_convert (converter, in, in_size, buf, sizeof (buf),
+                G_CONVERTER_INPUT_AT_END, &n_read, &n_written, &error);
+        if (res == G_CONVERTER_ERROR) {
+            WARN ("Failed to convert message data : %s", error->message);
+            g_error_free (error);
+            g_byte_array_unref (out);
+            return NULL;
+        }
+
+        in += n_read;
+        in_size -= n_read;
+        g_byte_array_append (out, buf, n_written);
+
+        if (out->len > max_size) {
+            DBG ("Converted message data exceeds %lu bytes", (gulong)max_size);
+            g_byte_array_unref (out);
+            return NULL;
+        }
+    } while (res != G_CONVERTER_FINISHED);
+
+    return g_byte_array_free_to_bytes (out);
+}
+
+gboolean msgport_variant_map_is_compressed (GVariant *v_data)
+{
+    GVariant *compressed = _variant_map_get_packed (v_data, MSGPORT_COMPRESSED_BUNDLE_KEY);
+
+    if (!compressed) return FALSE;
+
+    g_variant_unref (compressed);
+    return TRUE;
+}
+
+/*
+ * The serialized map, zlib compressed: { MSGPORT_COMPRESSED_BUNDLE_KEY: <ay> }.
+ * Only for peers that negotiated MSGPORT_FEATURE_COMPRESSED_BUNDLE.
+ * Returns NULL if compressing does not make v_data any smaller.
+ */
+GVariant * msgport_variant_map_compress (GVariant *v_data)
+{
+    GVariantBuilder builder;
+    GConverter *compressor = NULL;
+    GBytes *bytes = NULL;
+    gsize size = g_variant_get_size (v_data);
+
+    compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1));
+    bytes = _convert (compressor, g_variant_get_data (v_data), size, size);
+    g_object_unref (compressor);
+
+    if (!bytes) return NULL;
+
+    DBG ("Compressed message of %lu bytes to %lu bytes", (gulong)size, (gulong)g_bytes_get_size (bytes));
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", MSGPORT_COMPRESSED_BUNDLE_KEY,
+            g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING, bytes, TRUE));
+    g_bytes_unref (bytes);
+
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/*
+ * Returns the inflated map, or NULL if v_data is not compressed or corrupted.
+ */
+GVariant * msgport_variant_map_decompress (GVariant *v_data)
+{
+    GVariant *compressed = _variant_map_get_packed (v_data, MSGPORT_COMPRESSED_BUNDLE_KEY);
+    GConverter *decompressor = NULL;
+    GBytes *bytes = NULL;
+    GVariant *map = NULL;
+    gsize size = 0;
+    gconstpointer data = NULL;
+
+    if (!compressed) return NULL;
+
+    data = g_variant_get_fixed_array (compressed, &size, 1);
+    decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB));
+    bytes = _convert (decompressor, data, size, MSGPORT_COMPRESSED_MAX_SIZE);
+    g_object_unref (decompressor);
+    g_variant_unref (compressed);
+
+    if (!bytes) {
+        WARN ("Compressed message of %lu bytes could not be inflated", (gulong)size);
+        return NULL;
+    }
+
+    /* comes from the peer, so not trusted to be in normal form */
+    map = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE_VARDICT, bytes, FALSE));
+    g_bytes_unref (bytes);
+
+    return map;
+}
+
+/*
+ * Keys of a schema must be unique, and there must be at least one.
+ */
+gboolean msgport_schema_keys_are_valid (const gchar * const *keys)
+{
+    guint i, j, n_keys = keys ? g_strv_length ((gchar **)keys) : 0;
+
+    if (!n_keys || n_keys > MSGPORT_SCHEMA_MAX_KEYS) return FALSE;
+
+    for (i = 0; i < n_keys; i++)
+        for (j = i + 1; j < n_keys; j++)
+            if (g_strcmp0 (keys[i], keys[j]) == 0) return FALSE;
+
+    return TRUE;
+}
+
+/*
+ * Only the values, in the order of the schema keys:
+ * { MSGPORT_SCHEMA_BUNDLE_KEY: <(u schema_id, av values)> }.
+ * Only for peers that negotiated MSGPORT_FEATURE_SCHEMA_BUNDLE.
+ * Returns NULL if the keys of v_data are not exactly the ones of the schema.
+ */
+GVariant * msgport_variant_map_to_schema (GVariant *v_data, guint schema_id, const gchar * const *keys)
+{
+    GVariantBuilder builder;
+    GVariantBuilder values;
+    GVariant *value = NULL;
+    guint n_keys = g_strv_length ((gchar **)keys);
+
+    if (g_variant_n_children (v_data) != n_keys) return NULL;
+
+    g_variant_builder_init (&values, G_VARIANT_TYPE ("av"));
+    for (; *keys; keys++) {
+        if (!(value = g_variant_lookup_value (v_data, *keys, NULL))) {
+            g_variant_builder_clear (&values);
+            return NULL;
+        }
+        g_variant_builder_add (&values, "v", value);
+        g_variant_unref (value);
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", MSGPORT_SCHEMA_BUNDLE_KEY,
+            g_variant_new ("(uav)", schema_id, &values));
+
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static GVariant *
+_variant_map_get_schema_values (GVariant *v_data)
+{
+    if (g_variant_n_children (v_data) != 1) return NULL;
+
+    return g_variant_lookup_value (v_data, MSGPORT_SCHEMA_BUNDLE_KEY, G_VARIANT_TYPE ("(uav)"));
+}
+
+gboolean msgport_variant_map_get_schema_id (GVariant *v_data, guint *schema_id)
+{
+    GVariant *packed = _variant_map_get_schema_values (v_data);
+
+    if (!packed) return FALSE;
+
+    if (schema_id) g_variant_get_child (packed, 0, "u", schema_id);
+    g_variant_unref (packed);
+
+    return TRUE;
+}
+
+/*
+ * Returns the plain map for the schema values in v_data, or NULL if
+ * v_data does not hold a value for each of the keys.
+ */
+GVariant * msgport_variant_map_from_schema (GVariant *v_data, const gchar * const *keys)
+{
+    GVariantBuilder builder;
+    GVariant *packed = _variant_map_get_schema_values (v_data);
+    GVariant *values = NULL;
+    GVariant *value = NULL;
+    gsize i, n_values;
+
+    if (!packed) return NULL;
+
+    values = g_variant_get_child_value (packed, 1);
+    n_values = g_variant_n_children (values);
+    g_variant_unref (packed);
+
+    if (n_values != g_strv_length ((gchar **)keys)) {
+        WARN ("Message has %lu values for a schema of %u keys", (gulong)n_values, g_strv_length ((gchar **)keys));
+        g_variant_unref (values);
+        return NULL;
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    for (i = 0; i < n_values; i++) {
+        g_variant_get_child (values, i, "v", &value);
+        g_variant_builder_add (&builder, "{sv}", keys[i], value);
+        g_variant_unref (value);
+    }
+    g_variant_unref (values);
+
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
@@ -0,0 +1,70 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MSGPORT_BUNDLE_VARIANT_H
+#define __MSGPORT_BUNDLE_VARIANT_H
+
+#include <bundle.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* keys of the schema, or NULL if schema_id is not known */
+typedef const gchar * const * (*MsgPortSchemaLookupFunc) (guint schema_id, gpointer userdata);
+
+/* the only key of a message map holding an encoded bundle */
+#define MSGPORT_ENCODED_BUNDLE_KEY "__MESSAGEPORT_ENCODED_BUNDLE__"
+
+/* the only key of a message map holding another, zlib compressed, map */
+#define MSGPORT_COMPRESSED_BUNDLE_KEY "__MESSAGEPORT_COMPRESSED_BUNDLE__"
+
+/* the only key of a message map holding a schema id and the values in the schema order */
+#define MSGPORT_SCHEMA_BUNDLE_KEY "__MESSAGEPORT_SCHEMA_BUNDLE__"
+
+/* most keys a schema can have */
+#define MSGPORT_SCHEMA_MAX_KEYS 256
+
+/* compressed maps are not inflated beyond this */
+#define MSGPORT_COMPRESSED_MAX_SIZE (32 * 1024 * 1024)
+
+GVariant *bundle_to_variant_map (bundle *b);
+GVariant *bundle_to_encoded_variant_map (bundle *b);
+bundle   *bundle_from_variant_map (GVariant *v);
+
+gboolean  msgport_variant_map_is_encoded (GVariant *v);
+GVariant *msgport_variant_map_unpack (GVariant *v, guint features, MsgPortSchemaLookupFunc lookup, gpointer userdata);
+
+gboolean  msgport_variant_map_is_compressed (GVariant *v);
+GVariant *msgport_variant_map_compress (GVariant *v);
+GVariant *msgport_variant_map_decompress (GVariant *v);
+
+gboolean  msgport_schema_keys_are_valid (const gchar * const *keys);
+GVariant *msgport_variant_map_to_schema (GVariant *v, guint schema_id, const gchar * const *keys);
+gboolean  msgport_variant_map_get_schema_id (GVariant *v, guint *schema_id);
+GVariant *msgport_variant_map_from_schema (GVariant *v, const gchar * const *keys);
+
+G_END_DECLS
+
+#endif /* __MSGPORT_BUNDLE_VARIANT_H */
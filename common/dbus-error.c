@@ -37,7 +37,8 @@ GDBusErrorEntry __msgport_errors [] = {
     {MSGPORT_ERROR_NOT_FOUND,            _PREFIX".NotFound"},
     {MSGPORT_ERROR_ALREADY_EXISTING,     _PREFIX".AlreadyExisting"},
     {MSGPORT_ERROR_CERTIFICATE_MISMATCH, _PREFIX".CertificateMismatch"},
-    {MSGPORT_ERROR_UNKNOWN,              _PREFIX".Unknown"}
+    {MSGPORT_ERROR_UNKNOWN,              _PREFIX".Unknown"},
+    {MSGPORT_ERROR_DELTA_BASE_NOT_FOUND, _PREFIX".DeltaBaseNotFound"}
 };
 
 GQuark
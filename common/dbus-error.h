@@ -40,7 +40,8 @@ typedef enum _MsgPortError
     MSGPORT_ERROR_NOT_FOUND,
     MSGPORT_ERROR_ALREADY_EXISTING,
     MSGPORT_ERROR_CERTIFICATE_MISMATCH,
-    MSGPORT_ERROR_UNKNOWN
+    MSGPORT_ERROR_UNKNOWN,
+    MSGPORT_ERROR_DELTA_BASE_NOT_FOUND
 
 } MsgPortError;
 
@@ -66,6 +67,9 @@ msgport_error_quark ();
 #define msgport_error_certificate_mismatch_new() \
     msgport_error_new (MSGPORT_ERROR_CERTIFICATE_MISMATCH, "cerficates not matched")
 
+#define msgport_error_delta_base_not_found_new() \
+    msgport_error_new (MSGPORT_ERROR_DELTA_BASE_NOT_FOUND, "base of the delta not found")
+
 #define msgport_error_unknown_new() \
     msgport_error_new (MSGPORT_ERROR_UNKNOWN, "unknown")
 
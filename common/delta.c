@@ -0,0 +1,375 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "delta.h"
+#include "log.h"
+
+#define MSGPORT_DELTA_TYPE "(tuua{sv}as)"
+
+struct _MsgPortDeltaSource
+{
+    guint64   stream;   /* random, tells the senders apart on the receiver */
+    guint32   seq;      /* of the last message sent, never 0 */
+    guint     n_deltas; /* sent since the last key frame */
+    GVariant *last;     /* last message sent, NULL to send a key frame */
+};
+
+typedef struct {
+    guint32   seq;
+    GVariant *map; /* NULL if only the sequence is tracked */
+    gint64    last_used;
+} MsgPortDeltaBase;
+
+struct _MsgPortDeltaTable
+{
+    GHashTable *bases; /* {gchar *"sender/stream": MsgPortDeltaBase *} */
+};
+
+static GVariant *
+_variant_map_get_delta (GVariant *v_data)
+{
+    if (g_variant_n_children (v_data) != 1) return NULL;
+
+    return g_variant_lookup_value (v_data, MSGPORT_DELTA_BUNDLE_KEY, G_VARIANT_TYPE (MSGPORT_DELTA_TYPE));
+}
+
+gboolean
+msgport_variant_map_is_delta (GVariant *v_data)
+{
+    GVariant *delta = _variant_map_get_delta (v_data);
+
+    if (!delta) return FALSE;
+
+    g_variant_unref (delta);
+    return TRUE;
+}
+
+MsgPortDeltaSource *
+msgport_delta_source_new (void)
+{
+    MsgPortDeltaSource *source = g_slice_new0 (MsgPortDeltaSource);
+
+    source->stream = ((guint64)g_random_int () << 32) | g_random_int ();
+
+    return source;
+}
+
+void
+msgport_delta_source_free (MsgPortDeltaSource *source)
+{
+    if (!source) return;
+
+    if (source->last) g_variant_unref (source->last);
+    g_slice_free (MsgPortDeltaSource, source);
+}
+
+/*
+ * Next message goes as a key frame, say if the last one might not have
+ * reached the receiver.
+ */
+void
+msgport_delta_source_reset (MsgPortDeltaSource *source)
+{
+    g_return_if_fail (source);
+
+    if (source->last) {
+        g_variant_unref (source->last);
+        source->last = NULL;
+    }
+}
+
+/*
+ * Returns a new reference to the delta of map to the last message,
+ * or a key frame holding map as a whole.
+ */
+GVariant *
+msgport_delta_source_encode (MsgPortDeltaSource *source, GVariant *map, gboolean key_frame)
+{
+    GVariantBuilder builder;
+    GVariantBuilder changed;
+    GVariantBuilder removed;
+    GVariantIter iter;
+    GVariant *delta = NULL;
+    GVariant *value = NULL;
+    GVariant *old_value = NULL;
+    gchar *key = NULL;
+    guint32 base_seq;
+
+    g_return_val_if_fail (source && map, NULL);
+
+    base_seq = source->seq;
+
+    g_variant_builder_init (&changed, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_init (&removed, G_VARIANT_TYPE_STRING_ARRAY);
+
+    if (key_frame || !source->last || source->n_deltas >= MSGPORT_DELTA_KEYFRAME_INTERVAL) {
+        base_seq = 0;
+        source->n_deltas = 0;
+
+        g_variant_iter_init (&iter, map);
+        while (g_variant_iter_next (&iter, "{sv}", &key, &value)) {
+            g_variant_builder_add (&changed, "{sv}", key, value);
+            g_free (key);
+            g_variant_unref (value);
+        }
+    }
+    else {
+        source->n_deltas++;
+
+        g_variant_iter_init (&iter, map);
+        while (g_variant_iter_next (&iter, "{sv}", &key, &value)) {
+            old_value = g_variant_lookup_value (source->last, key, NULL);
+            if (!old_value || !g_variant_equal (old_value, value))
+                g_variant_builder_add (&changed, "{sv}", key, value);
+            if (old_value) g_variant_unref (old_value);
+            g_free (key);
+            g_variant_unref (value);
+        }
+
+        g_variant_iter_init (&iter, source->last);
+        while (g_variant_iter_next (&iter, "{sv}", &key, &value)) {
+            GVariant *new_value = g_variant_lookup_value (map, key, NULL);
+
+            if (!new_value) g_variant_builder_add (&removed, "s", key);
+            else g_variant_unref (new_value);
+            g_free (key);
+            g_variant_unref (value);
+        }
+    }
+
+    if (++source->seq == 0) source->seq = 1;
+
+    if (source->last) g_variant_unref (source->last);
+    source->last = g_variant_ref (map);
+
+    delta = g_variant_new ("(tuu@a{sv}@as)", source->stream, source->seq, base_seq,
+            g_variant_builder_end (&changed), g_variant_builder_end (&removed));
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", MSGPORT_DELTA_BUNDLE_KEY, delta);
+
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static void
+_delta_base_free (MsgPortDeltaBase *base)
+{
+    if (base->map) g_variant_unref (base->map);
+    g_slice_free (MsgPortDeltaBase, base);
+}
+
+MsgPortDeltaTable *
+msgport_delta_table_new (void)
+{
+    MsgPortDeltaTable *table = g_slice_new0 (MsgPortDeltaTable);
+
+    table->bases = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify)_delta_base_free);
+
+    return table;
+}
+
+void
+msgport_delta_table_free (MsgPortDeltaTable *table)
+{
+    if (!table) return;
+
+    g_hash_table_unref (table->bases);
+    g_slice_free (MsgPortDeltaTable, table);
+}
+
+static gboolean
+_strv_has (const gchar **strv, const gchar *str)
+{
+    for (; strv && *strv; strv++)
+        if (g_strcmp0 (*strv, str) == 0) return TRUE;
+
+    return FALSE;
+}
+
+static GVariant *
+_patch (GVariant *base, GVariant *changed, GVariant *removed)
+{
+    GVariantBuilder builder;
+    GVariantIter iter;
+    GVariant *value = NULL;
+    GVariant *new_value = NULL;
+    gchar *key = NULL;
+    const gchar **removed_keys = g_variant_get_strv (removed, NULL);
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+    /* unchanged values first, the changed ones replace the rest */
+    g_variant_iter_init (&iter, base);
+    while (g_variant_iter_next (&iter, "{sv}", &key, &value)) {
+        new_value = g_variant_lookup_value (changed, key, NULL);
+        if (!new_value && !_strv_has (removed_keys, key))
+            g_variant_builder_add (&builder, "{sv}", key, value);
+        if (new_value) g_variant_unref (new_value);
+        g_free (key);
+        g_variant_unref (value);
+    }
+    g_free (removed_keys);
+
+    g_variant_iter_init (&iter, changed);
+    while (g_variant_iter_next (&iter, "{sv}", &key, &value)) {
+        g_variant_builder_add (&builder, "{sv}", key, value);
+        g_free (key);
+        g_variant_unref (value);
+    }
+
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static void
+_evict_least_recently_used (MsgPortDeltaTable *table)
+{
+    GHashTableIter iter;
+    gpointer key = NULL, oldest_key = NULL;
+    MsgPortDeltaBase *base = NULL;
+    gint64 oldest = G_MAXINT64;
+
+    g_hash_table_iter_init (&iter, table->bases);
+    while (g_hash_table_iter_next (&iter, &key, (gpointer *)&base)) {
+        if (base->last_used < oldest) {
+            oldest = base->last_used;
+            oldest_key = key;
+        }
+    }
+
+    if (oldest_key) g_hash_table_remove (table->bases, oldest_key);
+}
+
+/*
+ * Streams are told apart by the sender too, so that one sender can not
+ * patch the bases of another by reusing its stream.
+ */
+static gchar *
+_delta_key (const gchar *sender, guint64 stream)
+{
+    return g_strdup_printf ("%s/%016" G_GINT64_MODIFIER "x", sender ? sender : "", stream);
+}
+
+/*
+ * Base to keep the message seq of stream in, takes key.
+ */
+static MsgPortDeltaBase *
+_delta_table_update (MsgPortDeltaTable *table, gchar *key, MsgPortDeltaBase *base, guint32 seq)
+{
+    if (!base) {
+        if (g_hash_table_size (table->bases) >= MSGPORT_DELTA_MAX_STREAMS)
+            _evict_least_recently_used (table);
+
+        base = g_slice_new0 (MsgPortDeltaBase);
+        g_hash_table_insert (table->bases, key, base);
+    }
+    else g_free (key);
+
+    base->seq = seq;
+    base->last_used = g_get_monotonic_time ();
+
+    return base;
+}
+
+/*
+ * Returns a new reference to the whole message for the delta in v_data
+ * from sender, or NULL if the base message of the delta is not known,
+ * in which case the stream recovers with the next key frame.
+ */
+GVariant *
+msgport_delta_table_apply (MsgPortDeltaTable *table, const gchar *sender, GVariant *v_data)
+{
+    GVariant *delta = _variant_map_get_delta (v_data);
+    GVariant *changed = NULL;
+    GVariant *removed = NULL;
+    GVariant *full = NULL;
+    MsgPortDeltaBase *base = NULL;
+    guint64 stream = 0;
+    guint32 seq = 0, base_seq = 0;
+    gchar *key = NULL;
+
+    g_return_val_if_fail (table, NULL);
+
+    if (!delta) return NULL;
+
+    g_variant_get (delta, "(tuu@a{sv}@as)", &stream, &seq, &base_seq, &changed, &removed);
+    g_variant_unref (delta);
+
+    key = _delta_key (sender, stream);
+    base = g_hash_table_lookup (table->bases, key);
+
+    if (!base_seq) full = g_variant_ref (changed);
+    else if (base && base->map && base->seq == base_seq) full = _patch (base->map, changed, removed);
+    else {
+        WARN ("Base %u of delta %u not known for stream %s, waiting for a key frame", base_seq, seq, key);
+        g_free (key);
+        goto out;
+    }
+
+    base = _delta_table_update (table, key, base, seq);
+    if (base->map) g_variant_unref (base->map);
+    base->map = g_variant_ref (full);
+
+out:
+    g_variant_unref (changed);
+    g_variant_unref (removed);
+
+    return full;
+}
+
+/*
+ * Follows the sequence of the stream of the delta in v_data from sender
+ * without keeping the messages, for the daemon to tell whether a receiver
+ * that patches the deltas itself has the base. Returns FALSE if it has not.
+ */
+gboolean
+msgport_delta_table_track (MsgPortDeltaTable *table, const gchar *sender, GVariant *v_data)
+{
+    GVariant *delta = _variant_map_get_delta (v_data);
+    MsgPortDeltaBase *base = NULL;
+    guint64 stream = 0;
+    guint32 seq = 0, base_seq = 0;
+    gchar *key = NULL;
+
+    g_return_val_if_fail (table, FALSE);
+
+    if (!delta) return TRUE;
+
+    g_variant_get (delta, "(tuu@a{sv}@as)", &stream, &seq, &base_seq, NULL, NULL);
+    g_variant_unref (delta);
+
+    key = _delta_key (sender, stream);
+    base = g_hash_table_lookup (table->bases, key);
+
+    if (base_seq && (!base || base->seq != base_seq)) {
+        DBG ("Receiver has no base %u of delta %u for stream %s", base_seq, seq, key);
+        g_free (key);
+        return FALSE;
+    }
+
+    _delta_table_update (table, key, base, seq);
+
+    return TRUE;
+}
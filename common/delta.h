@@ -0,0 +1,82 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MSGPORT_DELTA_H
+#define __MSGPORT_DELTA_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * the only key of a message map holding a delta to an earlier message:
+ * <(t stream, u seq, u base_seq, a{sv} changed, as removed)>, base_seq is 0
+ * for key frames, which hold the whole message in changed.
+ */
+#define MSGPORT_DELTA_BUNDLE_KEY "__MESSAGEPORT_DELTA_BUNDLE__"
+
+/* a key frame is sent at least every that many messages */
+#define MSGPORT_DELTA_KEYFRAME_INTERVAL 32
+
+/* most streams a receiver keeps the base message of */
+#define MSGPORT_DELTA_MAX_STREAMS 64
+
+typedef struct _MsgPortDeltaSource MsgPortDeltaSource;
+typedef struct _MsgPortDeltaTable MsgPortDeltaTable;
+
+gboolean
+msgport_variant_map_is_delta (GVariant *v);
+
+/* sender side, one per stream of messages */
+
+MsgPortDeltaSource *
+msgport_delta_source_new (void);
+
+void
+msgport_delta_source_free (MsgPortDeltaSource *source);
+
+GVariant *
+msgport_delta_source_encode (MsgPortDeltaSource *source, GVariant *map, gboolean key_frame);
+
+void
+msgport_delta_source_reset (MsgPortDeltaSource *source);
+
+/* receiver side, the base messages of the streams */
+
+MsgPortDeltaTable *
+msgport_delta_table_new (void);
+
+void
+msgport_delta_table_free (MsgPortDeltaTable *table);
+
+GVariant *
+msgport_delta_table_apply (MsgPortDeltaTable *table, const gchar *sender, GVariant *v);
+
+gboolean
+msgport_delta_table_track (MsgPortDeltaTable *table, const gchar *sender, GVariant *v);
+
+G_END_DECLS
+
+#endif /* __MSGPORT_DELTA_H */
@@ -0,0 +1,68 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "features.h"
+
+static const struct {
+    MsgPortFeatures  feature;
+    const gchar     *name;
+} _features[] = {
+    { MSGPORT_FEATURE_ENCODED_BUNDLE,    "encoded-bundle" },
+    { MSGPORT_FEATURE_COMPRESSED_BUNDLE, "compressed-bundle" },
+    { MSGPORT_FEATURE_SCHEMA_BUNDLE,     "schema-bundle" },
+    { MSGPORT_FEATURE_DELTA_BUNDLE,      "delta-bundle" },
+    { MSGPORT_FEATURE_LARGE_MESSAGE,     "large-message" },
+    { MSGPORT_FEATURE_BATCH,             "batch" },
+    { MSGPORT_FEATURE_FDS,               "fds" },
+};
+
+/*
+ * Unknown names are ignored, they come from newer peers.
+ */
+guint
+msgport_features_from_strv (const gchar * const *names)
+{
+    guint features = MSGPORT_FEATURE_NONE;
+    guint i;
+
+    for (; names && *names; names++)
+        for (i = 0; i < G_N_ELEMENTS (_features); i++)
+            if (g_strcmp0 (*names, _features[i].name) == 0) features |= _features[i].feature;
+
+    return features;
+}
+
+gchar **
+msgport_features_to_strv (guint features)
+{
+    GPtrArray *names = g_ptr_array_new ();
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (_features); i++)
+        if (features & _features[i].feature) g_ptr_array_add (names, g_strdup (_features[i].name));
+    g_ptr_array_add (names, NULL);
+
+    return (gchar **)g_ptr_array_free (names, FALSE);
+}
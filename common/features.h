@@ -0,0 +1,63 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MSGPORT_FEATURES_H
+#define __MSGPORT_FEATURES_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Optional parts of the protocol, agreed on per connection with
+ * negotiateFeatures. A client that never negotiates gets none of them.
+ */
+typedef enum {
+    MSGPORT_FEATURE_NONE           = 0,
+    MSGPORT_FEATURE_ENCODED_BUNDLE    = 1 << 0, /* message data may be a bundle_encode_raw() blob */
+    MSGPORT_FEATURE_COMPRESSED_BUNDLE = 1 << 1, /* message data may be a zlib compressed map */
+    MSGPORT_FEATURE_SCHEMA_BUNDLE     = 1 << 2, /* message data may be values of a registered schema */
+    MSGPORT_FEATURE_DELTA_BUNDLE      = 1 << 3, /* message data may be a delta to the previous message */
+    MSGPORT_FEATURE_LARGE_MESSAGE     = 1 << 4, /* message data may come in a memfd with onLargeMessage */
+    MSGPORT_FEATURE_BATCH             = 1 << 5, /* messages may come many at once with onMessages */
+    MSGPORT_FEATURE_FDS               = 1 << 6, /* messages may carry file descriptors with onMessageWithFds */
+} MsgPortFeatures;
+
+/* every way message data may be packed */
+#define MSGPORT_FEATURES_PACKING   (MSGPORT_FEATURE_ENCODED_BUNDLE | MSGPORT_FEATURE_COMPRESSED_BUNDLE | \
+                                    MSGPORT_FEATURE_SCHEMA_BUNDLE | MSGPORT_FEATURE_DELTA_BUNDLE)
+
+#define MSGPORT_FEATURES_SUPPORTED (MSGPORT_FEATURES_PACKING | MSGPORT_FEATURE_LARGE_MESSAGE | \
+                                    MSGPORT_FEATURE_BATCH | MSGPORT_FEATURE_FDS)
+
+guint
+msgport_features_from_strv (const gchar * const *names);
+
+gchar **
+msgport_features_to_strv (guint features);
+
+G_END_DECLS
+
+#endif /* __MSGPORT_FEATURES_H */
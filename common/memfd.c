@@ -0,0 +1,145 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "config.h" /* HAVE_MEMFD_CREATE */
+
+#include "memfd.h"
+#include "log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_MEMFD_CREATE
+
+#define MSGPORT_MEMFD_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+
+/*
+ * Writes the serialized variant into a sealed memfd, so that the receiver
+ * can map it without being afraid of it changing underneath.
+ * Returns the memfd or -1 if it could not be created.
+ */
+gint
+msgport_variant_to_memfd (GVariant *v)
+{
+    gint fd;
+    gsize size = g_variant_get_size (v);
+    const gchar *data = g_variant_get_data (v);
+
+    fd = memfd_create ("messageport", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        WARN ("Failed to create memfd : %s", strerror (errno));
+        return -1;
+    }
+
+    while (size > 0) {
+        ssize_t n = write (fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            WARN ("Failed to write message to memfd : %s", strerror (errno));
+            close (fd);
+            return -1;
+        }
+        data += n;
+        size -= n;
+    }
+
+    if (fcntl (fd, F_ADD_SEALS, MSGPORT_MEMFD_SEALS) < 0) {
+        WARN ("Failed to seal memfd : %s", strerror (errno));
+        close (fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+typedef struct {
+    gpointer addr;
+    gsize    size;
+} MsgPortMapping;
+
+static void
+_unmap (gpointer data)
+{
+    MsgPortMapping *mapping = (MsgPortMapping *)data;
+
+    munmap (mapping->addr, mapping->size);
+    g_slice_free (MsgPortMapping, mapping);
+}
+
+/*
+ * Maps the sealed memfd sent by the remote application and wraps it in a variant,
+ * the mapping lives as long as the variant. fd is not consumed.
+ */
+GVariant *
+msgport_variant_from_memfd (gint fd, gsize size, const GVariantType *type)
+{
+    struct stat st;
+    MsgPortMapping *mapping = NULL;
+    gpointer addr = NULL;
+    gint seals = fcntl (fd, F_GET_SEALS);
+
+    /* refuse the payloads the sender could still modify */
+    if (seals < 0 || (seals & (F_SEAL_WRITE | F_SEAL_SHRINK)) != (F_SEAL_WRITE | F_SEAL_SHRINK)) {
+        WARN ("Ignoring message in unsealed memfd");
+        return NULL;
+    }
+
+    if (fstat (fd, &st) < 0 || (gsize)st.st_size < size || size == 0) {
+        WARN ("Ignoring message with invalid size %lu", (gulong)size);
+        return NULL;
+    }
+
+    addr = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        WARN ("Failed to map message : %s", strerror (errno));
+        return NULL;
+    }
+
+    mapping = g_slice_new0 (MsgPortMapping);
+    mapping->addr = addr;
+    mapping->size = size;
+
+    return g_variant_ref_sink (g_variant_new_from_data (type, addr, size, FALSE, _unmap, mapping));
+}
+
+#else
+
+gint
+msgport_variant_to_memfd (GVariant *v)
+{
+    return -1;
+}
+
+GVariant *
+msgport_variant_from_memfd (gint fd, gsize size, const GVariantType *type)
+{
+    return NULL;
+}
+
+#endif /* HAVE_MEMFD_CREATE */
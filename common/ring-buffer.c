@@ -0,0 +1,313 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "config.h" /* HAVE_MEMFD_CREATE */
+
+#include "ring-buffer.h"
+#include "dbus-error.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MSGPORT_RING_MAGIC          0x4d505242 /* "MPRB" */
+#define MSGPORT_RING_RECORD_SIZE(n) ((sizeof (guint32) + (n) + 7) & ~((guint32)7))
+
+/* producer and consumer fields live on their own cache lines */
+typedef struct {
+    guint32 magic;
+    guint32 capacity;
+    guint8  _pad0[56];
+    gint    head;
+    guint8  _pad1[60];
+    gint    tail;
+    gint    consumer_waiting;
+    guint8  _pad2[56];
+} MsgPortRingHeader;
+
+struct _MsgPortRing
+{
+    MsgPortRingHeader *header;
+    guint8            *data;
+    guint32            capacity; /* private copy, the shared one can not be trusted */
+    gsize              size;
+    gint               revoked; /* of this mapping only, the other end could clear a shared flag */
+};
+
+#ifdef HAVE_MEMFD_CREATE
+
+/*
+ * Creates a ring of capacity bytes, 0 for the default one, in a memfd sealed
+ * against resizing. Returns the memfd or -1 on error.
+ */
+gint
+msgport_ring_create (guint32 capacity, GError **error)
+{
+    MsgPortRingHeader *header = NULL;
+    gint fd, saved_errno;
+
+    if (capacity == 0) capacity = MSGPORT_RING_DEFAULT_CAPACITY;
+
+    if (capacity < MSGPORT_RING_MIN_CAPACITY || capacity > MSGPORT_RING_MAX_CAPACITY ||
+        (capacity & (capacity - 1)) != 0) {
+        if (error) *error = msgport_error_new (MSGPORT_ERROR_INVALID_PARAMS, "invalid ring capacity %u", capacity);
+        return -1;
+    }
+
+    fd = memfd_create ("messageport-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) goto fail;
+
+    if (ftruncate (fd, sizeof (MsgPortRingHeader) + capacity) < 0) goto fail_close;
+
+    header = mmap (NULL, sizeof (MsgPortRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) goto fail_close;
+    header->magic = MSGPORT_RING_MAGIC;
+    header->capacity = capacity;
+    munmap (header, sizeof (MsgPortRingHeader));
+
+    /* both ends write to the ring, only its size is fixed */
+    if (fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) goto fail_close;
+
+    return fd;
+
+fail_close:
+    saved_errno = errno;
+    close (fd);
+    errno = saved_errno;
+fail:
+    if (error) *error = msgport_error_new (MSGPORT_ERROR_IO_ERROR, "failed to create ring : %s", strerror (errno));
+    return -1;
+}
+
+/*
+ * Maps the ring created by msgport_ring_create(), fd is not consumed.
+ */
+MsgPortRing *
+msgport_ring_map (gint fd, GError **error)
+{
+    struct stat st;
+    MsgPortRing *ring = NULL;
+    MsgPortRingHeader *header = NULL;
+    gint seals = fcntl (fd, F_GET_SEALS);
+    guint32 capacity;
+
+    /* a ring the peer could shrink would crash us with SIGBUS */
+    if (seals < 0 || (seals & F_SEAL_SHRINK) == 0) {
+        if (error) *error = msgport_error_new (MSGPORT_ERROR_INVALID_PARAMS, "ring is not sealed");
+        return NULL;
+    }
+
+    if (fstat (fd, &st) < 0 ||
+        st.st_size < (off_t)(sizeof (MsgPortRingHeader) + MSGPORT_RING_MIN_CAPACITY) ||
+        st.st_size > (off_t)(sizeof (MsgPortRingHeader) + MSGPORT_RING_MAX_CAPACITY)) {
+        if (error) *error = msgport_error_new (MSGPORT_ERROR_INVALID_PARAMS, "invalid ring size");
+        return NULL;
+    }
+
+    header = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+        if (error) *error = msgport_error_new (MSGPORT_ERROR_IO_ERROR, "failed to map ring : %s", strerror (errno));
+        return NULL;
+    }
+
+    capacity = header->capacity;
+    if (header->magic != MSGPORT_RING_MAGIC ||
+        capacity != st.st_size - sizeof (MsgPortRingHeader) || (capacity & (capacity - 1)) != 0) {
+        munmap (header, st.st_size);
+        if (error) *error = msgport_error_new (MSGPORT_ERROR_INVALID_PARAMS, "invalid ring header");
+        return NULL;
+    }
+
+    ring = g_slice_new0 (MsgPortRing);
+    ring->header = header;
+    ring->data = (guint8 *)header + sizeof (MsgPortRingHeader);
+    ring->capacity = capacity;
+    ring->size = st.st_size;
+
+    return ring;
+}
+
+#else
+
+gint
+msgport_ring_create (guint32 capacity, GError **error)
+{
+    if (error) *error = msgport_error_new (MSGPORT_ERROR_IO_ERROR, "shared memory rings are not supported");
+    return -1;
+}
+
+MsgPortRing *
+msgport_ring_map (gint fd, GError **error)
+{
+    if (error) *error = msgport_error_new (MSGPORT_ERROR_IO_ERROR, "shared memory rings are not supported");
+    return NULL;
+}
+
+#endif /* HAVE_MEMFD_CREATE */
+
+void
+msgport_ring_unmap (MsgPortRing *ring)
+{
+    g_return_if_fail (ring);
+
+    munmap (ring->header, ring->size);
+    g_slice_free (MsgPortRing, ring);
+}
+
+guint32
+msgport_ring_max_message_size (MsgPortRing *ring)
+{
+    g_return_val_if_fail (ring, 0);
+
+    return ring->capacity - sizeof (guint32);
+}
+
+static void
+_ring_copy_in (MsgPortRing *ring, guint32 pos, gconstpointer src, guint32 len)
+{
+    guint32 offset = pos & (ring->capacity - 1);
+    guint32 first = MIN (len, ring->capacity - offset);
+
+    memcpy (ring->data + offset, src, first);
+    memcpy (ring->data, (const guint8 *)src + first, len - first);
+}
+
+static void
+_ring_copy_out (MsgPortRing *ring, guint32 pos, gpointer dest, guint32 len)
+{
+    guint32 offset = pos & (ring->capacity - 1);
+    guint32 first = MIN (len, ring->capacity - offset);
+
+    memcpy (dest, ring->data + offset, first);
+    memcpy ((guint8 *)dest + first, ring->data, len - first);
+}
+
+/*
+ * Producer side. Returns FALSE if there is no room for the record.
+ * wake_up is set if the consumer is sleeping and has to be woken up.
+ */
+gboolean
+msgport_ring_write (MsgPortRing *ring, gconstpointer data, guint32 size, gboolean *wake_up)
+{
+    MsgPortRingHeader *header = NULL;
+    guint32 head, tail, needed;
+
+    g_return_val_if_fail (ring && (data || !size), FALSE);
+    g_return_val_if_fail (size <= msgport_ring_max_message_size (ring), FALSE);
+
+    header = ring->header;
+    head = (guint32)g_atomic_int_get (&header->head);
+    tail = (guint32)g_atomic_int_get (&header->tail);
+    needed = MSGPORT_RING_RECORD_SIZE (size);
+
+    if (head - tail > ring->capacity || needed > ring->capacity - (head - tail)) return FALSE;
+
+    _ring_copy_in (ring, head, &size, sizeof (size));
+    _ring_copy_in (ring, head + sizeof (size), data, size);
+
+    /* publishes the record */
+    g_atomic_int_set (&header->head, (gint)(head + needed));
+
+    if (wake_up) *wake_up = g_atomic_int_compare_and_exchange (&header->consumer_waiting, 1, 0);
+
+    return TRUE;
+}
+
+/*
+ * Consumer side. Returns the next record, to be freed with g_free(),
+ * or NULL if the ring is empty.
+ */
+gpointer
+msgport_ring_read (MsgPortRing *ring, guint32 *size_out)
+{
+    MsgPortRingHeader *header = NULL;
+    guint32 head, tail, size = 0;
+    gpointer data = NULL;
+
+    g_return_val_if_fail (ring && size_out, NULL);
+
+    header = ring->header;
+    tail = (guint32)g_atomic_int_get (&header->tail);
+    head = (guint32)g_atomic_int_get (&header->head);
+
+    if (head == tail) return NULL;
+    if (head - tail > ring->capacity || head - tail < MSGPORT_RING_RECORD_SIZE (0)) goto corrupted;
+
+    _ring_copy_out (ring, tail, &size, sizeof (size));
+    if (size > head - tail - sizeof (size)) goto corrupted;
+
+    data = g_malloc (MAX (size, 1));
+    _ring_copy_out (ring, tail + sizeof (size), data, size);
+
+    /* hands the space back to the producer */
+    g_atomic_int_set (&header->tail, (gint)(tail + MSGPORT_RING_RECORD_SIZE (size)));
+
+    *size_out = size;
+
+    return data;
+
+corrupted:
+    /* the producer broke the protocol, nothing more can be trusted */
+    msgport_ring_revoke (ring);
+    return NULL;
+}
+
+/*
+ * Called by the consumer once the ring is drained, before it goes to sleep
+ * on the doorbell. Returns FALSE if a record slipped in meanwhile.
+ */
+gboolean
+msgport_ring_wait (MsgPortRing *ring)
+{
+    g_return_val_if_fail (ring, FALSE);
+
+    g_atomic_int_set (&ring->header->consumer_waiting, 1);
+
+    if (g_atomic_int_get (&ring->header->head) != g_atomic_int_get (&ring->header->tail)) {
+        g_atomic_int_set (&ring->header->consumer_waiting, 0);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void
+msgport_ring_revoke (MsgPortRing *ring)
+{
+    g_return_if_fail (ring);
+
+    g_atomic_int_set (&ring->revoked, 1);
+}
+
+gboolean
+msgport_ring_is_revoked (MsgPortRing *ring)
+{
+    g_return_val_if_fail (ring, TRUE);
+
+    return g_atomic_int_get (&ring->revoked) != 0;
+}
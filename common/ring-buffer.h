@@ -0,0 +1,75 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MSGPORT_RING_BUFFER_H
+#define __MSGPORT_RING_BUFFER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define MSGPORT_RING_MIN_CAPACITY     (4 * 1024)
+#define MSGPORT_RING_DEFAULT_CAPACITY (256 * 1024)
+#define MSGPORT_RING_MAX_CAPACITY     (16 * 1024 * 1024)
+
+/*
+ * Single producer, single consumer ring of length prefixed records,
+ * shared between two processes through a memfd. Positions are free
+ * running counters, only the producer moves head and only the consumer
+ * moves tail. Revoking is local to a mapping, the daemon tells each end
+ * over the bus.
+ */
+typedef struct _MsgPortRing MsgPortRing;
+
+gint
+msgport_ring_create (guint32 capacity, GError **error);
+
+MsgPortRing *
+msgport_ring_map (gint fd, GError **error);
+
+void
+msgport_ring_unmap (MsgPortRing *ring);
+
+guint32
+msgport_ring_max_message_size (MsgPortRing *ring);
+
+gboolean
+msgport_ring_write (MsgPortRing *ring, gconstpointer data, guint32 size, gboolean *wake_up);
+
+gpointer
+msgport_ring_read (MsgPortRing *ring, guint32 *size_out);
+
+gboolean
+msgport_ring_wait (MsgPortRing *ring);
+
+void
+msgport_ring_revoke (MsgPortRing *ring);
+
+gboolean
+msgport_ring_is_revoked (MsgPortRing *ring);
+
+G_END_DECLS
+
+#endif /* __MSGPORT_RING_BUFFER_H */
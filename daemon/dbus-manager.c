@@ -27,12 +27,19 @@
 #include "common/dbus-manager-glue.h"
 #include "common/dbus-service-glue.h"
 #include "common/dbus-error.h"
+#include "common/features.h"
 #include "common/log.h"
+#include "common/ring-buffer.h"
 #include "dbus-service.h"
 #include "dbus-server.h"
 #include "manager.h"
 #include "utils.h"
 
+#include <gio/gunixfdlist.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h> /* socketpair */
+#include <unistd.h> /* close */
+
 #include <aul/aul.h>
 #include <pkgmgr-info.h>
 
@@ -49,8 +56,52 @@ struct _MsgPortDbusManagerPrivate {
     gchar                  *app_id;
     gboolean                is_null_cert;
     GHashTable             *peer_certs;
+    GHashTable             *resolved_services; /* {service_id} handed out to the client */
+    GHashTable             *watches; /* {"app_id\x1fport\x1fis_trusted",watch count} */
+    guint                   n_dropped; /* failed messages that expected no reply */
+    GHashTable             *channels; /* {channel_id,MsgPortDbusChannel} opened by the client */
+    guint                   features; /* MsgPortFeatures agreed on with the client */
 };
 
+/*
+ * A ring shared between the client and a remote service, messages on it
+ * do not go through the daemon. Both ends map the ring read-write, so
+ * revoking it is told to each of them over the bus instead of in the ring.
+ */
+typedef struct {
+    guint               id;
+    MsgPortDbusManager *owner;
+    MsgPortDbusService *peer;
+} MsgPortDbusChannel;
+
+static void
+_dbus_channel_revoke (gpointer userdata)
+{
+    MsgPortDbusChannel *channel = (MsgPortDbusChannel *)userdata;
+
+    DBG ("Revoking channel %u", channel->id);
+
+    msgport_dbus_service_revoke_channel (channel->peer, channel->id);
+    if (channel->owner->priv->dbus_skeleton)
+        msgport_dbus_glue_manager_emit_channel_revoked (channel->owner->priv->dbus_skeleton, channel->id);
+
+    g_slice_free (MsgPortDbusChannel, channel);
+}
+
+static guint
+_dbus_channel_new_id ()
+{
+    static guint last_channel_id = 0;
+
+    return ++last_channel_id;
+}
+
+static gboolean
+_dbus_channel_has_peer (gpointer key, gpointer value, gpointer userdata)
+{
+    return ((MsgPortDbusChannel *)value)->peer == (MsgPortDbusService *)userdata;
+}
+
 
 static void
 _dbus_manager_finalize (GObject *self)
@@ -66,6 +117,12 @@ _dbus_manager_dispose (GObject *self)
     MsgPortDbusManager *dbus_mgr = MSGPORT_DBUS_MANAGER (self);
 
     DBG ("Unexporting dbus manager %p on connection %p", dbus_mgr, dbus_mgr->priv->connection);
+    /* revoked while the services on the other end are still there */
+    if (dbus_mgr->priv->channels) {
+        g_hash_table_unref (dbus_mgr->priv->channels);
+        dbus_mgr->priv->channels = NULL;
+    }
+
     if (dbus_mgr->priv->dbus_skeleton) {
         g_dbus_interface_skeleton_unexport (
                 G_DBUS_INTERFACE_SKELETON (dbus_mgr->priv->dbus_skeleton));
@@ -74,8 +131,13 @@ _dbus_manager_dispose (GObject *self)
 
     g_clear_object (&dbus_mgr->priv->connection);
 
+    /* stop watching for service changes, no one is listening anymore */
+    if (dbus_mgr->priv->manager)
+        g_signal_handlers_disconnect_by_data (dbus_mgr->priv->manager, dbus_mgr);
+
     /* unregister all services owned by this connection */
     msgport_manager_unregister_services (dbus_mgr->priv->manager, dbus_mgr, NULL);
+    msgport_manager_release_schemas (dbus_mgr->priv->manager, dbus_mgr);
 
     g_clear_object (&dbus_mgr->priv->manager);
 
@@ -84,6 +146,16 @@ _dbus_manager_dispose (GObject *self)
         dbus_mgr->priv->peer_certs = NULL;
     }
 
+    if (dbus_mgr->priv->resolved_services) {
+        g_hash_table_unref (dbus_mgr->priv->resolved_services);
+        dbus_mgr->priv->resolved_services = NULL;
+    }
+
+    if (dbus_mgr->priv->watches) {
+        g_hash_table_unref (dbus_mgr->priv->watches);
+        dbus_mgr->priv->watches = NULL;
+    }
+
     G_OBJECT_CLASS (msgport_dbus_manager_parent_class)->dispose (self);
 }
 
@@ -120,6 +192,87 @@ _dbus_manager_handle_register_service (
     return TRUE;
 }
 
+/*
+ * Looks up the remote service on all the connections of the remote application,
+ * an application might hold more than one connection, say one per thread.
+ */
+static MsgPortDbusService *
+_dbus_manager_lookup_remote_service (
+    MsgPortDbusManager *dbus_mgr,
+    const gchar        *remote_app_id,
+    const gchar        *remote_port_name,
+    gboolean            is_trusted,
+    MsgPortDbusService *ignore_service)
+{
+    guint i;
+    GPtrArray *remote_dbus_managers = NULL;
+
+    remote_dbus_managers = msgport_dbus_server_get_dbus_managers_by_app_id (
+                dbus_mgr->priv->server, remote_app_id);
+
+    for (i = 0; remote_dbus_managers && i < remote_dbus_managers->len; i++) {
+        MsgPortDbusService *dbus_service = msgport_manager_get_service (
+                dbus_mgr->priv->manager, g_ptr_array_index (remote_dbus_managers, i),
+                remote_port_name, is_trusted, NULL);
+        if (dbus_service && dbus_service != ignore_service) return dbus_service;
+    }
+
+    return NULL;
+}
+
+static void
+_dbus_manager_emit_schema_shared (guint schema_id, const gchar * const *keys, gpointer userdata)
+{
+    MsgPortDbusManager *dbus_mgr = MSGPORT_DBUS_MANAGER (userdata);
+
+    msgport_dbus_glue_manager_emit_schema_shared (dbus_mgr->priv->dbus_skeleton, schema_id, keys);
+}
+
+/*
+ * Hands the schemas of dbus_manager to the client owning peer_dbus_service,
+ * ahead of the message sent there, so that it never has to ask for them.
+ * Clients without schema bundles get the messages expanded instead.
+ */
+void
+msgport_dbus_manager_share_schemas (
+    MsgPortDbusManager *dbus_manager,
+    MsgPortDbusService *peer_dbus_service)
+{
+    MsgPortDbusManager *peer = msgport_dbus_service_get_owner (peer_dbus_service);
+
+    if (!peer || !(peer->priv->features & MSGPORT_FEATURE_SCHEMA_BUNDLE)) return;
+
+    msgport_manager_share_schemas (dbus_manager->priv->manager, dbus_manager, peer,
+            _dbus_manager_emit_schema_shared, peer);
+}
+
+MsgPortDbusService *
+msgport_dbus_manager_find_remote_service (
+    MsgPortDbusManager *dbus_mgr,
+    const gchar        *remote_app_id,
+    const gchar        *remote_port_name,
+    gboolean            is_trusted,
+    GError            **error)
+{
+    MsgPortDbusService *dbus_service = NULL;
+
+    msgport_return_val_if_fail_with_error (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), NULL, error);
+    msgport_return_val_if_fail_with_error (remote_app_id && remote_port_name, NULL, error);
+
+    dbus_service = _dbus_manager_lookup_remote_service (dbus_mgr,
+            remote_app_id, remote_port_name, is_trusted, NULL);
+    if (dbus_service) {
+        /* client might cache the service id, remember to invalidate it */
+        g_hash_table_add (dbus_mgr->priv->resolved_services,
+                GUINT_TO_POINTER (msgport_dbus_service_get_id (dbus_service)));
+        return dbus_service;
+    }
+
+    if (error) *error = msgport_error_port_not_found (remote_app_id, remote_port_name);
+
+    return NULL;
+}
+
 static gboolean
 _dbus_manager_handle_check_for_remote_service (
     MsgPortDbusManager    *dbus_mgr,
@@ -131,26 +284,28 @@ _dbus_manager_handle_check_for_remote_service (
 {
     GError *error = NULL;
     MsgPortDbusService *dbus_service = NULL;
-    MsgPortDbusManager *remote_dbus_manager = NULL;
 
     msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
 
     DBG ("check remote service request from %p for '%s' '%s', is_trusted: %d", 
             dbus_mgr, remote_app_id, remote_port_name, is_trusted);
 
-    remote_dbus_manager = msgport_dbus_server_get_dbus_manager_by_app_id (
-                dbus_mgr->priv->server, remote_app_id);
+    dbus_service = msgport_dbus_manager_find_remote_service (dbus_mgr,
+                        remote_app_id, remote_port_name, is_trusted, &error);
+    if (dbus_service && is_trusted &&
+        !msgport_dbus_manager_validate_peer_certificate (
+                msgport_dbus_service_get_owner (dbus_service), dbus_mgr->priv->app_id)) {
+        DBG ("Certificate mismatch for trusted service id : %d", msgport_dbus_service_get_id (dbus_service));
+        g_dbus_method_invocation_take_error (invocation, msgport_error_certificate_mismatch_new ());
+        return TRUE;
+    }
 
-    if (remote_dbus_manager) {
-        dbus_service = msgport_manager_get_service (dbus_mgr->priv->manager, 
-                            remote_dbus_manager, remote_port_name, is_trusted, &error);
-        if (dbus_service) {
-            DBG ("Found service id : %d", msgport_dbus_service_get_id (dbus_service));
-            msgport_dbus_glue_manager_complete_check_for_remote_service (
-                dbus_mgr->priv->dbus_skeleton, invocation, 
-                msgport_dbus_service_get_id (dbus_service));
-            return TRUE;
-        }
+    if (dbus_service) {
+        DBG ("Found service id : %d", msgport_dbus_service_get_id (dbus_service));
+        msgport_dbus_glue_manager_complete_check_for_remote_service (
+            dbus_mgr->priv->dbus_skeleton, invocation, 
+            msgport_dbus_service_get_id (dbus_service));
+        return TRUE;
     }
 
     if (!error) error = msgport_error_port_not_found (remote_app_id, remote_port_name);
@@ -169,29 +324,736 @@ _dbus_manager_handle_send_message (
 {
     GError *error = NULL;
     MsgPortDbusService *peer_dbus_service = 0;
+    gboolean no_reply = FALSE;
 
     msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
 
     DBG ("send_message from %p('%s') to service_id %d", 
         dbus_mgr, dbus_mgr->priv->app_id, service_id);
 
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+
     peer_dbus_service = msgport_manager_get_service_by_id (
-            dbus_mgr->priv->manager, service_id, &error);
+            dbus_mgr->priv->manager, service_id, no_reply ? NULL : &error);
 
     if (peer_dbus_service) {
-        if (msgport_dbus_service_send_message (peer_dbus_service, data, dbus_mgr->priv->app_id, "", FALSE, &error)) {
-            msgport_dbus_glue_manager_complete_send_message (
+        msgport_dbus_manager_share_schemas (dbus_mgr, peer_dbus_service);
+        if (msgport_dbus_service_send_message (peer_dbus_service, data, dbus_mgr->priv->app_id, "", FALSE, no_reply ? NULL : &error)) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_mgr, invocation, FALSE);
+            else msgport_dbus_glue_manager_complete_send_message (
                 dbus_mgr->priv->dbus_skeleton, invocation);
             return TRUE;
         }
     }
 
+    if (no_reply) {
+        msgport_dbus_manager_drop_reply (dbus_mgr, invocation, TRUE);
+        return TRUE;
+    }
+
+    if (!error) error = msgport_error_unknown_new ();
+    g_dbus_method_invocation_take_error (invocation, error);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_send_message_to (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    GVariant              *data,
+    gpointer               userdata)
+{
+    GError *error = NULL;
+    MsgPortDbusService *peer_dbus_service = NULL;
+    gboolean no_reply = FALSE;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    DBG ("send_message from %p('%s') to '%s' '%s', is_trusted: %d",
+        dbus_mgr, dbus_mgr->priv->app_id, remote_app_id, remote_port_name, is_trusted);
+
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_mgr,
+            remote_app_id, remote_port_name, is_trusted, no_reply ? NULL : &error);
+
+    if (peer_dbus_service) {
+        msgport_dbus_manager_share_schemas (dbus_mgr, peer_dbus_service);
+        if (msgport_dbus_service_send_message (peer_dbus_service, data, dbus_mgr->priv->app_id, "", FALSE, no_reply ? NULL : &error)) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_mgr, invocation, FALSE);
+            else msgport_dbus_glue_manager_complete_send_message_to (
+                dbus_mgr->priv->dbus_skeleton, invocation,
+                msgport_dbus_service_get_id (peer_dbus_service));
+            return TRUE;
+        }
+    }
+
+    if (no_reply) {
+        msgport_dbus_manager_drop_reply (dbus_mgr, invocation, TRUE);
+        return TRUE;
+    }
+
     if (!error) error = msgport_error_unknown_new ();
     g_dbus_method_invocation_take_error (invocation, error);
 
     return TRUE;
 }
 
+static gboolean
+_dbus_manager_handle_send_large_message_to (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    GUnixFDList           *fd_list,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    GVariant              *payload,
+    guint64                size,
+    gpointer               userdata)
+{
+    GError *error = NULL;
+    MsgPortDbusService *peer_dbus_service = NULL;
+    gboolean no_reply = FALSE;
+    gint fd = -1;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    DBG ("send_large_message from %p('%s') to '%s' '%s', is_trusted: %d, size: %"G_GUINT64_FORMAT,
+        dbus_mgr, dbus_mgr->priv->app_id, remote_app_id, remote_port_name, is_trusted, size);
+
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_mgr,
+            remote_app_id, remote_port_name, is_trusted, &error);
+
+    if (peer_dbus_service && fd_list)
+        fd = g_unix_fd_list_get (fd_list, g_variant_get_handle (payload), &error);
+
+    if (fd >= 0) {
+        gboolean sent;
+
+        msgport_dbus_manager_share_schemas (dbus_mgr, peer_dbus_service);
+        sent = msgport_dbus_service_send_large_message (peer_dbus_service, fd, size,
+                dbus_mgr->priv->app_id, "", FALSE, &error);
+        close (fd);
+
+        if (sent) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_mgr, invocation, FALSE);
+            else msgport_dbus_glue_manager_complete_send_large_message_to (
+                dbus_mgr->priv->dbus_skeleton, invocation, NULL,
+                msgport_dbus_service_get_id (peer_dbus_service));
+            return TRUE;
+        }
+    }
+
+    if (no_reply) {
+        g_clear_error (&error);
+        msgport_dbus_manager_drop_reply (dbus_mgr, invocation, TRUE);
+        return TRUE;
+    }
+
+    if (!error) error = msgport_error_unknown_new ();
+    g_dbus_method_invocation_take_error (invocation, error);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_send_message_with_fds_to (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    GUnixFDList           *fd_list,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    GVariant              *data,
+    GVariant              *fds,
+    gpointer               userdata)
+{
+    GError *error = NULL;
+    MsgPortDbusService *peer_dbus_service = NULL;
+    gboolean no_reply = FALSE;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    DBG ("send_message_with_fds from %p('%s') to '%s' '%s', is_trusted: %d",
+        dbus_mgr, dbus_mgr->priv->app_id, remote_app_id, remote_port_name, is_trusted);
+
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_mgr,
+            remote_app_id, remote_port_name, is_trusted, no_reply ? NULL : &error);
+
+    if (peer_dbus_service) {
+        msgport_dbus_manager_share_schemas (dbus_mgr, peer_dbus_service);
+        if (msgport_dbus_service_send_message_with_fds (peer_dbus_service, data, fds, fd_list,
+                dbus_mgr->priv->app_id, "", FALSE, no_reply ? NULL : &error)) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_mgr, invocation, FALSE);
+            else msgport_dbus_glue_manager_complete_send_message_with_fds_to (
+                dbus_mgr->priv->dbus_skeleton, invocation, NULL,
+                msgport_dbus_service_get_id (peer_dbus_service));
+            return TRUE;
+        }
+    }
+
+    if (no_reply) {
+        msgport_dbus_manager_drop_reply (dbus_mgr, invocation, TRUE);
+        return TRUE;
+    }
+
+    if (!error) error = msgport_error_unknown_new ();
+    g_dbus_method_invocation_take_error (invocation, error);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_send_messages_to (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    GVariant              *messages,
+    gpointer               userdata)
+{
+    GError *error = NULL;
+    MsgPortDbusService *peer_dbus_service = NULL;
+    gboolean no_reply = FALSE;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    DBG ("send_messages from %p('%s') to '%s' '%s', is_trusted: %d",
+        dbus_mgr, dbus_mgr->priv->app_id, remote_app_id, remote_port_name, is_trusted);
+
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_mgr,
+            remote_app_id, remote_port_name, is_trusted, no_reply ? NULL : &error);
+
+    /* whole batch goes out as one signal */
+    if (peer_dbus_service) {
+        msgport_dbus_manager_share_schemas (dbus_mgr, peer_dbus_service);
+        if (msgport_dbus_service_send_messages (peer_dbus_service, messages, dbus_mgr->priv->app_id, "", FALSE, no_reply ? NULL : &error)) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_mgr, invocation, FALSE);
+            else msgport_dbus_glue_manager_complete_send_messages_to (
+                dbus_mgr->priv->dbus_skeleton, invocation,
+                msgport_dbus_service_get_id (peer_dbus_service));
+            return TRUE;
+        }
+    }
+
+    if (no_reply) {
+        msgport_dbus_manager_drop_reply (dbus_mgr, invocation, TRUE);
+        return TRUE;
+    }
+
+    if (!error) error = msgport_error_unknown_new ();
+    g_dbus_method_invocation_take_error (invocation, error);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_send_message_multi (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    GVariant              *targets,
+    GVariant              *data,
+    gpointer               userdata)
+{
+    GVariantIter iter;
+    GVariantBuilder results;
+    const gchar *remote_app_id = NULL;
+    const gchar *remote_port_name = NULL;
+    gboolean is_trusted = FALSE;
+    gboolean no_reply = FALSE;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    DBG ("send_message_multi from %p('%s') to %lu targets",
+        dbus_mgr, dbus_mgr->priv->app_id, (gulong)g_variant_n_children (targets));
+
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+
+    g_variant_builder_init (&results, G_VARIANT_TYPE ("au"));
+
+    /* same data goes to every target, the result of each one is a MsgPortError code or 0 */
+    g_variant_iter_init (&iter, targets);
+    while (g_variant_iter_next (&iter, "(&s&sb)", &remote_app_id, &remote_port_name, &is_trusted)) {
+        GError *error = NULL;
+        guint result = 0;
+        MsgPortDbusService *peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_mgr,
+                remote_app_id, remote_port_name, is_trusted, &error);
+
+        if (peer_dbus_service) {
+            msgport_dbus_manager_share_schemas (dbus_mgr, peer_dbus_service);
+            msgport_dbus_service_send_message (peer_dbus_service, data, dbus_mgr->priv->app_id, "", FALSE, &error);
+        }
+
+        if (error) {
+            DBG ("Failed to deliver to '%s' '%s' : %s", remote_app_id, remote_port_name, error->message);
+            result = error->code;
+            g_error_free (error);
+            if (no_reply) dbus_mgr->priv->n_dropped++;
+        }
+        g_variant_builder_add (&results, "u", result);
+    }
+
+    if (no_reply) {
+        g_variant_builder_clear (&results);
+        msgport_dbus_manager_drop_reply (dbus_mgr, invocation, FALSE);
+        return TRUE;
+    }
+
+    msgport_dbus_glue_manager_complete_send_message_multi (
+            dbus_mgr->priv->dbus_skeleton, invocation, g_variant_builder_end (&results));
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_negotiate_features (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    const gchar * const   *features,
+    gpointer               userdata)
+{
+    gchar **accepted = NULL;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    dbus_mgr->priv->features = msgport_features_from_strv (features) & MSGPORT_FEATURES_SUPPORTED;
+
+    DBG ("Features of %p('%s') : 0x%x", dbus_mgr, dbus_mgr->priv->app_id, dbus_mgr->priv->features);
+
+    accepted = msgport_features_to_strv (dbus_mgr->priv->features);
+    msgport_dbus_glue_manager_complete_negotiate_features (
+            dbus_mgr->priv->dbus_skeleton, invocation, (const gchar * const *)accepted);
+    g_strfreev (accepted);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_register_schema (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    const gchar * const   *keys,
+    gpointer               userdata)
+{
+    GError *error = NULL;
+    guint schema_id;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    schema_id = msgport_manager_register_schema (dbus_mgr->priv->manager, dbus_mgr, keys, &error);
+    if (!schema_id) {
+        if (!error) error = msgport_error_unknown_new ();
+        g_dbus_method_invocation_take_error (invocation, error);
+        return TRUE;
+    }
+
+    DBG ("Schema %u for %p('%s')", schema_id, dbus_mgr, dbus_mgr->priv->app_id);
+
+    msgport_dbus_glue_manager_complete_register_schema (
+            dbus_mgr->priv->dbus_skeleton, invocation, schema_id);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_get_schema (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    guint                  schema_id,
+    gpointer               userdata)
+{
+    const gchar * const *keys = NULL;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    keys = msgport_manager_get_schema (dbus_mgr->priv->manager, schema_id);
+    if (!keys) {
+        g_dbus_method_invocation_take_error (invocation,
+                msgport_error_new (MSGPORT_ERROR_NOT_FOUND, "no schema found with id '%u'", schema_id));
+        return TRUE;
+    }
+
+    msgport_dbus_glue_manager_complete_get_schema (
+            dbus_mgr->priv->dbus_skeleton, invocation, keys);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_get_dropped_message_count (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    gpointer               userdata)
+{
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    msgport_dbus_glue_manager_complete_get_dropped_message_count (
+            dbus_mgr->priv->dbus_skeleton, invocation, dbus_mgr->priv->n_dropped);
+
+    return TRUE;
+}
+
+/*
+ * Ids of trusted services are only handed to clients with a matching certificate.
+ */
+static gboolean
+_dbus_manager_may_resolve (MsgPortDbusManager *dbus_mgr, MsgPortDbusService *dbus_service)
+{
+    return !msgport_dbus_service_get_is_trusted (dbus_service) ||
+           msgport_dbus_manager_validate_peer_certificate (
+                msgport_dbus_service_get_owner (dbus_service), dbus_mgr->priv->app_id);
+}
+
+static gchar *
+_watch_key (const gchar *app_id, const gchar *port_name, gboolean is_trusted)
+{
+    return g_strdup_printf ("%s\x1f%s\x1f%d", app_id, port_name, is_trusted ? 1 : 0);
+}
+
+static gboolean
+_dbus_manager_handle_watch_remote_service (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    gpointer               userdata)
+{
+    gchar *key = NULL;
+    guint n_watches = 0;
+    guint service_id = 0;
+    MsgPortDbusService *dbus_service = NULL;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    DBG ("watch request from %p('%s') for '%s' '%s', is_trusted: %d",
+            dbus_mgr, dbus_mgr->priv->app_id, remote_app_id, remote_port_name, is_trusted);
+
+    dbus_service = _dbus_manager_lookup_remote_service (dbus_mgr,
+            remote_app_id, remote_port_name, is_trusted, NULL);
+    if (dbus_service && !_dbus_manager_may_resolve (dbus_mgr, dbus_service)) {
+        DBG ("Certificate mismatch for trusted service id : %d", msgport_dbus_service_get_id (dbus_service));
+        g_dbus_method_invocation_take_error (invocation, msgport_error_certificate_mismatch_new ());
+        return TRUE;
+    }
+
+    key = _watch_key (remote_app_id, remote_port_name, is_trusted);
+    n_watches = GPOINTER_TO_UINT (g_hash_table_lookup (dbus_mgr->priv->watches, key));
+    g_hash_table_replace (dbus_mgr->priv->watches, key, GUINT_TO_POINTER (n_watches + 1));
+
+    /* reply with the current state of the port, further changes are signaled */
+    if (dbus_service) {
+        service_id = msgport_dbus_service_get_id (dbus_service);
+        /* client might cache the service id, remember to invalidate it */
+        g_hash_table_add (dbus_mgr->priv->resolved_services, GUINT_TO_POINTER (service_id));
+    }
+
+    msgport_dbus_glue_manager_complete_watch_remote_service (dbus_mgr->priv->dbus_skeleton,
+            invocation, service_id);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_unwatch_remote_service (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    gpointer               userdata)
+{
+    gchar *key = NULL;
+    guint n_watches = 0;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    key = _watch_key (remote_app_id, remote_port_name, is_trusted);
+    n_watches = GPOINTER_TO_UINT (g_hash_table_lookup (dbus_mgr->priv->watches, key));
+    if (n_watches > 1)
+        g_hash_table_replace (dbus_mgr->priv->watches, key, GUINT_TO_POINTER (n_watches - 1));
+    else {
+        g_hash_table_remove (dbus_mgr->priv->watches, key);
+        g_free (key);
+    }
+
+    msgport_dbus_glue_manager_complete_unwatch_remote_service (dbus_mgr->priv->dbus_skeleton, invocation);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_open_channel (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    GUnixFDList           *in_fd_list,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    gpointer               userdata)
+{
+    GError *error = NULL;
+    MsgPortDbusService *peer_dbus_service = NULL;
+    MsgPortDbusChannel *channel = NULL;
+    GUnixFDList *fd_list = NULL;
+    gint ring_fd = -1, doorbell_fd = -1;
+
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    DBG ("open_channel from %p('%s') to '%s' '%s', is_trusted: %d",
+        dbus_mgr, dbus_mgr->priv->app_id, remote_app_id, remote_port_name, is_trusted);
+
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_mgr,
+            remote_app_id, remote_port_name, is_trusted, &error);
+    if (!peer_dbus_service) goto out;
+
+    ring_fd = msgport_ring_create (0, &error);
+    if (ring_fd < 0) goto out;
+
+    doorbell_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (doorbell_fd < 0) {
+        error = msgport_error_new (MSGPORT_ERROR_IO_ERROR, "failed to create doorbell");
+        goto out;
+    }
+
+    fd_list = g_unix_fd_list_new ();
+    if (g_unix_fd_list_append (fd_list, ring_fd, &error) < 0 ||
+        g_unix_fd_list_append (fd_list, doorbell_fd, &error) < 0)
+        goto out;
+
+    channel = g_slice_new0 (MsgPortDbusChannel);
+    channel->id = _dbus_channel_new_id ();
+    channel->owner = dbus_mgr;
+    channel->peer = peer_dbus_service;
+
+    /* does the certificate check for trusted ports */
+    if (!msgport_dbus_service_open_channel (peer_dbus_service, channel->id, fd_list,
+            dbus_mgr->priv->app_id, "", FALSE, &error)) {
+        g_slice_free (MsgPortDbusChannel, channel);
+        goto out;
+    }
+
+    g_hash_table_insert (dbus_mgr->priv->channels, GUINT_TO_POINTER (channel->id), channel);
+
+    msgport_dbus_glue_manager_complete_open_channel (dbus_mgr->priv->dbus_skeleton, invocation,
+            fd_list, channel->id, g_variant_new_handle (0), g_variant_new_handle (1));
+
+out:
+    if (fd_list) g_object_unref (fd_list);
+    if (ring_fd >= 0) close (ring_fd);
+    if (doorbell_fd >= 0) close (doorbell_fd);
+
+    if (error) g_dbus_method_invocation_take_error (invocation, error);
+
+    return TRUE;
+}
+
+/*
+ * The daemon keeps no copy of the socket ends, so that either side sees the
+ * other one closing its end, be it on purpose, on unregistering the port or
+ * on exit.
+ */
+static void
+_dbus_manager_open_socket_channel (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    gboolean               is_stream)
+{
+    GError *error = NULL;
+    MsgPortDbusService *peer_dbus_service = NULL;
+    GUnixFDList *sender_fd_list = NULL, *receiver_fd_list = NULL;
+    gint sockets[2] = { -1, -1 };
+    guint channel_id = 0;
+
+    DBG ("open_%s from %p('%s') to '%s' '%s', is_trusted: %d", is_stream ? "stream" : "peer_channel",
+        dbus_mgr, dbus_mgr->priv->app_id, remote_app_id, remote_port_name, is_trusted);
+
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_mgr,
+            remote_app_id, remote_port_name, is_trusted, &error);
+    if (!peer_dbus_service) goto out;
+
+    /* packets keep the message boundaries */
+    if (socketpair (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) < 0) {
+        error = msgport_error_new (MSGPORT_ERROR_IO_ERROR, "failed to create socket pair");
+        goto out;
+    }
+
+    /* the lists take the fds */
+    sender_fd_list = g_unix_fd_list_new_from_array (&sockets[0], 1);
+    receiver_fd_list = g_unix_fd_list_new_from_array (&sockets[1], 1);
+
+    channel_id = _dbus_channel_new_id ();
+
+    /* does the certificate check for trusted ports */
+    if (!msgport_dbus_service_open_peer_channel (peer_dbus_service, channel_id, is_stream, receiver_fd_list,
+            dbus_mgr->priv->app_id, "", FALSE, &error))
+        goto out;
+
+    if (is_stream)
+        msgport_dbus_glue_manager_complete_open_stream (dbus_mgr->priv->dbus_skeleton, invocation,
+                sender_fd_list, channel_id, g_variant_new_handle (0));
+    else
+        msgport_dbus_glue_manager_complete_open_peer_channel (dbus_mgr->priv->dbus_skeleton, invocation,
+                sender_fd_list, channel_id, g_variant_new_handle (0));
+
+out:
+    if (sender_fd_list) g_object_unref (sender_fd_list);
+    if (receiver_fd_list) g_object_unref (receiver_fd_list);
+
+    if (error) g_dbus_method_invocation_take_error (invocation, error);
+}
+
+static gboolean
+_dbus_manager_handle_open_peer_channel (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    GUnixFDList           *in_fd_list,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    gpointer               userdata)
+{
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    _dbus_manager_open_socket_channel (dbus_mgr, invocation, remote_app_id, remote_port_name, is_trusted, FALSE);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_open_stream (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    GUnixFDList           *in_fd_list,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               is_trusted,
+    gpointer               userdata)
+{
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    _dbus_manager_open_socket_channel (dbus_mgr, invocation, remote_app_id, remote_port_name, is_trusted, TRUE);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_handle_close_channel (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    guint                  channel_id,
+    gpointer               userdata)
+{
+    msgport_return_val_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr), FALSE);
+
+    DBG ("close_channel %u from %p('%s')", channel_id, dbus_mgr, dbus_mgr->priv->app_id);
+
+    /* removing revokes the channel */
+    if (!g_hash_table_remove (dbus_mgr->priv->channels, GUINT_TO_POINTER (channel_id))) {
+        g_dbus_method_invocation_take_error (invocation,
+                msgport_error_new (MSGPORT_ERROR_NOT_FOUND, "no channel found with id '%u'", channel_id));
+        return TRUE;
+    }
+
+    msgport_dbus_glue_manager_complete_close_channel (dbus_mgr->priv->dbus_skeleton, invocation);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_manager_is_watching (MsgPortDbusManager *dbus_mgr, MsgPortDbusService *dbus_service)
+{
+    gchar *key = NULL;
+    gboolean is_watching = FALSE;
+
+    if (g_hash_table_size (dbus_mgr->priv->watches) == 0) return FALSE;
+
+    key = _watch_key (msgport_dbus_service_get_app_id (dbus_service),
+                      msgport_dbus_service_get_port_name (dbus_service),
+                      msgport_dbus_service_get_is_trusted (dbus_service));
+    is_watching = g_hash_table_contains (dbus_mgr->priv->watches, key);
+    g_free (key);
+
+    return is_watching;
+}
+
+static void
+_dbus_manager_on_service_registered (
+    MsgPortDbusManager *dbus_mgr,
+    MsgPortDbusService *dbus_service,
+    MsgPortManager     *manager)
+{
+    guint service_id = 0;
+
+    if (!_dbus_manager_is_watching (dbus_mgr, dbus_service)) return;
+
+    service_id = msgport_dbus_service_get_id (dbus_service);
+    if (!_dbus_manager_may_resolve (dbus_mgr, dbus_service)) {
+        DBG ("Not notifying client %p('%s') about trusted service %d, certificate mismatch",
+                dbus_mgr, dbus_mgr->priv->app_id, service_id);
+        return;
+    }
+
+    g_hash_table_add (dbus_mgr->priv->resolved_services, GUINT_TO_POINTER (service_id));
+
+    DBG ("Watched service %d appeared, notifying client %p('%s')", service_id, dbus_mgr, dbus_mgr->priv->app_id);
+    msgport_dbus_glue_manager_emit_remote_service_changed (dbus_mgr->priv->dbus_skeleton,
+            msgport_dbus_service_get_app_id (dbus_service),
+            msgport_dbus_service_get_port_name (dbus_service),
+            msgport_dbus_service_get_is_trusted (dbus_service),
+            service_id);
+}
+
+static void
+_dbus_manager_on_service_unregistered (
+    MsgPortDbusManager *dbus_mgr,
+    MsgPortDbusService *dbus_service,
+    MsgPortManager     *manager)
+{
+    guint service_id = msgport_dbus_service_get_id (dbus_service);
+
+    /* channels to the service go away along with it */
+    g_hash_table_foreach_remove (dbus_mgr->priv->channels, _dbus_channel_has_peer, dbus_service);
+
+    /* notify only the clients that know about this service */
+    if (g_hash_table_remove (dbus_mgr->priv->resolved_services, GUINT_TO_POINTER (service_id))) {
+        DBG ("Invalidating service id %d on client %p('%s')", service_id, dbus_mgr, dbus_mgr->priv->app_id);
+        msgport_dbus_glue_manager_emit_remote_service_unregistered (dbus_mgr->priv->dbus_skeleton, service_id);
+    }
+
+    if (_dbus_manager_is_watching (dbus_mgr, dbus_service)) {
+        const gchar *app_id = msgport_dbus_service_get_app_id (dbus_service);
+        const gchar *port_name = msgport_dbus_service_get_port_name (dbus_service);
+        gboolean is_trusted = msgport_dbus_service_get_is_trusted (dbus_service);
+        /* same port might be still available on other connection of the application */
+        MsgPortDbusService *other_service = _dbus_manager_lookup_remote_service (dbus_mgr,
+                app_id, port_name, is_trusted, dbus_service);
+        guint other_service_id = other_service && _dbus_manager_may_resolve (dbus_mgr, other_service)
+                ? msgport_dbus_service_get_id (other_service) : 0;
+
+        if (other_service_id)
+            g_hash_table_add (dbus_mgr->priv->resolved_services, GUINT_TO_POINTER (other_service_id));
+
+        DBG ("Watched service %d disappeared, notifying client %p('%s')", service_id, dbus_mgr, dbus_mgr->priv->app_id);
+        msgport_dbus_glue_manager_emit_remote_service_changed (dbus_mgr->priv->dbus_skeleton,
+                app_id, port_name, is_trusted, other_service_id);
+    }
+}
+
 static void
 msgport_dbus_manager_class_init (MsgPortDbusManagerClass *klass)
 {
@@ -212,6 +1074,14 @@ msgport_dbus_manager_init (MsgPortDbusManager *self)
     priv->manager = msgport_manager_new ();
     priv->is_null_cert = FALSE;
     priv->peer_certs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    priv->resolved_services = g_hash_table_new (g_direct_hash, g_direct_equal);
+    priv->watches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    priv->channels = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, _dbus_channel_revoke);
+
+    g_signal_connect_swapped (priv->manager, "service-registered",
+                G_CALLBACK (_dbus_manager_on_service_registered), (gpointer)self);
+    g_signal_connect_swapped (priv->manager, "service-unregistered",
+                G_CALLBACK (_dbus_manager_on_service_unregistered), (gpointer)self);
 
     g_signal_connect_swapped (priv->dbus_skeleton, "handle-register-service",
                 G_CALLBACK (_dbus_manager_handle_register_service), (gpointer)self);
@@ -219,6 +1089,36 @@ msgport_dbus_manager_init (MsgPortDbusManager *self)
                 G_CALLBACK (_dbus_manager_handle_check_for_remote_service), (gpointer)self);
     g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-message",
                 G_CALLBACK (_dbus_manager_handle_send_message), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-message-to",
+                G_CALLBACK (_dbus_manager_handle_send_message_to), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-large-message-to",
+                G_CALLBACK (_dbus_manager_handle_send_large_message_to), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-message-with-fds-to",
+                G_CALLBACK (_dbus_manager_handle_send_message_with_fds_to), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-messages-to",
+                G_CALLBACK (_dbus_manager_handle_send_messages_to), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-message-multi",
+                G_CALLBACK (_dbus_manager_handle_send_message_multi), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-negotiate-features",
+                G_CALLBACK (_dbus_manager_handle_negotiate_features), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-register-schema",
+                G_CALLBACK (_dbus_manager_handle_register_schema), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-get-schema",
+                G_CALLBACK (_dbus_manager_handle_get_schema), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-get-dropped-message-count",
+                G_CALLBACK (_dbus_manager_handle_get_dropped_message_count), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-watch-remote-service",
+                G_CALLBACK (_dbus_manager_handle_watch_remote_service), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-unwatch-remote-service",
+                G_CALLBACK (_dbus_manager_handle_unwatch_remote_service), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-open-channel",
+                G_CALLBACK (_dbus_manager_handle_open_channel), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-open-peer-channel",
+                G_CALLBACK (_dbus_manager_handle_open_peer_channel), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-open-stream",
+                G_CALLBACK (_dbus_manager_handle_open_stream), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-close-channel",
+                G_CALLBACK (_dbus_manager_handle_close_channel), (gpointer)self);
 
     self->priv = priv;
 }
@@ -312,6 +1212,14 @@ msgport_dbus_manager_get_app_id (MsgPortDbusManager *dbus_manager)
     return (const gchar *)dbus_manager->priv->app_id;
 }
 
+guint
+msgport_dbus_manager_get_features (MsgPortDbusManager *dbus_manager)
+{
+    msgport_return_val_if_fail (dbus_manager && MSGPORT_IS_DBUS_MANAGER (dbus_manager), MSGPORT_FEATURE_NONE);
+
+    return dbus_manager->priv->features;
+}
+
 gboolean
 msgport_dbus_manager_validate_peer_certificate (MsgPortDbusManager *dbus_manager, const gchar *peer_app_id)
 {
@@ -352,3 +1260,29 @@ msgport_dbus_manager_validate_peer_certificate (MsgPortDbusManager *dbus_manager
     return is_valid_cert;
 }
 
+gboolean
+msgport_dbus_manager_reply_expected (GDBusMethodInvocation *invocation)
+{
+    GDBusMessage *msg = g_dbus_method_invocation_get_message (invocation);
+
+    return !(g_dbus_message_get_flags (msg) & G_DBUS_MESSAGE_FLAGS_NO_REPLY_EXPECTED);
+}
+
+void
+msgport_dbus_manager_drop_reply (
+    MsgPortDbusManager    *dbus_mgr,
+    GDBusMethodInvocation *invocation,
+    gboolean               failed)
+{
+    g_return_if_fail (dbus_mgr && MSGPORT_IS_DBUS_MANAGER (dbus_mgr));
+
+    if (failed) {
+        dbus_mgr->priv->n_dropped++;
+        DBG ("Dropped '%s' from %p('%s'), %d dropped so far",
+                g_dbus_method_invocation_get_method_name (invocation),
+                dbus_mgr, dbus_mgr->priv->app_id, dbus_mgr->priv->n_dropped);
+    }
+
+    /* invocation is ours, normally the complete_* call consumes it */
+    g_object_unref (invocation);
+}
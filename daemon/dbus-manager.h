@@ -44,6 +44,7 @@ typedef struct _MsgPortDbusManagerPrivate MsgPortDbusManagerPrivate;
 
 typedef struct _MsgPortManager MsgPortManager;
 typedef struct _MsgPortDbusServer MsgPortDbusServer;
+typedef struct _MsgPortDbusService MsgPortDbusService;
 
 struct _MsgPortDbusManager
 {
@@ -75,10 +76,32 @@ msgport_dbus_manager_get_connection (MsgPortDbusManager *dbus_manager);
 const gchar *
 msgport_dbus_manager_get_app_id (MsgPortDbusManager *dbus_manager);
 
+guint
+msgport_dbus_manager_get_features (MsgPortDbusManager *dbus_manager);
+
+MsgPortDbusService *
+msgport_dbus_manager_find_remote_service (MsgPortDbusManager *dbus_manager,
+                                          const gchar *remote_app_id,
+                                          const gchar *remote_port_name,
+                                          gboolean is_trusted,
+                                          GError **error_out);
+
 gboolean
 msgport_dbus_manager_validate_peer_certificate (MsgPortDbusManager *dbus_manager,
                                                 const gchar *peer_app_id);
 
+void
+msgport_dbus_manager_share_schemas (MsgPortDbusManager *dbus_manager,
+                                    MsgPortDbusService *peer_dbus_service);
+
+gboolean
+msgport_dbus_manager_reply_expected (GDBusMethodInvocation *invocation);
+
+void
+msgport_dbus_manager_drop_reply (MsgPortDbusManager *dbus_manager,
+                                 GDBusMethodInvocation *invocation,
+                                 gboolean failed);
+
 G_END_DECLS
 
 #endif /* __MSGPORT_DBUS_MANAER_H */
@@ -56,6 +56,7 @@ struct _MsgPortDbusServerPrivate
     GDBusServer    *bus_server;
     gchar          *address;
     GHashTable     *dbus_managers; /* {GDBusConnection,MsgPortDbusManager} */
+    GHashTable     *app_managers;  /* {app_id,GPtrArray[MsgPortDbusManager]} */
 };
 
 static void _on_connection_closed (GDBusConnection *connection,
@@ -116,6 +117,11 @@ _dispose (GObject *object)
         g_clear_object (&self->priv->bus_server);
     }
 
+    if (self->priv->app_managers) {
+        g_hash_table_unref (self->priv->app_managers);
+        self->priv->app_managers = NULL;
+    }
+
     if (self->priv->dbus_managers) {
         g_hash_table_foreach (self->priv->dbus_managers, _clear_watchers, self);
         g_hash_table_unref (self->priv->dbus_managers);
@@ -170,6 +176,8 @@ msgport_dbus_server_init (MsgPortDbusServer *self)
 
     self->priv->dbus_managers = g_hash_table_new_full (
         g_direct_hash, g_direct_equal, NULL, g_object_unref);
+    self->priv->app_managers = g_hash_table_new_full (
+        g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
 }
 
 const gchar *
@@ -180,6 +188,40 @@ msgport_dbus_server_get_address (MsgPortDbusServer *server)
     return g_dbus_server_get_client_address (server->priv->bus_server);
 }
 
+static void
+_add_app_manager (MsgPortDbusServer *server, MsgPortDbusManager *dbus_manager)
+{
+    const gchar *app_id = msgport_dbus_manager_get_app_id (dbus_manager);
+    GPtrArray *managers = NULL;
+
+    if (!app_id) return;
+
+    managers = g_hash_table_lookup (server->priv->app_managers, app_id);
+    if (!managers) {
+        managers = g_ptr_array_new ();
+        g_hash_table_insert (server->priv->app_managers, g_strdup (app_id), managers);
+    }
+
+    g_ptr_array_add (managers, dbus_manager);
+}
+
+static void
+_remove_app_manager (MsgPortDbusServer *server, MsgPortDbusManager *dbus_manager)
+{
+    const gchar *app_id = msgport_dbus_manager_get_app_id (dbus_manager);
+    GPtrArray *managers = NULL;
+
+    if (!app_id) return;
+
+    managers = g_hash_table_lookup (server->priv->app_managers, app_id);
+    if (!managers) return;
+
+    /* keep the order, the oldest connection of an app is the preferred one */
+    g_ptr_array_remove (managers, dbus_manager);
+    if (managers->len == 0)
+        g_hash_table_remove (server->priv->app_managers, app_id);
+}
+
 static void
 _on_connection_closed (GDBusConnection *connection,
                        gboolean         remote_peer_vanished,
@@ -187,11 +229,15 @@ _on_connection_closed (GDBusConnection *connection,
                        gpointer         user_data)
 {
     MsgPortDbusServer *server = MSGPORT_DBUS_SERVER (user_data);
+    MsgPortDbusManager *dbus_manager = NULL;
 
     g_signal_handlers_disconnect_by_func (connection, _on_connection_closed, user_data);
     DBG("dbus connection(%p) closed (peer vanished : %d) : %s",
             connection, remote_peer_vanished, error ? error->message : "unknwon reason");
 
+    dbus_manager = g_hash_table_lookup (server->priv->dbus_managers, connection);
+    if (dbus_manager) _remove_app_manager (server, dbus_manager);
+
     g_hash_table_remove (server->priv->dbus_managers, connection);
 }
 
@@ -214,6 +260,7 @@ msgport_dbus_server_start_dbus_manager_for_connection (
     }
 
     g_hash_table_insert (server->priv->dbus_managers, connection, dbus_manager);
+    _add_app_manager (server, dbus_manager);
 
     g_signal_connect (connection, "closed", G_CALLBACK(_on_connection_closed), server);
 }
@@ -308,20 +355,24 @@ msgport_dbus_server_new () {
     return server;
 }
 
-static gboolean
-_find_dbus_manager_by_app_id (
-    GDBusConnection *key,
-    MsgPortDbusManager *value,
-    const gchar *app_id_to_find)
+MsgPortDbusManager *
+msgport_dbus_server_get_dbus_manager_by_app_id (MsgPortDbusServer *server, const gchar *app_id)
 {
-    return !g_strcmp0 (msgport_dbus_manager_get_app_id (value), app_id_to_find);
+    GPtrArray *managers = NULL;
+
+    g_return_val_if_fail (server && MSGPORT_IS_DBUS_SERVER (server), NULL);
+
+    managers = msgport_dbus_server_get_dbus_managers_by_app_id (server, app_id);
+
+    return managers ? (MsgPortDbusManager *)g_ptr_array_index (managers, 0) : NULL;
 }
 
-MsgPortDbusManager *
-msgport_dbus_server_get_dbus_manager_by_app_id (MsgPortDbusServer *server, const gchar *app_id)
+GPtrArray *
+msgport_dbus_server_get_dbus_managers_by_app_id (MsgPortDbusServer *server, const gchar *app_id)
 {
     g_return_val_if_fail (server && MSGPORT_IS_DBUS_SERVER (server), NULL);
 
-    return (MsgPortDbusManager *)g_hash_table_find (server->priv->dbus_managers,
-            (GHRFunc)_find_dbus_manager_by_app_id, (gpointer)app_id);
+    if (!app_id) return NULL;
+
+    return (GPtrArray *)g_hash_table_lookup (server->priv->app_managers, app_id);
 }
@@ -70,4 +70,7 @@ MsgPortManager    * msgport_dbus_server_get_manager (MsgPortDbusServer *server);
 MsgPortDbusManager *
 msgport_dbus_server_get_dbus_manager_by_app_id (MsgPortDbusServer *server, const gchar *app_id);
 
+GPtrArray *
+msgport_dbus_server_get_dbus_managers_by_app_id (MsgPortDbusServer *server, const gchar *app_id);
+
 #endif /* __MSGPORT_DBUS_SERVER_H */
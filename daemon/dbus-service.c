@@ -25,11 +25,18 @@
 
 #include "dbus-service.h"
 #include "common/dbus-service-glue.h"
+#include "common/bundle-variant.h"
 #include "common/dbus-error.h"
+#include "common/delta.h"
+#include "common/features.h"
 #include "common/log.h"
+#include "common/memfd.h"
 #include "manager.h"
 #include "utils.h"
 
+#include <gio/gunixfdlist.h>
+#include <unistd.h> /* close */
+
 G_DEFINE_TYPE (MsgPortDbusService, msgport_dbus_service, G_TYPE_OBJECT)
 
 #define MSGPORT_DBUS_SERVICE_GET_PRIV(obj) \
@@ -41,6 +48,8 @@ struct _MsgPortDbusServicePrivate {
     MsgPortDbusManager     *owner;
     gchar                  *port_name;
     gboolean                is_trusted;
+    MsgPortDeltaTable      *deltas; /* bases of the deltas patched for the client, created on demand */
+    gboolean                plain_maps; /* client reads values key by key, decode bundles for it */
 };
 
 
@@ -54,6 +63,11 @@ _dbus_service_finalize (GObject *self)
         dbus_service->priv->port_name = NULL;
     }
 
+    if (dbus_service->priv->deltas) {
+        msgport_delta_table_free (dbus_service->priv->deltas);
+        dbus_service->priv->deltas = NULL;
+    }
+
     G_OBJECT_CLASS (msgport_dbus_service_parent_class)->finalize (self);
 }
 
@@ -83,24 +97,33 @@ _dbus_service_handle_send_message (
     MsgPortDbusService *peer_dbus_service = NULL;
     MsgPortManager *manager = NULL;
     GError *error = NULL;
+    gboolean no_reply = FALSE;
 
     msgport_return_val_if_fail (dbus_service &&  MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE);
 
     DBG ("Send Message rquest on service %p to remote service id : %d", dbus_service, remote_service_id);
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
     manager = msgport_dbus_manager_get_manager (dbus_service->priv->owner);
-    peer_dbus_service = msgport_manager_get_service_by_id (manager, remote_service_id, &error);
+    peer_dbus_service = msgport_manager_get_service_by_id (manager, remote_service_id, no_reply ? NULL : &error);
 
     if (peer_dbus_service) {
+        msgport_dbus_manager_share_schemas (dbus_service->priv->owner, peer_dbus_service);
         if (msgport_dbus_service_send_message (peer_dbus_service, data,
                 msgport_dbus_service_get_app_id (dbus_service),
                 dbus_service->priv->port_name,
-                dbus_service->priv->is_trusted, &error)) {
-            msgport_dbus_glue_service_complete_send_message (
+                dbus_service->priv->is_trusted, no_reply ? NULL : &error)) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_service->priv->owner, invocation, FALSE);
+            else msgport_dbus_glue_service_complete_send_message (
                     dbus_service->priv->dbus_skeleton, invocation);
 
             return TRUE;
         }
     }
+
+    if (no_reply) {
+        msgport_dbus_manager_drop_reply (dbus_service->priv->owner, invocation, TRUE);
+        return TRUE;
+    }
     
     if (!error) error = msgport_error_unknown_new ();
     g_dbus_method_invocation_take_error (invocation, error);
@@ -108,15 +131,209 @@ _dbus_service_handle_send_message (
     return TRUE;
 }
 
+static gboolean
+_dbus_service_handle_send_message_to (
+    MsgPortDbusService    *dbus_service,
+    GDBusMethodInvocation *invocation,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               remote_is_trusted,
+    GVariant              *data,
+    gpointer               userdata)
+{
+    MsgPortDbusService *peer_dbus_service = NULL;
+    GError *error = NULL;
+    gboolean no_reply = FALSE;
+
+    msgport_return_val_if_fail (dbus_service &&  MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE);
+
+    DBG ("Send Message rquest on service %p to remote '%s' '%s', is_trusted: %d",
+            dbus_service, remote_app_id, remote_port_name, remote_is_trusted);
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_service->priv->owner,
+            remote_app_id, remote_port_name, remote_is_trusted, no_reply ? NULL : &error);
+
+    if (peer_dbus_service) {
+        msgport_dbus_manager_share_schemas (dbus_service->priv->owner, peer_dbus_service);
+        if (msgport_dbus_service_send_message (peer_dbus_service, data,
+                msgport_dbus_service_get_app_id (dbus_service),
+                dbus_service->priv->port_name,
+                dbus_service->priv->is_trusted, no_reply ? NULL : &error)) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_service->priv->owner, invocation, FALSE);
+            else msgport_dbus_glue_service_complete_send_message_to (
+                    dbus_service->priv->dbus_skeleton, invocation,
+                    msgport_dbus_service_get_id (peer_dbus_service));
+
+            return TRUE;
+        }
+    }
+
+    if (no_reply) {
+        msgport_dbus_manager_drop_reply (dbus_service->priv->owner, invocation, TRUE);
+        return TRUE;
+    }
+
+    if (!error) error = msgport_error_unknown_new ();
+    g_dbus_method_invocation_take_error (invocation, error);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_service_handle_send_large_message_to (
+    MsgPortDbusService    *dbus_service,
+    GDBusMethodInvocation *invocation,
+    GUnixFDList           *fd_list,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               remote_is_trusted,
+    GVariant              *payload,
+    guint64                size,
+    gpointer               userdata)
+{
+    MsgPortDbusService *peer_dbus_service = NULL;
+    GError *error = NULL;
+    gboolean no_reply = FALSE;
+    gint fd = -1;
+
+    msgport_return_val_if_fail (dbus_service &&  MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE);
+
+    DBG ("Send large message request on service %p to remote '%s' '%s', is_trusted: %d, size: %"G_GUINT64_FORMAT,
+            dbus_service, remote_app_id, remote_port_name, remote_is_trusted, size);
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_service->priv->owner,
+            remote_app_id, remote_port_name, remote_is_trusted, &error);
+
+    if (peer_dbus_service && fd_list)
+        fd = g_unix_fd_list_get (fd_list, g_variant_get_handle (payload), &error);
+
+    if (fd >= 0) {
+        gboolean sent;
+
+        msgport_dbus_manager_share_schemas (dbus_service->priv->owner, peer_dbus_service);
+        sent = msgport_dbus_service_send_large_message (peer_dbus_service, fd, size,
+                msgport_dbus_service_get_app_id (dbus_service),
+                dbus_service->priv->port_name,
+                dbus_service->priv->is_trusted, &error);
+        close (fd);
+
+        if (sent) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_service->priv->owner, invocation, FALSE);
+            else msgport_dbus_glue_service_complete_send_large_message_to (
+                    dbus_service->priv->dbus_skeleton, invocation, NULL,
+                    msgport_dbus_service_get_id (peer_dbus_service));
+
+            return TRUE;
+        }
+    }
+
+    if (no_reply) {
+        g_clear_error (&error);
+        msgport_dbus_manager_drop_reply (dbus_service->priv->owner, invocation, TRUE);
+        return TRUE;
+    }
+
+    if (!error) error = msgport_error_unknown_new ();
+    g_dbus_method_invocation_take_error (invocation, error);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_service_handle_send_message_with_fds_to (
+    MsgPortDbusService    *dbus_service,
+    GDBusMethodInvocation *invocation,
+    GUnixFDList           *fd_list,
+    const gchar           *remote_app_id,
+    const gchar           *remote_port_name,
+    gboolean               remote_is_trusted,
+    GVariant              *data,
+    GVariant              *fds,
+    gpointer               userdata)
+{
+    MsgPortDbusService *peer_dbus_service = NULL;
+    GError *error = NULL;
+    gboolean no_reply = FALSE;
+
+    msgport_return_val_if_fail (dbus_service &&  MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE);
+
+    DBG ("Send message with fds request on service %p to remote '%s' '%s', is_trusted: %d",
+            dbus_service, remote_app_id, remote_port_name, remote_is_trusted);
+    no_reply = !msgport_dbus_manager_reply_expected (invocation);
+    peer_dbus_service = msgport_dbus_manager_find_remote_service (dbus_service->priv->owner,
+            remote_app_id, remote_port_name, remote_is_trusted, no_reply ? NULL : &error);
+
+    if (peer_dbus_service) {
+        msgport_dbus_manager_share_schemas (dbus_service->priv->owner, peer_dbus_service);
+        if (msgport_dbus_service_send_message_with_fds (peer_dbus_service, data, fds, fd_list,
+                msgport_dbus_service_get_app_id (dbus_service),
+                dbus_service->priv->port_name,
+                dbus_service->priv->is_trusted, no_reply ? NULL : &error)) {
+            if (no_reply) msgport_dbus_manager_drop_reply (dbus_service->priv->owner, invocation, FALSE);
+            else msgport_dbus_glue_service_complete_send_message_with_fds_to (
+                    dbus_service->priv->dbus_skeleton, invocation, NULL,
+                    msgport_dbus_service_get_id (peer_dbus_service));
+
+            return TRUE;
+        }
+    }
+
+    if (no_reply) {
+        msgport_dbus_manager_drop_reply (dbus_service->priv->owner, invocation, TRUE);
+        return TRUE;
+    }
+
+    if (!error) error = msgport_error_unknown_new ();
+    g_dbus_method_invocation_take_error (invocation, error);
+
+    return TRUE;
+}
+
+static gboolean
+_dbus_service_handle_set_plain_maps (
+    MsgPortDbusService    *dbus_service,
+    GDBusMethodInvocation *invocation,
+    gboolean               plain_maps,
+    gpointer               userdata)
+{
+    msgport_return_val_if_fail (dbus_service && MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE);
+
+    DBG ("Service %p(%d) takes %s maps", dbus_service, dbus_service->priv->id, plain_maps ? "plain" : "any");
+    dbus_service->priv->plain_maps = plain_maps;
+
+    msgport_dbus_glue_service_complete_set_plain_maps (dbus_service->priv->dbus_skeleton, invocation);
+
+    return TRUE;
+}
+
 static gboolean
 _dbus_service_handle_unregister (
     MsgPortDbusService    *dbus_service,
     GDBusMethodInvocation *invocation,
     gpointer               userdata)
 {
+    MsgPortManager *manager = NULL;
+    GError *error = NULL;
+
     msgport_return_val_if_fail (dbus_service && MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE);
 
-    /* FIXME unregister */
+    DBG ("Unregister request on service %p(%d)", dbus_service, dbus_service->priv->id);
+    manager = msgport_dbus_manager_get_manager (dbus_service->priv->owner);
+
+    /* manager holds the last reference, keep the service alive till we reply */
+    g_object_ref (dbus_service);
+
+    if (msgport_manager_unregister_service (manager, dbus_service->priv->id, &error)) {
+        msgport_dbus_glue_service_complete_unregister (
+                dbus_service->priv->dbus_skeleton, invocation);
+    }
+    else {
+        if (!error) error = msgport_error_unknown_new ();
+        g_dbus_method_invocation_take_error (invocation, error);
+    }
+
+    g_object_unref (dbus_service);
+
     return TRUE;
 }
 
@@ -129,9 +346,18 @@ msgport_dbus_service_init (MsgPortDbusService *self)
     priv->owner = NULL;
     priv->id = 0;
     priv->port_name = NULL;
+    priv->plain_maps = FALSE;
 
     g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-message",
                 G_CALLBACK (_dbus_service_handle_send_message), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-message-to",
+                G_CALLBACK (_dbus_service_handle_send_message_to), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-large-message-to",
+                G_CALLBACK (_dbus_service_handle_send_large_message_to), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-send-message-with-fds-to",
+                G_CALLBACK (_dbus_service_handle_send_message_with_fds_to), (gpointer)self);
+    g_signal_connect_swapped (priv->dbus_skeleton, "handle-set-plain-maps",
+                G_CALLBACK (_dbus_service_handle_set_plain_maps), (gpointer)self);
     g_signal_connect_swapped (priv->dbus_skeleton, "handle-unregister",
                 G_CALLBACK (_dbus_service_handle_unregister), (gpointer)self);
 
@@ -257,6 +483,122 @@ msgport_dbus_service_get_is_trusted (MsgPortDbusService *dbus_service)
     return dbus_service->priv->is_trusted;
 }
 
+/*
+ * Features of the owner, narrowed for ports that read plain maps.
+ */
+static guint
+_dbus_service_get_features (MsgPortDbusService *dbus_service)
+{
+    guint features = msgport_dbus_manager_get_features (dbus_service->priv->owner);
+
+    if (dbus_service->priv->plain_maps) features &= ~MSGPORT_FEATURE_ENCODED_BUNDLE;
+
+    return features;
+}
+
+static const gchar * const *
+_dbus_service_lookup_schema (guint schema_id, gpointer userdata)
+{
+    return msgport_manager_get_schema ((MsgPortManager *)userdata, schema_id);
+}
+
+/*
+ * Returns a new reference to the delta in data, inflated if it was
+ * compressed, or NULL if data is no delta.
+ */
+static GVariant *
+_dbus_service_get_delta (GVariant *data)
+{
+    GVariant *message = msgport_variant_map_decompress (data);
+
+    if (!message) message = g_variant_ref (data);
+    if (msgport_variant_map_is_delta (message)) return message;
+
+    g_variant_unref (message);
+
+    return NULL;
+}
+
+/*
+ * Encoded, compressed, schema and delta bundles are only passed to clients
+ * that negotiated them, others get the plain map. The bases of the deltas
+ * are followed for the clients that patch those themselves too. Returns
+ * a new reference, or NULL if data is a delta to a message the receiver
+ * does not have.
+ */
+static GVariant *
+_dbus_service_prepare_message (MsgPortDbusService *dbus_service, GVariant *data, const gchar *r_app_id)
+{
+    MsgPortDbusManager *owner = dbus_service->priv->owner;
+    guint features = _dbus_service_get_features (dbus_service);
+    GVariant *delta = _dbus_service_get_delta (data);
+    GVariant *message = NULL;
+    GVariant *plain = NULL;
+
+    if (delta) {
+        if (!dbus_service->priv->deltas) dbus_service->priv->deltas = msgport_delta_table_new ();
+
+        if (features & MSGPORT_FEATURE_DELTA_BUNDLE) {
+            gboolean has_base = msgport_delta_table_track (dbus_service->priv->deltas, r_app_id, delta);
+
+            g_variant_unref (delta);
+            if (!has_base) return NULL;
+            message = g_variant_ref (data);
+        }
+        else {
+            message = msgport_delta_table_apply (dbus_service->priv->deltas, r_app_id, delta);
+            g_variant_unref (delta);
+            if (!message) return NULL;
+        }
+    }
+    else message = g_variant_ref (data);
+
+    plain = msgport_variant_map_unpack (message, features,
+            _dbus_service_lookup_schema, msgport_dbus_manager_get_manager (owner));
+    if (!plain) return message;
+
+    g_variant_unref (message);
+
+    return plain;
+}
+
+static GVariant *
+_dbus_service_prepare_messages (MsgPortDbusService *dbus_service, GVariant *messages, const gchar *r_app_id)
+{
+    GVariantBuilder builder;
+    GVariantIter iter;
+    GVariant *data = NULL;
+    GVariant *plain = NULL;
+    guint features = _dbus_service_get_features (dbus_service);
+
+    if ((features & MSGPORT_FEATURES_PACKING) == MSGPORT_FEATURES_PACKING) {
+        /* passed as they are, only the bases of the deltas are followed */
+        g_variant_iter_init (&iter, messages);
+        while ((data = g_variant_iter_next_value (&iter)) != NULL) {
+            plain = _dbus_service_prepare_message (dbus_service, data, r_app_id);
+            if (plain) g_variant_unref (plain);
+            else WARN ("Receiver %p misses the base of a delta in batch", dbus_service);
+            g_variant_unref (data);
+        }
+
+        return g_variant_ref (messages);
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+    g_variant_iter_init (&iter, messages);
+    while ((data = g_variant_iter_next_value (&iter)) != NULL) {
+        plain = _dbus_service_prepare_message (dbus_service, data, r_app_id);
+        if (plain) {
+            g_variant_builder_add_value (&builder, plain);
+            g_variant_unref (plain);
+        }
+        else WARN ("Dropping delta without its base from batch to %p", dbus_service);
+        g_variant_unref (data);
+    }
+
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
 gboolean
 msgport_dbus_service_send_message (
     MsgPortDbusService *dbus_service,
@@ -275,8 +617,282 @@ msgport_dbus_service_send_message (
     }
 
     DBG ("Sending message to %p from ('%s':'%s':%d)", dbus_service, r_app_id, r_port, r_is_trusted);
+    data = _dbus_service_prepare_message (dbus_service, data, r_app_id);
+    if (!data) {
+        /* the sender answers with a key frame */
+        if (error) *error = msgport_error_delta_base_not_found_new ();
+        return FALSE;
+    }
     msgport_dbus_glue_service_emit_on_message (dbus_service->priv->dbus_skeleton, data, r_app_id, r_port, r_is_trusted);
+    g_variant_unref (data);
  
     return TRUE;
 }
 
+/*
+ * gdbus-codegen generated emitters can not attach file descriptors,
+ * so such signals are built here.
+ */
+static gboolean
+_dbus_service_emit_with_fds (
+    MsgPortDbusService *dbus_service,
+    const gchar *signal_name,
+    GVariant *body,
+    GUnixFDList *fd_list,
+    GError **error)
+{
+    GDBusMessage *msg = NULL;
+    GDBusInterfaceSkeleton *skeleton = G_DBUS_INTERFACE_SKELETON (dbus_service->priv->dbus_skeleton);
+    gboolean res = FALSE;
+
+    msg = g_dbus_message_new_signal (g_dbus_interface_skeleton_get_object_path (skeleton),
+            g_dbus_interface_skeleton_get_info (skeleton)->name, signal_name);
+    g_dbus_message_set_body (msg, body);
+    g_dbus_message_set_unix_fd_list (msg, fd_list);
+
+    res = g_dbus_connection_send_message (msgport_dbus_service_get_connection (dbus_service),
+            msg, G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, error);
+
+    g_object_unref (msg);
+
+    return res;
+}
+
+/*
+ * Only the descriptor is forwarded to clients that negotiated large messages
+ * along with every way of packing them, as the payload is passed as the sender
+ * packed it. For others the payload is mapped and sent as a plain message.
+ */
+gboolean
+msgport_dbus_service_send_large_message (
+    MsgPortDbusService *dbus_service,
+    gint payload_fd,
+    guint64 size,
+    const gchar *r_app_id,
+    const gchar *r_port,
+    gboolean r_is_trusted,
+    GError **error)
+{
+    GUnixFDList *fd_list = NULL;
+    GVariant *data = NULL;
+    GVariant *prepared = NULL;
+    gboolean res = FALSE;
+    guint features;
+
+    msgport_return_val_if_fail_with_error (dbus_service && MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE, error);
+
+    data = msgport_variant_from_memfd (payload_fd, (gsize)size, G_VARIANT_TYPE_VARDICT);
+    if (!data) {
+        if (error) *error = msgport_error_new (MSGPORT_ERROR_INVALID_PARAMS, "invalid message payload");
+        return FALSE;
+    }
+
+    features = _dbus_service_get_features (dbus_service);
+    if ((features & (MSGPORT_FEATURES_PACKING | MSGPORT_FEATURE_LARGE_MESSAGE)) !=
+        (MSGPORT_FEATURES_PACKING | MSGPORT_FEATURE_LARGE_MESSAGE)) {
+        DBG ("Receiver %p does not take large messages, sending %"G_GUINT64_FORMAT" bytes inline", dbus_service, size);
+        res = msgport_dbus_service_send_message (dbus_service, data, r_app_id, r_port, r_is_trusted, error);
+        g_variant_unref (data);
+
+        return res;
+    }
+
+    if (dbus_service->priv->is_trusted &&
+        !msgport_dbus_manager_validate_peer_certificate (dbus_service->priv->owner, r_app_id)) {
+        g_variant_unref (data);
+        if (error) *error = msgport_error_certificate_mismatch_new ();
+        return FALSE;
+    }
+
+    /* only mapped to follow the base, if the payload is a delta */
+    prepared = _dbus_service_prepare_message (dbus_service, data, r_app_id);
+    g_variant_unref (data);
+    if (!prepared) {
+        if (error) *error = msgport_error_delta_base_not_found_new ();
+        return FALSE;
+    }
+    g_variant_unref (prepared);
+
+    fd_list = g_unix_fd_list_new ();
+    if (g_unix_fd_list_append (fd_list, payload_fd, error) < 0) {
+        g_object_unref (fd_list);
+        return FALSE;
+    }
+
+    DBG ("Sending large message of size %"G_GUINT64_FORMAT" to %p from ('%s':'%s':%d)",
+            size, dbus_service, r_app_id, r_port, r_is_trusted);
+
+    res = _dbus_service_emit_with_fds (dbus_service, "onLargeMessage",
+            g_variant_new ("(htssb)", 0, size, r_app_id, r_port, r_is_trusted), fd_list, error);
+
+    g_object_unref (fd_list);
+
+    return res;
+}
+
+/*
+ * Forwards the descriptors received from the sender as they are,
+ * the handles in fds refer to fd_list. Clients that did not negotiate
+ * descriptors get the message alone with onMessage.
+ */
+gboolean
+msgport_dbus_service_send_message_with_fds (
+    MsgPortDbusService *dbus_service,
+    GVariant *data,
+    GVariant *fds,
+    GUnixFDList *fd_list,
+    const gchar *r_app_id,
+    const gchar *r_port,
+    gboolean r_is_trusted,
+    GError **error)
+{
+    GVariant *body = NULL;
+
+    msgport_return_val_if_fail_with_error (dbus_service && MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE, error);
+
+    if (dbus_service->priv->is_trusted &&
+        !msgport_dbus_manager_validate_peer_certificate (dbus_service->priv->owner, r_app_id)) {
+        if (error) *error = msgport_error_certificate_mismatch_new ();
+        return FALSE;
+    }
+
+    DBG ("Sending message with %lu fds to %p from ('%s':'%s':%d)", (gulong)g_variant_n_children (fds),
+            dbus_service, r_app_id, r_port, r_is_trusted);
+
+    data = _dbus_service_prepare_message (dbus_service, data, r_app_id);
+    if (!data) {
+        if (error) *error = msgport_error_delta_base_not_found_new ();
+        return FALSE;
+    }
+
+    if (!(_dbus_service_get_features (dbus_service) & MSGPORT_FEATURE_FDS)) {
+        WARN ("Receiver %p does not take file descriptors, dropping %lu of them", dbus_service,
+                (gulong)g_variant_n_children (fds));
+        msgport_dbus_glue_service_emit_on_message (dbus_service->priv->dbus_skeleton, data, r_app_id, r_port, r_is_trusted);
+        g_variant_unref (data);
+        return TRUE;
+    }
+
+    body = g_variant_new ("(@a{sv}@ahssb)", data, fds, r_app_id, r_port, r_is_trusted);
+    g_variant_unref (data);
+
+    return _dbus_service_emit_with_fds (dbus_service, "onMessageWithFds", body, fd_list, error);
+}
+
+/*
+ * fd_list holds the ring and its doorbell, in this order.
+ */
+gboolean
+msgport_dbus_service_open_channel (
+    MsgPortDbusService *dbus_service,
+    guint channel_id,
+    GUnixFDList *fd_list,
+    const gchar *r_app_id,
+    const gchar *r_port,
+    gboolean r_is_trusted,
+    GError **error)
+{
+    msgport_return_val_if_fail_with_error (dbus_service && MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE, error);
+
+    if (dbus_service->priv->is_trusted &&
+        !msgport_dbus_manager_validate_peer_certificate (dbus_service->priv->owner, r_app_id)) {
+        if (error) *error = msgport_error_certificate_mismatch_new ();
+        return FALSE;
+    }
+
+    DBG ("Opening channel %u to %p from ('%s':'%s':%d)", channel_id, dbus_service, r_app_id, r_port, r_is_trusted);
+
+    return _dbus_service_emit_with_fds (dbus_service, "onChannelOpened",
+            g_variant_new ("(uhhssb)", channel_id, 0, 1, r_app_id, r_port, r_is_trusted), fd_list, error);
+}
+
+void
+msgport_dbus_service_revoke_channel (
+    MsgPortDbusService *dbus_service,
+    guint channel_id)
+{
+    g_return_if_fail (dbus_service && MSGPORT_IS_DBUS_SERVICE (dbus_service));
+
+    DBG ("Revoking channel %u to %p", channel_id, dbus_service);
+
+    msgport_dbus_glue_service_emit_on_channel_revoked (dbus_service->priv->dbus_skeleton, channel_id);
+}
+
+/*
+ * fd_list holds the receiving end of the socket pair, streams carry
+ * raw chunks instead of messages.
+ */
+gboolean
+msgport_dbus_service_open_peer_channel (
+    MsgPortDbusService *dbus_service,
+    guint channel_id,
+    gboolean is_stream,
+    GUnixFDList *fd_list,
+    const gchar *r_app_id,
+    const gchar *r_port,
+    gboolean r_is_trusted,
+    GError **error)
+{
+    msgport_return_val_if_fail_with_error (dbus_service && MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE, error);
+
+    if (dbus_service->priv->is_trusted &&
+        !msgport_dbus_manager_validate_peer_certificate (dbus_service->priv->owner, r_app_id)) {
+        if (error) *error = msgport_error_certificate_mismatch_new ();
+        return FALSE;
+    }
+
+    DBG ("Connecting %s %u to %p from ('%s':'%s':%d)", is_stream ? "stream" : "peer channel",
+            channel_id, dbus_service, r_app_id, r_port, r_is_trusted);
+
+    return _dbus_service_emit_with_fds (dbus_service, is_stream ? "onStreamOpened" : "onPeerConnected",
+            g_variant_new ("(uhssb)", channel_id, 0, r_app_id, r_port, r_is_trusted), fd_list, error);
+}
+
+/*
+ * Clients that did not negotiate batches get one onMessage per message.
+ */
+gboolean
+msgport_dbus_service_send_messages (
+    MsgPortDbusService *dbus_service,
+    GVariant *messages,
+    const gchar *r_app_id,
+    const gchar *r_port,
+    gboolean r_is_trusted,
+    GError **error)
+{
+    GVariantIter iter;
+    GVariant *data = NULL;
+
+    msgport_return_val_if_fail_with_error (dbus_service && MSGPORT_IS_DBUS_SERVICE (dbus_service), FALSE, error);
+
+    if (dbus_service->priv->is_trusted &&
+        !msgport_dbus_manager_validate_peer_certificate (dbus_service->priv->owner, r_app_id)) {
+        if (error) *error = msgport_error_certificate_mismatch_new ();
+        return FALSE;
+    }
+
+    DBG ("Sending %lu messages to %p from ('%s':'%s':%d)", (gulong)g_variant_n_children (messages),
+            dbus_service, r_app_id, r_port, r_is_trusted);
+
+    if (!(_dbus_service_get_features (dbus_service) & MSGPORT_FEATURE_BATCH)) {
+        g_variant_iter_init (&iter, messages);
+        while ((data = g_variant_iter_next_value (&iter)) != NULL) {
+            GVariant *plain = _dbus_service_prepare_message (dbus_service, data, r_app_id);
+            if (plain) {
+                msgport_dbus_glue_service_emit_on_message (dbus_service->priv->dbus_skeleton,
+                        plain, r_app_id, r_port, r_is_trusted);
+                g_variant_unref (plain);
+            }
+            else WARN ("Dropping delta without its base from batch to %p", dbus_service);
+            g_variant_unref (data);
+        }
+
+        return TRUE;
+    }
+
+    messages = _dbus_service_prepare_messages (dbus_service, messages, r_app_id);
+    msgport_dbus_glue_service_emit_on_messages (dbus_service->priv->dbus_skeleton, messages, r_app_id, r_port, r_is_trusted);
+    g_variant_unref (messages);
+
+    return TRUE;
+}
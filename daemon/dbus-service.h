@@ -29,6 +29,7 @@
 #include <glib.h>
 #include <gio/gio.h>
 #include <glib-object.h>
+#include <gio/gunixfdlist.h>
 #include "dbus-manager.h"
 
 G_BEGIN_DECLS
@@ -93,6 +94,56 @@ msgport_dbus_service_send_message (MsgPortDbusService *dbus_service,
                                    gboolean     remote_is_trusted,
                                    GError     **error_out);
 
+gboolean
+msgport_dbus_service_send_large_message (MsgPortDbusService *dbus_service,
+                                         gint         payload_fd,
+                                         guint64      size,
+                                         const gchar *remote_app_id,
+                                         const gchar *remote_port_name,
+                                         gboolean     remote_is_trusted,
+                                         GError     **error_out);
+
+gboolean
+msgport_dbus_service_send_message_with_fds (MsgPortDbusService *dbus_service,
+                                            GVariant    *data,
+                                            GVariant    *fds,
+                                            GUnixFDList *fd_list,
+                                            const gchar *remote_app_id,
+                                            const gchar *remote_port_name,
+                                            gboolean     remote_is_trusted,
+                                            GError     **error_out);
+
+gboolean
+msgport_dbus_service_open_channel (MsgPortDbusService *dbus_service,
+                                   guint        channel_id,
+                                   GUnixFDList *fd_list,
+                                   const gchar *remote_app_id,
+                                   const gchar *remote_port_name,
+                                   gboolean     remote_is_trusted,
+                                   GError     **error_out);
+
+void
+msgport_dbus_service_revoke_channel (MsgPortDbusService *dbus_service,
+                                     guint        channel_id);
+
+gboolean
+msgport_dbus_service_open_peer_channel (MsgPortDbusService *dbus_service,
+                                        guint        channel_id,
+                                        gboolean     is_stream,
+                                        GUnixFDList *fd_list,
+                                        const gchar *remote_app_id,
+                                        const gchar *remote_port_name,
+                                        gboolean     remote_is_trusted,
+                                        GError     **error_out);
+
+gboolean
+msgport_dbus_service_send_messages (MsgPortDbusService *dbus_service,
+                                    GVariant    *messages,
+                                    const gchar *remote_app_id,
+                                    const gchar *remote_port_name,
+                                    gboolean     remote_is_trusted,
+                                    GError     **error_out);
+
 G_END_DECLS
 
 #endif /* __MSGPORT_DBUS_SERVICE_H */
@@ -24,6 +24,7 @@
  */
 
 #include "manager.h"
+#include "common/bundle-variant.h"
 #include "common/dbus-error.h"
 #include "common/log.h"
 #include "dbus-manager.h"
@@ -35,6 +36,16 @@ G_DEFINE_TYPE (MsgPortManager, msgport_manager, G_TYPE_OBJECT)
 #define MSGPORT_MANAGER_GET_PRIV(obj) \
     G_TYPE_INSTANCE_GET_PRIVATE ((obj), MSGPORT_TYPE_MANAGER, MsgPortManagerPrivate)
 
+enum
+{
+    SIG_SERVICE_REGISTERED,
+    SIG_SERVICE_UNREGISTERED,
+
+    N_SIGNALS
+};
+
+static guint signals[N_SIGNALS];
+
 struct _MsgPortManagerPrivate {
     /*
      * Key :   guint - Id of the service
@@ -45,11 +56,88 @@ struct _MsgPortManagerPrivate {
     /*
      * Holds services owned by a client 
      * Key : MsgPortDbusManager *
-     * Value : GList<MsgPortDbusService *> (tranfer none)
+     * Value : GHashTable<MsgPortServiceKey *, MsgPortDbusService *> (tranfer none)
+     */
+    GHashTable *owner_service_map; /* {MsgPortDbusManager*,{(port_name,is_trusted),MsgPortDbusService}} */
+
+    /*
+     * Message schemas, shared by the clients that registered the same keys
+     * and dropped along with the last of those. Ids are never reused, so that
+     * an id cached by a receiver can not turn into other keys.
      */
-    GHashTable *owner_service_map; /* {MsgPortDbusManager*,GList[MsgPortDbusService]} */
+    GHashTable *schemas; /* {schema_id, MsgPortSchema} */
+    GHashTable *schema_ids; /* {GBytes (serialized keys), MsgPortSchema} (transfer none) */
+    GHashTable *owner_schema_map; /* {MsgPortDbusManager*,{schema_id}} */
+    guint       last_schema_id;
 };
 
+typedef struct {
+    guint   id;
+    gchar **keys;
+    GBytes *serialized;
+    guint   n_owners; /* clients holding the schema */
+} MsgPortSchema;
+
+static void
+_schema_free (MsgPortSchema *schema)
+{
+    g_strfreev (schema->keys);
+    g_bytes_unref (schema->serialized);
+    g_slice_free (MsgPortSchema, schema);
+}
+
+/*
+ * Key used to index the services owned by a client, keys in the table
+ * own their port_name, lookup keys only point to it.
+ */
+typedef struct {
+    gchar    *port_name;
+    gboolean  is_trusted;
+} MsgPortServiceKey;
+
+static guint
+_service_key_hash (gconstpointer key)
+{
+    const MsgPortServiceKey *service_key = (const MsgPortServiceKey *)key;
+
+    return g_str_hash (service_key->port_name) ^ (guint)(service_key->is_trusted != FALSE);
+}
+
+static gboolean
+_service_key_equal (gconstpointer a, gconstpointer b)
+{
+    const MsgPortServiceKey *key_a = (const MsgPortServiceKey *)a;
+    const MsgPortServiceKey *key_b = (const MsgPortServiceKey *)b;
+
+    return g_str_equal (key_a->port_name, key_b->port_name) &&
+           !key_a->is_trusted == !key_b->is_trusted;
+}
+
+static MsgPortServiceKey *
+_service_key_new (const gchar *port_name, gboolean is_trusted)
+{
+    MsgPortServiceKey *key = g_slice_new (MsgPortServiceKey);
+
+    key->port_name = g_strdup (port_name);
+    key->is_trusted = is_trusted;
+
+    return key;
+}
+
+static void
+_service_key_free (MsgPortServiceKey *key)
+{
+    g_free (key->port_name);
+    g_slice_free (MsgPortServiceKey, key);
+}
+
+static GHashTable *
+_owner_services_new ()
+{
+    return g_hash_table_new_full (_service_key_hash, _service_key_equal,
+                (GDestroyNotify)_service_key_free, NULL);
+}
+
 static void
 _manager_finalize (GObject *self)
 {
@@ -69,6 +157,21 @@ _manager_dispose (GObject *self)
     g_hash_table_unref (manager->priv->service_cache);
     manager->priv->service_cache = NULL;
 
+    if (manager->priv->owner_schema_map) {
+        g_hash_table_unref (manager->priv->owner_schema_map);
+        manager->priv->owner_schema_map = NULL;
+    }
+
+    if (manager->priv->schema_ids) {
+        g_hash_table_unref (manager->priv->schema_ids);
+        manager->priv->schema_ids = NULL;
+    }
+
+    if (manager->priv->schemas) {
+        g_hash_table_unref (manager->priv->schemas);
+        manager->priv->schemas = NULL;
+    }
+
     G_OBJECT_CLASS (msgport_manager_parent_class)->dispose (self);
 }
 
@@ -81,7 +184,13 @@ msgport_manager_init (MsgPortManager *self)
                 g_direct_hash, g_direct_equal, NULL, g_object_unref);
     priv->owner_service_map = g_hash_table_new_full (
                 g_direct_hash, g_direct_equal, 
-                NULL, (GDestroyNotify) g_list_free);
+                NULL, (GDestroyNotify) g_hash_table_unref);
+    priv->schemas = g_hash_table_new_full (
+                g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) _schema_free);
+    priv->schema_ids = g_hash_table_new (g_bytes_hash, g_bytes_equal);
+    priv->owner_schema_map = g_hash_table_new_full (
+                g_direct_hash, g_direct_equal,
+                NULL, (GDestroyNotify) g_hash_table_unref);
 
     self->priv = priv;
 }
@@ -95,6 +204,26 @@ msgport_manager_class_init (MsgPortManagerClass *klass)
 
     gklass->finalize = _manager_finalize;
     gklass->dispose = _manager_dispose;
+
+    signals[SIG_SERVICE_REGISTERED] = g_signal_new ("service-registered",
+            MSGPORT_TYPE_MANAGER,
+            G_SIGNAL_RUN_LAST,
+            0,
+            NULL, NULL,
+            g_cclosure_marshal_VOID__OBJECT,
+            G_TYPE_NONE,
+            1, MSGPORT_TYPE_DBUS_SERVICE);
+
+    /* emitted just before a service is dropped, either on its own or
+     * along with all the services of a closed connection */
+    signals[SIG_SERVICE_UNREGISTERED] = g_signal_new ("service-unregistered",
+            MSGPORT_TYPE_MANAGER,
+            G_SIGNAL_RUN_LAST,
+            0,
+            NULL, NULL,
+            g_cclosure_marshal_VOID__OBJECT,
+            G_TYPE_NONE,
+            1, MSGPORT_TYPE_DBUS_SERVICE);
 }
 
 MsgPortManager *
@@ -123,26 +252,27 @@ _manager_get_service_internal (
     const gchar        *port_name,
     gboolean            is_trusted)
 {
-    GList *service_list = g_hash_table_lookup (manager->priv->owner_service_map, owner);
+    MsgPortServiceKey key;
+    MsgPortDbusService *dbus_service = NULL;
+    GHashTable *services = g_hash_table_lookup (manager->priv->owner_service_map, owner);
     
     DBG ("Checking for port '%s', is_tursted : %d owned by : %p('%s')",
             port_name, is_trusted, owner, msgport_dbus_manager_get_app_id (owner));
 
-    while (service_list != NULL) {
-        MsgPortDbusService *dbus_service = MSGPORT_DBUS_SERVICE (service_list->data);
+    if (!services) {
+        DBG ("   Not Found");
+        return NULL;
+    }
 
-        if ( !g_strcmp0 (port_name, msgport_dbus_service_get_port_name (dbus_service)) && 
-             is_trusted == msgport_dbus_service_get_is_trusted (dbus_service)) {
-            DBG ("   Found with %d", msgport_dbus_service_get_id (dbus_service));
-            return dbus_service ;
-        }
+    key.port_name = (gchar *)port_name;
+    key.is_trusted = is_trusted;
 
-        service_list = service_list->next;
-    }
+    dbus_service = g_hash_table_lookup (services, &key);
 
-    DBG ("   Not Found");
+    if (dbus_service) DBG ("   Found with %d", msgport_dbus_service_get_id (dbus_service));
+    else DBG ("   Not Found");
 
-    return NULL;
+    return dbus_service;
 }
 
 MsgPortDbusService *
@@ -153,8 +283,7 @@ msgport_manager_register_service (
     gboolean            is_trusted,
     GError            **error)
 {
-    GList   *service_list  = NULL; /* services list owned by a client */
-    gboolean list_was_empty = TRUE;
+    GHashTable *services  = NULL; /* services owned by a client */
     MsgPortDbusService *dbus_service = NULL;
 
     msgport_return_val_if_fail_with_error (manager && MSGPORT_IS_MANAGER (manager), NULL, error);
@@ -177,15 +306,17 @@ msgport_manager_register_service (
         GINT_TO_POINTER (msgport_dbus_service_get_id (dbus_service)),
         (gpointer)dbus_service);
 
-    service_list = g_hash_table_lookup (manager->priv->owner_service_map, owner);
-    list_was_empty = (service_list == NULL);
-
-   /* append to list of services */
-    service_list = g_list_append (service_list, dbus_service);
-    if (list_was_empty) {
-        g_hash_table_insert (manager->priv->owner_service_map, owner, service_list);
+    services = g_hash_table_lookup (manager->priv->owner_service_map, owner);
+    if (!services) {
+        services = _owner_services_new ();
+        g_hash_table_insert (manager->priv->owner_service_map, owner, services);
     }
 
+    /* index the service on its owner */
+    g_hash_table_insert (services, _service_key_new (port_name, is_trusted), dbus_service);
+
+    g_signal_emit (manager, signals[SIG_SERVICE_REGISTERED], 0, dbus_service);
+
     return dbus_service;
 }
 
@@ -223,17 +354,20 @@ msgport_manager_get_service_by_id (
     msgport_return_val_if_fail_with_error (manager && MSGPORT_IS_MANAGER (manager), NULL, error);
     msgport_return_val_if_fail_with_error (service_id != 0, NULL, error);
 
-    dbus_service = MSGPORT_DBUS_SERVICE (g_hash_table_lookup (
-            manager->priv->service_cache, GINT_TO_POINTER(service_id)));
+    dbus_service = g_hash_table_lookup (
+            manager->priv->service_cache, GINT_TO_POINTER(service_id));
+
+    if (!dbus_service && error)
+        *error = msgport_error_port_id_not_found_new (service_id);
 
     return dbus_service;
 }
 
 static void
-_manager_unref_dbus_manager_cb (gpointer data, gpointer user_data)
+_manager_unref_dbus_manager_cb (gpointer key, gpointer value, gpointer user_data)
 {
     MsgPortManager *manager = MSGPORT_MANAGER (user_data);
-    MsgPortDbusService *service = MSGPORT_DBUS_SERVICE (data);
+    MsgPortDbusService *service = MSGPORT_DBUS_SERVICE (value);
     guint id = msgport_dbus_service_get_id (service);
 
 #ifdef ENABLE_DEBUG
@@ -241,6 +375,8 @@ _manager_unref_dbus_manager_cb (gpointer data, gpointer user_data)
         msgport_dbus_manager_get_app_id (msgport_dbus_service_get_owner (service)),
         msgport_dbus_service_get_port_name (service), id);
 #endif
+    g_signal_emit (manager, signals[SIG_SERVICE_UNREGISTERED], 0, service);
+
     /* remove the service from id:service map,
      * as its being unregisted */
     g_hash_table_remove (manager->priv->service_cache, GINT_TO_POINTER(id));
@@ -252,12 +388,12 @@ _manager_unref_dbus_manager_cb (gpointer data, gpointer user_data)
 gboolean
 msgport_manager_unregister_service (
     MsgPortManager *manager,
-    gint            service_id,
+    guint           service_id,
     GError        **error)
 {
     MsgPortDbusService *service = NULL;
     MsgPortDbusManager *owner = NULL;
-    GList *service_list = NULL, *new_service_list = NULL;
+    GHashTable *services = NULL;
 
     msgport_return_val_if_fail_with_error (manager && MSGPORT_IS_MANAGER (manager), FALSE, error);
 
@@ -270,14 +406,20 @@ msgport_manager_unregister_service (
 
     owner = msgport_dbus_service_get_owner (service);
 
-    service_list = g_hash_table_lookup (manager->priv->owner_service_map, owner);
+    g_signal_emit (manager, signals[SIG_SERVICE_UNREGISTERED], 0, service);
+
+    services = g_hash_table_lookup (manager->priv->owner_service_map, owner);
+
+    /* remove service from services owned by the 'owner'*/
+    if (services) {
+        MsgPortServiceKey key;
+
+        key.port_name = (gchar *)msgport_dbus_service_get_port_name (service);
+        key.is_trusted = msgport_dbus_service_get_is_trusted (service);
 
-    /* remove service from services list owned by the 'owner'*/
-    new_service_list = g_list_remove (service_list, service);
-    if (new_service_list != service_list) {
-        g_hash_table_steal (manager->priv->owner_service_map, owner);
-        /* update the new list on this owner */
-        g_hash_table_insert (manager->priv->owner_service_map, owner, new_service_list);
+        g_hash_table_remove (services, &key);
+        if (g_hash_table_size (services) == 0)
+            g_hash_table_remove (manager->priv->owner_service_map, owner);
     }
 
     /* remove from the service_id:servcie table */
@@ -296,20 +438,176 @@ msgport_manager_unregister_services (
     GError            **error)
 {
 
-    GList *service_list = NULL;
+    GHashTable *services = NULL;
 
     msgport_return_val_if_fail_with_error (manager && MSGPORT_IS_MANAGER (manager), FALSE, error);
 
-    /* fetch sevice list owned by the client */
-    service_list = g_hash_table_lookup (manager->priv->owner_service_map, owner);
-    if (!service_list) {
+    /* fetch sevices owned by the client */
+    services = g_hash_table_lookup (manager->priv->owner_service_map, owner);
+    if (!services) {
         DBG("no services found on client '%p'", owner);
         return TRUE;
     }
 
-    /* remove all the service from the list */
-    g_list_foreach (service_list, _manager_unref_dbus_manager_cb, manager);
+    /* remove all the services owned by the client */
+    g_hash_table_foreach (services, _manager_unref_dbus_manager_cb, manager);
     g_hash_table_remove (manager->priv->owner_service_map, owner);
 
     return TRUE;
 }
+
+/*
+ * Registering the same keys again gives the same id, the schema is
+ * held by the owner till it releases its schemas.
+ */
+guint
+msgport_manager_register_schema (
+    MsgPortManager      *manager,
+    MsgPortDbusManager  *owner,
+    const gchar * const *keys,
+    GError             **error)
+{
+    GVariant *v_keys = NULL;
+    GBytes *serialized = NULL;
+    MsgPortSchema *schema = NULL;
+    GHashTable *owned = NULL;
+
+    msgport_return_val_if_fail_with_error (manager && MSGPORT_IS_MANAGER (manager), 0, error);
+
+    if (!msgport_schema_keys_are_valid (keys)) {
+        if (error) *error = msgport_error_new (MSGPORT_ERROR_INVALID_PARAMS,
+                "schema must have 1 to %d unique keys", MSGPORT_SCHEMA_MAX_KEYS);
+        return 0;
+    }
+
+    v_keys = g_variant_ref_sink (g_variant_new_strv (keys, -1));
+    serialized = g_variant_get_data_as_bytes (v_keys);
+    g_variant_unref (v_keys);
+
+    schema = g_hash_table_lookup (manager->priv->schema_ids, serialized);
+    owned = g_hash_table_lookup (manager->priv->owner_schema_map, owner);
+    if (schema && owned && g_hash_table_contains (owned, GUINT_TO_POINTER (schema->id))) {
+        g_bytes_unref (serialized);
+        return schema->id;
+    }
+
+    if (owned && g_hash_table_size (owned) >= MSGPORT_MAX_SCHEMAS) {
+        g_bytes_unref (serialized);
+        if (error) *error = msgport_error_new (MSGPORT_ERROR_OUT_OF_MEMORY,
+                "no more than %d schemas can be registered", MSGPORT_MAX_SCHEMAS);
+        return 0;
+    }
+
+    if (!schema) {
+        schema = g_slice_new0 (MsgPortSchema);
+        schema->id = ++manager->priv->last_schema_id;
+        schema->keys = g_strdupv ((gchar **)keys);
+        schema->serialized = serialized;
+        g_hash_table_insert (manager->priv->schemas, GUINT_TO_POINTER (schema->id), schema);
+        g_hash_table_insert (manager->priv->schema_ids, schema->serialized, schema);
+
+        DBG ("Registered schema %u of %u keys", schema->id, g_strv_length (schema->keys));
+    }
+    else g_bytes_unref (serialized);
+
+    if (!owned) {
+        owned = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_insert (manager->priv->owner_schema_map, owner, owned);
+    }
+    g_hash_table_add (owned, GUINT_TO_POINTER (schema->id));
+    schema->n_owners++;
+
+    return schema->id;
+}
+
+/*
+ * Drops the schemas no other client holds, messages in flight using those
+ * can not be unpacked anymore.
+ */
+void
+msgport_manager_release_schemas (
+    MsgPortManager     *manager,
+    MsgPortDbusManager *owner)
+{
+    GHashTable *owned = NULL;
+    GHashTableIter iter;
+    gpointer schema_id = NULL;
+
+    g_return_if_fail (manager && MSGPORT_IS_MANAGER (manager));
+
+    owned = g_hash_table_lookup (manager->priv->owner_schema_map, owner);
+    if (!owned) return;
+
+    g_hash_table_iter_init (&iter, owned);
+    while (g_hash_table_iter_next (&iter, &schema_id, NULL)) {
+        MsgPortSchema *schema = g_hash_table_lookup (manager->priv->schemas, schema_id);
+
+        if (!schema || --schema->n_owners > 0) continue;
+
+        DBG ("Dropping schema %u", schema->id);
+        g_hash_table_remove (manager->priv->schema_ids, schema->serialized);
+        g_hash_table_remove (manager->priv->schemas, schema_id);
+    }
+
+    g_hash_table_remove (manager->priv->owner_schema_map, owner);
+}
+
+/*
+ * Makes receiver a holder of the schemas of owner it does not hold yet,
+ * those are shared past the MSGPORT_MAX_SCHEMAS limit of receiver as it
+ * did not ask for them.
+ */
+void
+msgport_manager_share_schemas (
+    MsgPortManager          *manager,
+    MsgPortDbusManager      *owner,
+    MsgPortDbusManager      *receiver,
+    MsgPortManagerSchemaFunc func,
+    gpointer                 userdata)
+{
+    GHashTable *owned = NULL;
+    GHashTable *held = NULL;
+    GHashTableIter iter;
+    gpointer schema_id = NULL;
+
+    g_return_if_fail (manager && MSGPORT_IS_MANAGER (manager));
+
+    owned = g_hash_table_lookup (manager->priv->owner_schema_map, owner);
+    if (!owned || owner == receiver) return;
+
+    held = g_hash_table_lookup (manager->priv->owner_schema_map, receiver);
+
+    g_hash_table_iter_init (&iter, owned);
+    while (g_hash_table_iter_next (&iter, &schema_id, NULL)) {
+        MsgPortSchema *schema = NULL;
+
+        if (held && g_hash_table_contains (held, schema_id)) continue;
+
+        schema = g_hash_table_lookup (manager->priv->schemas, schema_id);
+        if (!schema) continue;
+
+        if (!held) {
+            held = g_hash_table_new (g_direct_hash, g_direct_equal);
+            g_hash_table_insert (manager->priv->owner_schema_map, receiver, held);
+        }
+        g_hash_table_add (held, schema_id);
+        schema->n_owners++;
+
+        DBG ("Sharing schema %u with %p", schema->id, receiver);
+        if (func) func (schema->id, (const gchar * const *)schema->keys, userdata);
+    }
+}
+
+const gchar * const *
+msgport_manager_get_schema (
+    MsgPortManager *manager,
+    guint           schema_id)
+{
+    MsgPortSchema *schema = NULL;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), NULL);
+
+    schema = g_hash_table_lookup (manager->priv->schemas, GUINT_TO_POINTER (schema_id));
+
+    return schema ? (const gchar * const *)schema->keys : NULL;
+}
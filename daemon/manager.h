@@ -44,6 +44,12 @@ typedef struct _MsgPortManagerPrivate MsgPortManagerPrivate;
 typedef struct _MsgPortDbusManager MsgPortDbusManager;
 typedef struct _MsgPortDbusService MsgPortDbusService;
 
+/* most schemas a client can hold */
+#define MSGPORT_MAX_SCHEMAS 256
+
+/* called with each schema a client got to hold */
+typedef void (*MsgPortManagerSchemaFunc) (guint schema_id, const gchar * const *keys, gpointer userdata);
+
 struct _MsgPortManager
 {
     GObject parent;
@@ -84,12 +90,43 @@ msgport_manager_get_service_by_id (
     guint           service_id,
     GError        **error_out);
 
+gboolean
+msgport_manager_unregister_service (
+    MsgPortManager *manager,
+    guint           service_id,
+    GError        **error_out);
+
 gboolean
 msgport_manager_unregister_services (
     MsgPortManager     *manager,
     MsgPortDbusManager *owned_by,
     GError            **error_out);
 
+guint
+msgport_manager_register_schema (
+    MsgPortManager      *manager,
+    MsgPortDbusManager  *owner,
+    const gchar * const *keys,
+    GError             **error_out);
+
+void
+msgport_manager_release_schemas (
+    MsgPortManager     *manager,
+    MsgPortDbusManager *owner);
+
+void
+msgport_manager_share_schemas (
+    MsgPortManager          *manager,
+    MsgPortDbusManager      *owner,
+    MsgPortDbusManager      *receiver,
+    MsgPortManagerSchemaFunc func,
+    gpointer                 userdata);
+
+const gchar * const *
+msgport_manager_get_schema (
+    MsgPortManager *manager,
+    guint           schema_id);
+
 G_END_DECLS
 
 #endif /* __MSGPORT_MANAER_H */
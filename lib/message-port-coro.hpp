@@ -0,0 +1,328 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MESSAGE_PORT_CORO_HPP
+#define __MESSAGE_PORT_CORO_HPP
+
+#if __cplusplus < 202002L
+#error "message-port-coro.hpp needs C++20"
+#endif
+
+#include <message-port.hpp>
+#include <coroutine>
+#include <deque>
+
+/*
+ * C++20 awaitables over the asynchronous C API. Operations start when the
+ * awaitable is created and complete from the main context of the thread
+ * that created them, so one thread running that context can keep any
+ * number of them in flight. Awaitables are not thread safe, create, await
+ * and destroy them on that same thread.
+ */
+namespace messageport {
+
+/*
+ * Resumes a coroutine on its executor. Without one, coroutines are
+ * resumed right away, from the main context dispatching the completion.
+ */
+using Resumer = std::function<void (std::coroutine_handle<>)>;
+
+namespace detail {
+
+inline void resume (const Resumer &resumer, std::coroutine_handle<> handle)
+{
+    if (resumer) resumer (handle);
+    else handle.resume ();
+}
+
+/*
+ * An operation in flight. The awaiter frees it once done; if the awaiter
+ * goes away first, the completion frees it.
+ */
+struct Operation {
+    explicit Operation (Resumer resumer) : resumer (std::move (resumer)) { }
+    virtual ~Operation () = default;
+
+    void complete () {
+        done = true;
+        if (abandoned) delete this;
+        else if (handle) detail::resume (resumer, handle);
+    }
+
+    Resumer                 resumer;
+    std::coroutine_handle<> handle;
+    bool                    done = false;
+    bool                    abandoned = false;
+};
+
+template <typename Op>
+class Awaiter {
+public:
+    Awaiter (Awaiter &&other) noexcept : m_op (std::exchange (other.m_op, nullptr)) { }
+    Awaiter &operator= (Awaiter &&) = delete;
+    Awaiter (const Awaiter &) = delete;
+    Awaiter &operator= (const Awaiter &) = delete;
+
+    ~Awaiter () {
+        if (!m_op) return;
+        if (m_op->done) delete m_op;
+        else m_op->abandoned = true;
+    }
+
+    bool await_ready () const noexcept { return m_op->done; }
+    void await_suspend (std::coroutine_handle<> handle) noexcept { m_op->handle = handle; }
+
+protected:
+    explicit Awaiter (Op *op) : m_op (op) { }
+
+    Op *m_op;
+};
+
+struct SendOperation : Operation {
+    using Operation::Operation;
+
+    static void onDone (messageport_error_e result, void *userdata) noexcept {
+        auto op = static_cast<SendOperation *> (userdata);
+        op->result = result;
+        op->complete ();
+    }
+
+    Error result = MESSAGEPORT_ERROR_NONE;
+};
+
+struct RegisterOperation : Operation {
+    RegisterOperation (bool trusted, LocalPort::Handlers *handlers, Resumer resumer)
+        : Operation (std::move (resumer)), handlers (handlers), trusted (trusted) { }
+
+    /* a port nobody waits for any more is unregistered */
+    ~RegisterOperation () override {
+        if (id <= 0) return;
+        if (trusted) messageport_unregister_trusted_local_port (id);
+        else messageport_unregister_local_port (id);
+    }
+
+    static void onDone (int id, void *userdata) noexcept {
+        auto op = static_cast<RegisterOperation *> (userdata);
+        op->id = id;
+        op->complete ();
+    }
+
+    std::unique_ptr<LocalPort::Handlers> handlers;
+    int  id = 0;
+    bool trusted;
+};
+
+} // namespace detail
+
+class SendAwaiter : public detail::Awaiter<detail::SendOperation> {
+public:
+    /* starts the send, result is the error if it could not be queued */
+    template <typename Start>
+    SendAwaiter (Start &&start, Resumer resumer)
+        : detail::Awaiter<detail::SendOperation> (new detail::SendOperation (std::move (resumer))) {
+        Error result = start (&detail::SendOperation::onDone, static_cast<void *> (m_op));
+        if (result != MESSAGEPORT_ERROR_NONE) {
+            m_op->result = result;
+            m_op->done = true;
+        }
+    }
+
+    Error await_resume () const noexcept { return m_op->result; }
+};
+
+class RegisterAwaiter : public detail::Awaiter<detail::RegisterOperation> {
+public:
+    RegisterAwaiter (const char *name, bool trusted, LocalPort::Handler handler, Resumer resumer)
+        : detail::Awaiter<detail::RegisterOperation> (new detail::RegisterOperation (trusted,
+              new LocalPort::Handlers { std::move (handler), nullptr }, std::move (resumer))) {
+        start (messageport_register_local_port_typed_async (name, trusted, &LocalPort::onMessage,
+                                                            m_op->handlers.get (), &detail::RegisterOperation::onDone, m_op));
+    }
+
+    RegisterAwaiter (const char *name, bool trusted, LocalPort::BundleHandler handler, Resumer resumer)
+        : detail::Awaiter<detail::RegisterOperation> (new detail::RegisterOperation (trusted,
+              new LocalPort::Handlers { nullptr, std::move (handler) }, std::move (resumer))) {
+        start (messageport_register_local_port_with_view_async (name, trusted, &LocalPort::onBundle,
+                                                                m_op->handlers.get (), &detail::RegisterOperation::onDone, m_op));
+    }
+
+    /* the port, check it for the error. A port registered already belongs
+     * to someone else, it gives MESSAGEPORT_ERROR_INVALID_PARAMETER */
+    LocalPort await_resume () noexcept {
+        return LocalPort (std::move (m_op->handlers), std::exchange (m_op->id, 0), m_op->trusted);
+    }
+
+private:
+    void start (Error result) {
+        if (result == MESSAGEPORT_ERROR_NONE) return;
+        m_op->id = result;
+        m_op->done = true;
+    }
+};
+
+/*
+ * Registers a local port, co_await gives the LocalPort. A port this
+ * process registered already is left to its owner, that is an error.
+ */
+inline RegisterAwaiter registerPortAsync (const char *name, bool trusted, LocalPort::Handler handler, Resumer resumer = {})
+{
+    return RegisterAwaiter (name, trusted, std::move (handler), std::move (resumer));
+}
+
+inline RegisterAwaiter registerPortAsync (const char *name, bool trusted, LocalPort::BundleHandler handler, Resumer resumer = {})
+{
+    return RegisterAwaiter (name, trusted, std::move (handler), std::move (resumer));
+}
+
+/*
+ * Sends a message, co_await gives the result. The message can be
+ * destroyed as soon as this returns.
+ */
+inline SendAwaiter sendAsync (const char *appId, const char *port, bool trusted, const Bundle &message, Resumer resumer = {})
+{
+    return SendAwaiter ([&] (messageport_send_done_cb cb, void *userdata) {
+        return messageport_send_message_async (appId, port, trusted, message.get (), cb, userdata);
+    }, std::move (resumer));
+}
+
+inline SendAwaiter sendAsync (const char *appId, const char *port, bool trusted, const MessageView &message, Resumer resumer = {})
+{
+    return SendAwaiter ([&] (messageport_send_done_cb cb, void *userdata) {
+        return messageport_send_typed_message_async (appId, port, trusted, message.get (), cb, userdata);
+    }, std::move (resumer));
+}
+
+/* bidirectional sends, the receiver can reply to from */
+inline SendAwaiter sendAsync (const LocalPort &from, const char *appId, const char *port, bool trusted, const Bundle &message, Resumer resumer = {})
+{
+    return SendAwaiter ([&] (messageport_send_done_cb cb, void *userdata) {
+        return messageport_send_bidirectional_message_async (from.id (), appId, port, trusted, message.get (), cb, userdata);
+    }, std::move (resumer));
+}
+
+inline SendAwaiter sendAsync (const LocalPort &from, const char *appId, const char *port, bool trusted, const MessageView &message, Resumer resumer = {})
+{
+    return SendAwaiter ([&] (messageport_send_done_cb cb, void *userdata) {
+        return messageport_send_bidirectional_typed_message_async (from.id (), appId, port, trusted, message.get (), cb, userdata);
+    }, std::move (resumer));
+}
+
+/*
+ * Queues the messages received by a typed port, for coroutines to wait
+ * on. Register the port with handler(); messages are kept by reference
+ * to the received data, not copied.
+ */
+class Inbox {
+    struct State;
+
+public:
+    struct Received {
+        std::string appId;
+        std::string port;
+        bool        trusted;
+        Message     message;
+    };
+
+    class NextAwaiter {
+    public:
+        NextAwaiter (const NextAwaiter &) = delete;
+        NextAwaiter &operator= (const NextAwaiter &) = delete;
+
+        ~NextAwaiter () {
+            if (!m_handle) return;
+            auto &waiters = m_state->waiters;
+            for (auto it = waiters.begin (); it != waiters.end (); ++it) {
+                if (*it == this) { waiters.erase (it); break; }
+            }
+        }
+
+        bool await_ready () {
+            if (m_state->queue.empty ()) return false;
+            m_received.emplace (std::move (m_state->queue.front ()));
+            m_state->queue.pop_front ();
+            return true;
+        }
+
+        void await_suspend (std::coroutine_handle<> handle) {
+            m_handle = handle;
+            m_state->waiters.push_back (this);
+        }
+
+        Received await_resume () { return std::move (*m_received); }
+
+    private:
+        friend class Inbox;
+        friend struct Inbox::State;
+        NextAwaiter (std::shared_ptr<State> state, Resumer resumer)
+            : m_state (std::move (state)), m_resumer (std::move (resumer)) { }
+
+        std::shared_ptr<State> m_state;
+        Resumer                 m_resumer;
+        std::coroutine_handle<> m_handle;
+        std::optional<Received> m_received;
+    };
+
+    Inbox () : m_state (std::make_shared<State> ()) { }
+
+    /* the handler to register the port with, it may outlive the inbox */
+    LocalPort::Handler handler () const {
+        return [state = m_state] (const Sender &sender, MessageView message) {
+            GVariant *data = messageport_message_get_data (message.get ());
+            if (!data) return;
+            Received received { std::string (sender.appId), std::string (sender.port), sender.trusted, Message (data) };
+            g_variant_unref (data);
+            state->push (std::move (received));
+        };
+    }
+
+    /* co_await gives the next message */
+    NextAwaiter next (Resumer resumer = {}) { return NextAwaiter (m_state, std::move (resumer)); }
+
+    size_t pending () const { return m_state->queue.size (); }
+
+private:
+    struct State {
+        void push (Received &&received) {
+            if (waiters.empty ()) {
+                queue.push_back (std::move (received));
+                return;
+            }
+            NextAwaiter *waiter = waiters.front ();
+            waiters.pop_front ();
+            waiter->m_received.emplace (std::move (received));
+            std::coroutine_handle<> handle = std::exchange (waiter->m_handle, nullptr);
+            detail::resume (waiter->m_resumer, handle);
+        }
+
+        std::deque<Received>      queue;
+        std::deque<NextAwaiter *> waiters;
+    };
+
+    std::shared_ptr<State> m_state;
+};
+
+} // namespace messageport
+
+#endif /* __MESSAGE_PORT_CORO_HPP */
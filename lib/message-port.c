@@ -24,9 +24,12 @@
  */
 
 #include "message-port.h"
+#include "msgport-channel.h"
 #include "msgport-factory.h"
 #include "msgport-manager.h"
 #include "msgport-utils.h"
+#include "msgport-message-view.h"
+#include "msgport-message.h"
 #include "common/log.h"
 
 void
@@ -38,7 +41,7 @@ _messageport_cb_helper (int id, const char* remote_app_id, const char* remote_po
 }
 
 static int
-_messageport_register_port (const char *name, gboolean is_trusted, messageport_message_cb_full cb, void *userdata)
+_messageport_register_port (const char *name, gboolean is_trusted, messageport_message_cb_full cb, messageport_message_with_fds_cb fds_cb, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, void *userdata)
 {
     int port_id = 0; /* id of the port created */
     messageport_error_e res;
@@ -46,11 +49,22 @@ _messageport_register_port (const char *name, gboolean is_trusted, messageport_m
 
     if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
 
-    res = msgport_manager_register_service (manager, name, is_trusted, cb, userdata, &port_id);
+    res = msgport_manager_register_service (manager, name, is_trusted, cb, fds_cb, view_cb, typed_cb, userdata, &port_id);
 
     return port_id > 0 ? port_id : (int)res;
 }
 
+static messageport_error_e
+_messageport_register_port_async (const char *name, gboolean is_trusted, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, void *userdata, messageport_register_done_cb done, void *done_data)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!name || !done) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_register_service_async (manager, name, is_trusted, NULL, NULL, view_cb, typed_cb, userdata, done, done_data);
+}
+
 static int
 _messageport_unregister_port (int local_port_id, gboolean is_trusted)
 {
@@ -63,7 +77,7 @@ _messageport_unregister_port (int local_port_id, gboolean is_trusted)
     if (res_check_trust != MESSAGEPORT_ERROR_NONE)
         return (int)res_check_trust;
 
-    if (is_trusted_out == is_trusted)
+    if (is_trusted_out != is_trusted)
         return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
 
     res = msgport_manager_unregister_service (manager, local_port_id);
@@ -94,7 +108,7 @@ _messageport_send_message (const char *app_id, const char *port, gboolean is_tru
     if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
     if (!message) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
 
-    GVariant *v_data = bundle_to_variant_map (message);
+    GVariant *v_data = msgport_manager_bundle_to_message (manager, message);
 
     return msgport_manager_send_message (manager, app_id, port, is_trusted, v_data);
 }
@@ -107,11 +121,112 @@ _messageport_send_bidirectional_message (int id, const gchar *remote_app_id, con
     if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
     if (!message) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
 
-    GVariant *v_data = bundle_to_variant_map (message);
+    GVariant *v_data = msgport_manager_bundle_to_message (manager, message);
 
     return msgport_manager_send_bidirectional_message (manager, id, remote_app_id, remote_port, is_trusted, v_data);
 }
 
+static messageport_error_e
+_messageport_send_typed_message (int id, const char *app_id, const char *port, gboolean is_trusted, messageport_message_t *message)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    GVariant *data = NULL;
+    messageport_error_e res;
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!message || !app_id || !port) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    data = msgport_message_to_variant (message);
+    if (id > 0)
+        res = msgport_manager_send_bidirectional_message (manager, id, app_id, port, is_trusted, data);
+    else
+        res = msgport_manager_send_message (manager, app_id, port, is_trusted, data);
+    g_variant_unref (data);
+
+    return res;
+}
+
+static messageport_error_e
+_messageport_send_message_async (int id, const char *app_id, const char *port, gboolean is_trusted, bundle *message, messageport_send_done_cb cb, void *userdata)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!message || !app_id || !port) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_send_message_async (manager, id, app_id, port, is_trusted, msgport_manager_bundle_to_message (manager, message), cb, userdata);
+}
+
+static messageport_error_e
+_messageport_send_typed_message_async (int id, const char *app_id, const char *port, gboolean is_trusted, messageport_message_t *message, messageport_send_done_cb cb, void *userdata)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    GVariant *data = NULL;
+    messageport_error_e res;
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!message || !app_id || !port) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    data = msgport_message_to_variant (message);
+    res = msgport_manager_send_message_async (manager, id, app_id, port, is_trusted, data, cb, userdata);
+    g_variant_unref (data);
+
+    return res;
+}
+
+static messageport_error_e
+_messageport_send_message_noreply (int id, const char *app_id, const char *port, gboolean is_trusted, bundle *message)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!message || !app_id || !port) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_send_message_noreply (manager, id, app_id, port, is_trusted, msgport_manager_bundle_to_message (manager, message));
+}
+
+static messageport_error_e
+_messageport_send_message_with_fds (int id, const char *app_id, const char *port, gboolean is_trusted, bundle *message, const int *fds, unsigned int n_fds)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!message || !app_id || !port || (n_fds && !fds)) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_send_message_with_fds (manager, id, app_id, port, is_trusted, msgport_manager_bundle_to_message (manager, message), fds, n_fds);
+}
+
+static messageport_error_e
+_messageport_send_message_by_handle (int id, messageport_remote_port_h handle, bundle *message)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!handle || !message) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_send_message_to_remote_port (handle, id, message);
+}
+
+static messageport_error_e
+_messageport_send_typed_message_by_handle (int id, messageport_remote_port_h handle, messageport_message_t *message)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    GVariant *data = NULL;
+    messageport_error_e res;
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!handle || !message) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    data = msgport_message_to_variant (message);
+    res = msgport_manager_send_typed_message_to_remote_port (handle, id, data);
+    g_variant_unref (data);
+
+    return res;
+}
+
 /*
  * API
  */
@@ -119,25 +234,249 @@ _messageport_send_bidirectional_message (int id, const gchar *remote_app_id, con
 int
 messageport_register_local_port (const char* local_port, messageport_message_cb callback)
 {
-    return _messageport_register_port (local_port, FALSE, _messageport_cb_helper, (void*)callback);
+    return _messageport_register_port (local_port, FALSE, _messageport_cb_helper, NULL, NULL, NULL, (void*)callback);
 }
 
 int
 messageport_register_local_port_full (const char *local_port, messageport_message_cb_full callback, void *userdata)
 {
-    return _messageport_register_port (local_port, FALSE, callback, userdata);
+    return _messageport_register_port (local_port, FALSE, callback, NULL, NULL, NULL, userdata);
 }
 
 int
 messageport_register_trusted_local_port (const char *local_port, messageport_message_cb callback)
 {
-    return _messageport_register_port (local_port, TRUE, _messageport_cb_helper, (void*)callback);
+    return _messageport_register_port (local_port, TRUE, _messageport_cb_helper, NULL, NULL, NULL, (void*)callback);
 }
 
 int
 messageport_register_trusted_local_port_full (const char *local_port, messageport_message_cb_full callback, void *userdata)
 {
-    return _messageport_register_port (local_port, TRUE, callback, userdata);
+    return _messageport_register_port (local_port, TRUE, callback, NULL, NULL, NULL, userdata);
+}
+
+int
+messageport_register_local_port_with_fds (const char *local_port, bool trusted, messageport_message_with_fds_cb callback, void *userdata)
+{
+    if (!callback) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_register_port (local_port, (gboolean)trusted, NULL, callback, NULL, NULL, userdata);
+}
+
+int
+messageport_register_local_port_with_view (const char *local_port, bool trusted, messageport_message_view_cb callback, void *userdata)
+{
+    if (!callback) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_register_port (local_port, (gboolean)trusted, NULL, NULL, callback, NULL, userdata);
+}
+
+messageport_error_e
+messageport_message_view_get_str (messageport_message_view_h message, const char *key, const char **value)
+{
+    if (!message || !key || !value) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_message_view_get_str (message, key, value);
+}
+
+messageport_error_e
+messageport_message_view_get_byte (messageport_message_view_h message, const char *key, const void **data, size_t *size)
+{
+    gsize len = 0;
+    messageport_error_e res;
+
+    if (!message || !key || !data || !size) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    res = msgport_message_view_get_byte (message, key, data, &len);
+    if (res == MESSAGEPORT_ERROR_NONE) *size = (size_t)len;
+
+    return res;
+}
+
+messageport_error_e
+messageport_message_view_get_str_array (messageport_message_view_h message, const char *key, const char ***array, int *len)
+{
+    if (!message || !key || !array || !len) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_message_view_get_str_array (message, key, array, len);
+}
+
+bundle *
+messageport_message_view_to_bundle (messageport_message_view_h message)
+{
+    if (!message) return NULL;
+
+    return msgport_message_view_to_bundle (message);
+}
+
+int
+messageport_register_local_port_typed (const char *local_port, bool trusted, messageport_message_typed_cb callback, void *userdata)
+{
+    if (!callback) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_register_port (local_port, (gboolean)trusted, NULL, NULL, NULL, callback, userdata);
+}
+
+messageport_error_e
+messageport_register_local_port_with_view_async (const char *local_port, bool trusted, messageport_message_view_cb callback, void *userdata, messageport_register_done_cb done, void *done_data)
+{
+    if (!callback) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_register_port_async (local_port, (gboolean)trusted, callback, NULL, userdata, done, done_data);
+}
+
+messageport_error_e
+messageport_register_local_port_typed_async (const char *local_port, bool trusted, messageport_message_typed_cb callback, void *userdata, messageport_register_done_cb done, void *done_data)
+{
+    if (!callback) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_register_port_async (local_port, (gboolean)trusted, NULL, callback, userdata, done, done_data);
+}
+
+messageport_message_t *
+messageport_message_create (void)
+{
+    return msgport_message_new ();
+}
+
+messageport_message_t *
+messageport_message_create_from_data (GVariant *data)
+{
+    if (!data) return NULL;
+
+    return msgport_message_new_from_variant (data);
+}
+
+GVariant *
+messageport_message_get_data (messageport_message_t *message)
+{
+    if (!message) return NULL;
+
+    return msgport_message_to_variant (message);
+}
+
+messageport_error_e
+messageport_message_destroy (messageport_message_t *message)
+{
+    if (!message) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    msgport_message_free (message);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+messageport_message_set_int64 (messageport_message_t *message, const char *key, int64_t value)
+{
+    if (!message || !key) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_message_set_value (message, key, g_variant_new_int64 ((gint64)value));
+}
+
+messageport_error_e
+messageport_message_set_double (messageport_message_t *message, const char *key, double value)
+{
+    if (!message || !key) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_message_set_value (message, key, g_variant_new_double (value));
+}
+
+messageport_error_e
+messageport_message_set_bool (messageport_message_t *message, const char *key, bool value)
+{
+    if (!message || !key) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_message_set_value (message, key, g_variant_new_boolean ((gboolean)value));
+}
+
+messageport_error_e
+messageport_message_set_str (messageport_message_t *message, const char *key, const char *value)
+{
+    if (!message || !key || !value || !g_utf8_validate (value, -1, NULL)) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_message_set_value (message, key, g_variant_new_string (value));
+}
+
+messageport_error_e
+messageport_message_set_blob (messageport_message_t *message, const char *key, const void *data, size_t size)
+{
+    if (!message || !key || (size && !data)) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_message_set_value (message, key, g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, data, size, 1));
+}
+
+messageport_error_e
+messageport_message_get_int64 (messageport_message_t *message, const char *key, int64_t *value)
+{
+    GVariant *v = NULL;
+    messageport_error_e res;
+
+    if (!message || !key || !value) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    res = msgport_message_get_value (message, key, G_VARIANT_TYPE_INT64, &v);
+    if (res == MESSAGEPORT_ERROR_NONE) *value = (int64_t)g_variant_get_int64 (v);
+
+    return res;
+}
+
+messageport_error_e
+messageport_message_get_double (messageport_message_t *message, const char *key, double *value)
+{
+    GVariant *v = NULL;
+    messageport_error_e res;
+
+    if (!message || !key || !value) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    res = msgport_message_get_value (message, key, G_VARIANT_TYPE_DOUBLE, &v);
+    if (res == MESSAGEPORT_ERROR_NONE) *value = g_variant_get_double (v);
+
+    return res;
+}
+
+messageport_error_e
+messageport_message_get_bool (messageport_message_t *message, const char *key, bool *value)
+{
+    GVariant *v = NULL;
+    messageport_error_e res;
+
+    if (!message || !key || !value) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    res = msgport_message_get_value (message, key, G_VARIANT_TYPE_BOOLEAN, &v);
+    if (res == MESSAGEPORT_ERROR_NONE) *value = (bool)g_variant_get_boolean (v);
+
+    return res;
+}
+
+messageport_error_e
+messageport_message_get_str (messageport_message_t *message, const char *key, const char **value)
+{
+    GVariant *v = NULL;
+    messageport_error_e res;
+
+    if (!message || !key || !value) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    res = msgport_message_get_value (message, key, G_VARIANT_TYPE_STRING, &v);
+    if (res == MESSAGEPORT_ERROR_NONE) *value = g_variant_get_string (v, NULL);
+
+    return res;
+}
+
+messageport_error_e
+messageport_message_get_blob (messageport_message_t *message, const char *key, const void **data, size_t *size)
+{
+    GVariant *v = NULL;
+    gsize len = 0;
+    messageport_error_e res;
+
+    if (!message || !key || !data || !size) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    res = msgport_message_get_value (message, key, G_VARIANT_TYPE_BYTESTRING, &v);
+    if (res == MESSAGEPORT_ERROR_NONE) {
+        *data = g_variant_get_fixed_array (v, &len, 1);
+        *size = (size_t)len;
+    }
+
+    return res;
 }
 
 int
@@ -176,6 +515,20 @@ messageport_send_trusted_message (const char* remote_app_id, const char* remote_
     return _messageport_send_message (remote_app_id, remote_port, TRUE, message);
 }
 
+messageport_error_e
+messageport_send_typed_message (const char *remote_app_id, const char *remote_port, bool trusted, messageport_message_t *message)
+{
+    return _messageport_send_typed_message (0, remote_app_id, remote_port, (gboolean)trusted, message);
+}
+
+messageport_error_e
+messageport_send_bidirectional_typed_message (int id, const char *remote_app_id, const char *remote_port, bool trusted, messageport_message_t *message)
+{
+    if (id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_send_typed_message (id, remote_app_id, remote_port, (gboolean)trusted, message);
+}
+
 messageport_error_e
 messageport_send_bidirectional_message (int id, const char* remote_app_id, const char* remote_port, bundle* data)
 {
@@ -188,6 +541,119 @@ messageport_send_bidirectional_trusted_message (int id, const char *remote_app_i
     return _messageport_send_bidirectional_message (id, remote_app_id, remote_port, TRUE, data);
 }
 
+messageport_error_e
+messageport_send_messages (const char *remote_app_id, const char *remote_port, bool trusted, bundle **messages, unsigned int n_messages)
+{
+    GVariantBuilder builder;
+    unsigned int i;
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!remote_app_id || !remote_port || !messages || !n_messages) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < n_messages; i++)
+        if (!messages[i]) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+    for (i = 0; i < n_messages; i++)
+        g_variant_builder_add_value (&builder, msgport_manager_bundle_to_message (manager, messages[i]));
+
+    return msgport_manager_send_messages (manager, remote_app_id, remote_port, (gboolean)trusted, g_variant_builder_end (&builder));
+}
+
+messageport_error_e
+messageport_send_message_multi (const messageport_target_s *targets, unsigned int n_targets, bundle *message, messageport_error_e *results)
+{
+    GVariantBuilder builder;
+    unsigned int i;
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!targets || !n_targets || !message) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < n_targets; i++)
+        if (!targets[i].remote_app_id || !targets[i].remote_port) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssb)"));
+    for (i = 0; i < n_targets; i++)
+        g_variant_builder_add (&builder, "(ssb)", targets[i].remote_app_id, targets[i].remote_port, (gboolean)targets[i].trusted);
+
+    return msgport_manager_send_message_multi (manager, g_variant_builder_end (&builder),
+            msgport_manager_bundle_to_message (manager, message), results, n_targets);
+}
+
+messageport_error_e
+messageport_send_message_async (const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, messageport_send_done_cb callback, void *userdata)
+{
+    return _messageport_send_message_async (0, remote_app_id, remote_port, (gboolean)trusted, message, callback, userdata);
+}
+
+messageport_error_e
+messageport_send_bidirectional_message_async (int id, const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, messageport_send_done_cb callback, void *userdata)
+{
+    if (id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_send_message_async (id, remote_app_id, remote_port, (gboolean)trusted, message, callback, userdata);
+}
+
+messageport_error_e
+messageport_send_typed_message_async (const char *remote_app_id, const char *remote_port, bool trusted, messageport_message_t *message, messageport_send_done_cb callback, void *userdata)
+{
+    return _messageport_send_typed_message_async (0, remote_app_id, remote_port, (gboolean)trusted, message, callback, userdata);
+}
+
+messageport_error_e
+messageport_send_bidirectional_typed_message_async (int id, const char *remote_app_id, const char *remote_port, bool trusted, messageport_message_t *message, messageport_send_done_cb callback, void *userdata)
+{
+    if (id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_send_typed_message_async (id, remote_app_id, remote_port, (gboolean)trusted, message, callback, userdata);
+}
+
+messageport_error_e
+messageport_send_message_noreply (const char *remote_app_id, const char *remote_port, bool trusted, bundle *message)
+{
+    return _messageport_send_message_noreply (0, remote_app_id, remote_port, (gboolean)trusted, message);
+}
+
+messageport_error_e
+messageport_send_bidirectional_message_noreply (int id, const char *remote_app_id, const char *remote_port, bool trusted, bundle *message)
+{
+    if (id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_send_message_noreply (id, remote_app_id, remote_port, (gboolean)trusted, message);
+}
+
+messageport_error_e
+messageport_send_message_with_fds (const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, const int *fds, unsigned int n_fds)
+{
+    return _messageport_send_message_with_fds (0, remote_app_id, remote_port, (gboolean)trusted, message, fds, n_fds);
+}
+
+messageport_error_e
+messageport_send_bidirectional_message_with_fds (int id, const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, const int *fds, unsigned int n_fds)
+{
+    if (id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_send_message_with_fds (id, remote_app_id, remote_port, (gboolean)trusted, message, fds, n_fds);
+}
+
+messageport_error_e
+messageport_get_dropped_message_count (unsigned int *count)
+{
+    guint n_dropped = 0;
+    messageport_error_e res;
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!count) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    res = msgport_manager_get_dropped_message_count (manager, &n_dropped);
+    if (res == MESSAGEPORT_ERROR_NONE) *count = n_dropped;
+
+    return res;
+}
+
 messageport_error_e
 messageport_get_local_port_name (int id, char **name_out)
 {
@@ -213,3 +679,226 @@ messageport_check_trusted_local_port (int id, bool *is_trusted_out)
     return res;
 }
 
+messageport_error_e
+messageport_open_remote_port (const char *remote_app_id, const char *remote_port, bool trusted, messageport_remote_port_h *handle)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+
+    return msgport_manager_open_remote_port (manager, remote_app_id, remote_port, (gboolean)trusted, handle);
+}
+
+messageport_error_e
+messageport_close_remote_port (messageport_remote_port_h handle)
+{
+    if (!handle) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    msgport_manager_close_remote_port (handle);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+messageport_remote_port_set_compression (messageport_remote_port_h handle, unsigned int threshold)
+{
+    if (!handle) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    msgport_manager_set_remote_port_compression (handle, threshold);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+messageport_remote_port_set_delta (messageport_remote_port_h handle, bool enable)
+{
+    if (!handle) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    msgport_manager_set_remote_port_delta (handle, enable);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+messageport_remote_port_set_schema (messageport_remote_port_h handle, const char **keys, int n_keys)
+{
+    const gchar **strv = NULL;
+    messageport_error_e res;
+    int i;
+
+    if (!handle || n_keys < 0 || (n_keys && !keys)) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    if (!n_keys) return msgport_manager_set_remote_port_schema (handle, NULL);
+
+    strv = g_new0 (const gchar *, n_keys + 1);
+    for (i = 0; i < n_keys; i++) {
+        if (!keys[i]) {
+            g_free (strv);
+            return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+        }
+        strv[i] = keys[i];
+    }
+
+    res = msgport_manager_set_remote_port_schema (handle, strv);
+    g_free (strv);
+
+    return res;
+}
+
+messageport_error_e
+messageport_send_message_by_handle (messageport_remote_port_h handle, bundle *message)
+{
+    return _messageport_send_message_by_handle (0, handle, message);
+}
+
+messageport_error_e
+messageport_send_bidirectional_message_by_handle (int id, messageport_remote_port_h handle, bundle *message)
+{
+    if (id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_send_message_by_handle (id, handle, message);
+}
+
+messageport_error_e
+messageport_send_typed_message_by_handle (messageport_remote_port_h handle, messageport_message_t *message)
+{
+    return _messageport_send_typed_message_by_handle (0, handle, message);
+}
+
+messageport_error_e
+messageport_send_bidirectional_typed_message_by_handle (int id, messageport_remote_port_h handle, messageport_message_t *message)
+{
+    if (id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return _messageport_send_typed_message_by_handle (id, handle, message);
+}
+
+messageport_error_e
+messageport_open_channel (const char *remote_app_id, const char *remote_port, bool trusted, messageport_channel_h *channel)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!remote_app_id || !remote_port || !channel) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_open_channel (manager, remote_app_id, remote_port, (gboolean)trusted, channel);
+}
+
+messageport_error_e
+messageport_open_peer_channel (const char *remote_app_id, const char *remote_port, bool trusted, messageport_channel_h *channel)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!remote_app_id || !remote_port || !channel) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_open_peer_channel (manager, remote_app_id, remote_port, (gboolean)trusted, channel);
+}
+
+messageport_error_e
+messageport_channel_send (messageport_channel_h channel, bundle *message)
+{
+    if (!channel || !message) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    /* bypasses the daemon, so that it could not unpack encoded bundles for older receivers */
+    return msgport_channel_send (channel, bundle_to_variant_map (message));
+}
+
+messageport_error_e
+messageport_close_channel (messageport_channel_h channel)
+{
+    if (!channel) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    msgport_manager_close_channel (channel);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+messageport_set_stream_handler (int id, messageport_stream_cb callback, void *userdata)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_set_stream_handler (manager, id, callback, userdata);
+}
+
+messageport_error_e
+messageport_open_stream (const char *remote_app_id, const char *remote_port, bool trusted, messageport_stream_h *stream)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (!remote_app_id || !remote_port || !stream) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_open_stream (manager, remote_app_id, remote_port, (gboolean)trusted, stream);
+}
+
+int
+messageport_stream_write (messageport_stream_h stream, const void *data, unsigned int size)
+{
+    messageport_error_e res;
+    gsize written = 0;
+
+    if (!stream || (!data && size)) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    /* the count has to fit in the result */
+    res = msgport_channel_write (stream, data, MIN (size, G_MAXINT), &written);
+
+    return res == MESSAGEPORT_ERROR_NONE ? (int)written : (int)res;
+}
+
+messageport_error_e
+messageport_stream_set_writable_cb (messageport_stream_h stream, messageport_stream_writable_cb callback, void *userdata)
+{
+    if (!stream) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    msgport_channel_set_writable_func (stream, g_main_context_get_thread_default (), callback, userdata);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+messageport_close_stream (messageport_stream_h stream)
+{
+    if (!stream) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_close_stream (stream);
+}
+
+messageport_error_e
+messageport_abort_stream (messageport_stream_h stream)
+{
+    if (!stream) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    msgport_manager_close_channel (stream);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+int
+messageport_watch_remote_port (const char *remote_app_id, const char *remote_port, bool trusted, messageport_remote_port_watch_cb callback, void *userdata)
+{
+    guint watch_id = 0;
+    messageport_error_e res;
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+
+    res = msgport_manager_watch_remote_service (manager, remote_app_id, remote_port, (gboolean)trusted, callback, userdata, &watch_id);
+
+    return watch_id > 0 ? (int)watch_id : (int)res;
+}
+
+messageport_error_e
+messageport_unwatch_remote_port (int watch_id)
+{
+    MsgPortManager *manager = msgport_factory_get_manager ();
+
+    if (!manager) return MESSAGEPORT_ERROR_IO_ERROR;
+    if (watch_id <= 0) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    return msgport_manager_unwatch_remote_service (manager, (guint)watch_id);
+}
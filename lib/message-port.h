@@ -37,6 +37,7 @@
 #include <bundle.h>
 #include <glib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <tizen_error.h>
 
 G_BEGIN_DECLS
@@ -97,6 +98,166 @@ typedef void (*messageport_message_cb)(int id, const char* remote_app_id, const
  */
 typedef void (*messageport_message_cb_full)(int id, const char* remote_app_id, const char* remote_port, bool trusted_message, bundle* message, void *userdata);
 
+/**
+ * messageport_message_with_fds_cb:
+ * @id: The ID of the local message port to which the message was sent.
+ * @remote_app_id: The ID of the remote application which has sent this message, or NULL
+ * @remote_port: The name of the remote message port, or NULL
+ * @trusted_message: TRUE if the remote message port is trusted port, i.e, it receives message from trusted applications.
+ * @message: The message received.
+ * @fds: The file descriptors attached to the message, or NULL if there are none
+ * @n_fds: The number of file descriptors in @fds
+ * @userdata: client specific userdata that was passed while registering service.
+ *
+ * This is the function type of the callback used for #messageport_register_local_port_with_fds.
+ * The file descriptors are owned by the library and are closed once the callback returns,
+ * use dup() to keep any of them.
+ */
+typedef void (*messageport_message_with_fds_cb)(int id, const char* remote_app_id, const char* remote_port, bool trusted_message, bundle* message, const int *fds, unsigned int n_fds, void *userdata);
+
+/**
+ * messageport_message_view_h:
+ *
+ * A read-only view of a received message, see #messageport_register_local_port_with_view.
+ */
+typedef struct _messageport_message_view_s *messageport_message_view_h;
+
+/**
+ * messageport_message_view_cb:
+ * @id: The ID of the local message port to which the message was sent.
+ * @remote_app_id: The ID of the remote application which has sent this message, or NULL
+ * @remote_port: The name of the remote message port, or NULL
+ * @trusted_message: TRUE if the remote message port is trusted port, i.e, it receives message from trusted applications.
+ * @message: A view of the message received, valid only until the callback returns.
+ * @userdata: client specific userdata that was passed while registering service.
+ *
+ * This is the function type of the callback used for #messageport_register_local_port_with_view.
+ */
+typedef void (*messageport_message_view_cb)(int id, const char* remote_app_id, const char* remote_port, bool trusted_message, messageport_message_view_h message, void *userdata);
+
+/**
+ * messageport_message_t:
+ *
+ * A message of typed values, see #messageport_message_create. Unlike bundles, numbers,
+ * booleans and blobs are sent as they are, without formatting them into strings.
+ */
+typedef struct _messageport_message_s messageport_message_t;
+
+/**
+ * messageport_message_typed_cb:
+ * @id: The ID of the local message port to which the message was sent.
+ * @remote_app_id: The ID of the remote application which has sent this message, or NULL
+ * @remote_port: The name of the remote message port, or NULL
+ * @trusted_message: TRUE if the remote message port is trusted port, i.e, it receives message from trusted applications.
+ * @message: The message received, valid only until the callback returns.
+ * @userdata: client specific userdata that was passed while registering service.
+ *
+ * This is the function type of the callback used for #messageport_register_local_port_typed.
+ */
+typedef void (*messageport_message_typed_cb)(int id, const char* remote_app_id, const char* remote_port, bool trusted_message, messageport_message_t *message, void *userdata);
+
+/**
+ * messageport_send_done_cb:
+ * @result: #MESSAGEPORT_ERROR_NONE if the message was delivered to the remote message port, otherwise a negative error value
+ * @userdata: client specific userdata that was passed while sending the message
+ *
+ * This is the function type of the callback used for #messageport_send_message_async and
+ * #messageport_send_bidirectional_message_async, it is called once the daemon has handled the message.
+ */
+typedef void (*messageport_send_done_cb)(messageport_error_e result, void *userdata);
+
+/**
+ * messageport_register_done_cb:
+ * @id: The message port id on success, otherwise a negative error value
+ * @userdata: client specific userdata that was passed while registering the port
+ *
+ * This is the function type of the callback used for #messageport_register_local_port_with_view_async
+ * and #messageport_register_local_port_typed_async, it is called once the port is registered.
+ */
+typedef void (*messageport_register_done_cb)(int id, void *userdata);
+
+/**
+ * messageport_target_s:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote message port is a trusted port
+ *
+ * A remote message port, the message is sent to by #messageport_send_message_multi.
+ */
+typedef struct _messageport_target_s
+{
+    const char *remote_app_id;
+    const char *remote_port;
+    bool        trusted;
+} messageport_target_s;
+
+/**
+ * messageport_remote_port_h:
+ *
+ * Opaque handle to a resolved remote message port, returned by #messageport_open_remote_port.
+ * It is bound to the thread that opened it.
+ */
+typedef struct _messageport_remote_port_s *messageport_remote_port_h;
+
+/**
+ * messageport_channel_h:
+ *
+ * Opaque handle to a shared memory channel or to a peer channel to a remote message port,
+ * returned by #messageport_open_channel or #messageport_open_peer_channel.
+ * Only one thread at a time may send on it.
+ */
+typedef struct _messageport_channel_s *messageport_channel_h;
+
+/**
+ * messageport_stream_h:
+ *
+ * Opaque handle to a stream to a remote message port, returned by #messageport_open_stream.
+ * Only one thread at a time may write on it.
+ */
+typedef struct _messageport_channel_s *messageport_stream_h;
+
+/**
+ * messageport_stream_cb:
+ * @id: The ID of the local message port the stream was opened to
+ * @stream_id: The ID of the stream, unique among the streams opened to the local message port
+ * @remote_app_id: The ID of the remote application which has opened the stream
+ * @remote_port: Always NULL, streams are not opened from a message port
+ * @trusted_remote_port: Always FALSE
+ * @chunk: The next chunk of data, or NULL at the end of the stream
+ * @size: The size of @chunk, at most 64 KiB
+ * @result: #MESSAGEPORT_ERROR_NONE, or #MESSAGEPORT_ERROR_IO_ERROR at the end of a stream that did not complete
+ * @userdata: client specific userdata that was passed to #messageport_set_stream_handler
+ *
+ * This is the function type of the callback used for #messageport_set_stream_handler.
+ * It is called for each chunk in the order they were written, and once more with @chunk set to NULL when the stream ends.
+ * The chunk is only valid during the call.
+ */
+typedef void (*messageport_stream_cb)(int id, int stream_id, const char *remote_app_id, const char *remote_port, bool trusted_remote_port, const void *chunk, unsigned int size, messageport_error_e result, void *userdata);
+
+/**
+ * messageport_stream_writable_cb:
+ * @stream: The stream handle returned by #messageport_open_stream
+ * @userdata: client specific userdata that was passed to #messageport_stream_set_writable_cb
+ *
+ * This is the function type of the callback used for #messageport_stream_set_writable_cb.
+ * It is called once the remote application caught up, after a write on the stream that returned
+ * #MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE or wrote less than asked.
+ */
+typedef void (*messageport_stream_writable_cb)(messageport_stream_h stream, void *userdata);
+
+/**
+ * messageport_remote_port_watch_cb:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the watched remote message port is a trusted port
+ * @available: TRUE if the remote message port is registered, FALSE if it went away
+ * @userdata: client specific userdata that was passed to #messageport_watch_remote_port
+ *
+ * This is the function type of the callback used for #messageport_watch_remote_port.
+ * It is called once with the current state of the remote message port, and then whenever the port appears or disappears.
+ */
+typedef void (*messageport_remote_port_watch_cb)(const char *remote_app_id, const char *remote_port, bool trusted, bool available, void *userdata);
+
 /**
  * messageport_register_local_port:
  * @local_port: local_port the name of the local message port
@@ -167,6 +328,263 @@ messageport_register_trusted_local_port(const char* local_port, messageport_mess
 EXPORT_API int
 messageport_register_trusted_local_port_full(const char* local_port, messageport_message_cb_full callback, void *userdata);
 
+/**
+ * messageport_register_local_port_with_fds:
+ * @local_port: the name of the local message port
+ * @trusted: TRUE to register a trusted message port
+ * @callback: The callback function to be called when a message is received at this port
+ * @userdata: client specific data.
+ *
+ * Registers the local message port with name #local_port, like #messageport_register_local_port_full,
+ * but the #callback also gets the file descriptors attached to the message by #messageport_send_message_with_fds.
+ * Messages without file descriptors are delivered with @fds set to NULL.
+ *
+ * Returns: A message port id on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER If either #local_port or #callback is missing or invalid.
+ *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY Memory error occured
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API int
+messageport_register_local_port_with_fds(const char* local_port, bool trusted, messageport_message_with_fds_cb callback, void *userdata);
+
+/**
+ * messageport_register_local_port_with_view:
+ * @local_port: the name of the local message port
+ * @trusted: TRUE to register a trusted message port
+ * @callback: The callback function to be called when a message is received at this port
+ * @userdata: client specific data.
+ *
+ * Registers the local message port with name #local_port, like #messageport_register_local_port_full,
+ * but no bundle is built for received messages. The #callback gets a view of the message instead,
+ * and values are read from it with messageport_message_view_get_*() only when asked for.
+ * Messages sent as encoded bundles are decoded once, on the first lookup.
+ *
+ * Returns: A message port id on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER If either #local_port or #callback is missing or invalid.
+ *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY Memory error occured
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API int
+messageport_register_local_port_with_view(const char* local_port, bool trusted, messageport_message_view_cb callback, void *userdata);
+
+/**
+ * messageport_message_view_get_str:
+ * @message: The message view passed to #messageport_message_view_cb
+ * @key: The key to look up
+ * @value: (out): The string value, owned by the view
+ *
+ * Looks up the string value of #key, like bundle_get_val().
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed, or no string value for #key
+ */
+EXPORT_API messageport_error_e
+messageport_message_view_get_str(messageport_message_view_h message, const char *key, const char **value);
+
+/**
+ * messageport_message_view_get_byte:
+ * @message: The message view passed to #messageport_message_view_cb
+ * @key: The key to look up
+ * @data: (out): The byte value, owned by the view
+ * @size: (out): The size of #data
+ *
+ * Looks up the byte value of #key, like bundle_get_byte().
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed, or no byte value for #key
+ */
+EXPORT_API messageport_error_e
+messageport_message_view_get_byte(messageport_message_view_h message, const char *key, const void **data, size_t *size);
+
+/**
+ * messageport_message_view_get_str_array:
+ * @message: The message view passed to #messageport_message_view_cb
+ * @key: The key to look up
+ * @array: (out): The string array value, owned by the view
+ * @len: (out): The number of strings in #array
+ *
+ * Looks up the string array value of #key, like bundle_get_str_array().
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed, or no string array value for #key
+ */
+EXPORT_API messageport_error_e
+messageport_message_view_get_str_array(messageport_message_view_h message, const char *key, const char ***array, int *len);
+
+/**
+ * messageport_message_view_to_bundle:
+ * @message: The message view passed to #messageport_message_view_cb
+ *
+ * Converts the whole message to a bundle, for handlers that need to keep
+ * the message or read value types the view does not offer.
+ *
+ * Returns: A new bundle, free with bundle_free(), or NULL on error.
+ */
+EXPORT_API bundle *
+messageport_message_view_to_bundle(messageport_message_view_h message);
+
+/**
+ * messageport_register_local_port_typed:
+ * @local_port: the name of the local message port
+ * @trusted: TRUE to register a trusted message port
+ * @callback: The callback function to be called when a message is received at this port
+ * @userdata: client specific data.
+ *
+ * Registers the local message port with name #local_port, like #messageport_register_local_port_full,
+ * but the #callback gets the message as a #messageport_message_t, values are read from it with
+ * messageport_message_get_*(). No bundle is built for received messages. Bundles sent to the port
+ * are received with their string values, and byte values as blobs.
+ *
+ * Returns: A message port id on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER If either #local_port or #callback is missing or invalid.
+ *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY Memory error occured
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API int
+messageport_register_local_port_typed(const char* local_port, bool trusted, messageport_message_typed_cb callback, void *userdata);
+
+/**
+ * messageport_register_local_port_with_view_async:
+ * @local_port: the name of the local message port
+ * @trusted: TRUE to register a trusted message port
+ * @callback: The callback function to be called when a message is received at this port
+ * @userdata: client specific data passed to #callback
+ * @done: The callback function to be called with the port id, or the error
+ * @done_data: client specific data passed to #done
+ *
+ * Asynchronous version of #messageport_register_local_port_with_view, the daemon is not waited for.
+ * #done is called from the main context of the calling thread, never before this call returns.
+ * Unlike the synchronous version, a port this process registered already keeps its callback,
+ * #done gets #MESSAGEPORT_ERROR_INVALID_PARAMETER and #callback is never called.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE if the port is being registered, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER If either #local_port, #callback or #done is missing or invalid.
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_register_local_port_with_view_async(const char* local_port, bool trusted, messageport_message_view_cb callback, void *userdata, messageport_register_done_cb done, void *done_data);
+
+/**
+ * messageport_register_local_port_typed_async:
+ * @local_port: the name of the local message port
+ * @trusted: TRUE to register a trusted message port
+ * @callback: The callback function to be called when a message is received at this port
+ * @userdata: client specific data passed to #callback
+ * @done: The callback function to be called with the port id, or the error
+ * @done_data: client specific data passed to #done
+ *
+ * Asynchronous version of #messageport_register_local_port_typed, see #messageport_register_local_port_with_view_async.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE if the port is being registered, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER If either #local_port, #callback or #done is missing or invalid.
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_register_local_port_typed_async(const char* local_port, bool trusted, messageport_message_typed_cb callback, void *userdata, messageport_register_done_cb done, void *done_data);
+
+/**
+ * messageport_message_create:
+ *
+ * Creates an empty message, to be sent with #messageport_send_typed_message.
+ *
+ * Returns: A new message, free with #messageport_message_destroy, or NULL on error.
+ */
+EXPORT_API messageport_message_t *
+messageport_message_create(void);
+
+/**
+ * messageport_message_create_from_data:
+ * @data: An a{sv} map of the values, the reference is taken if floating
+ *
+ * Creates a message of prebuilt values, as generated encoders, see msgport-codegen, build those.
+ * The values are sent as they are, no value is copied.
+ *
+ * Returns: A new message, free with #messageport_message_destroy, or NULL if #data is not an a{sv} map.
+ */
+EXPORT_API messageport_message_t *
+messageport_message_create_from_data(GVariant *data);
+
+/**
+ * messageport_message_get_data:
+ * @message: The message
+ *
+ * Gets all the values of the message as an a{sv} map, as generated decoders, see msgport-codegen, read those.
+ * For received messages that is the map as it was received.
+ *
+ * Returns: A new reference to the map, release with g_variant_unref(), or NULL on error.
+ */
+EXPORT_API GVariant *
+messageport_message_get_data(messageport_message_t *message);
+
+/**
+ * messageport_message_destroy:
+ * @message: The message returned by #messageport_message_create
+ *
+ * Frees the message. Messages passed to #messageport_message_typed_cb are owned by the library.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid message passed
+ */
+EXPORT_API messageport_error_e
+messageport_message_destroy(messageport_message_t *message);
+
+/**
+ * messageport_message_set_int64:
+ * @message: The message
+ * @key: The key of the value, keys starting with "__MESSAGEPORT_" are reserved
+ * @value: The value
+ *
+ * Sets the value of #key, replacing any earlier value of any type.
+ * messageport_message_set_double(), messageport_message_set_bool(), messageport_message_set_str()
+ * and messageport_message_set_blob() work the same way for their types, strings and blobs are copied.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ */
+EXPORT_API messageport_error_e
+messageport_message_set_int64(messageport_message_t *message, const char *key, int64_t value);
+
+EXPORT_API messageport_error_e
+messageport_message_set_double(messageport_message_t *message, const char *key, double value);
+
+EXPORT_API messageport_error_e
+messageport_message_set_bool(messageport_message_t *message, const char *key, bool value);
+
+EXPORT_API messageport_error_e
+messageport_message_set_str(messageport_message_t *message, const char *key, const char *value);
+
+EXPORT_API messageport_error_e
+messageport_message_set_blob(messageport_message_t *message, const char *key, const void *data, size_t size);
+
+/**
+ * messageport_message_get_int64:
+ * @message: The message
+ * @key: The key to look up
+ * @value: (out): The value
+ *
+ * Looks up the value of #key, which must have been set with the setter of the same type,
+ * no conversion is done. messageport_message_get_double(), messageport_message_get_bool(),
+ * messageport_message_get_str() and messageport_message_get_blob() work the same way for their types.
+ * Strings and blobs are owned by the message, and stay valid until #key is set again.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed, or no value of the type for #key
+ */
+EXPORT_API messageport_error_e
+messageport_message_get_int64(messageport_message_t *message, const char *key, int64_t *value);
+
+EXPORT_API messageport_error_e
+messageport_message_get_double(messageport_message_t *message, const char *key, double *value);
+
+EXPORT_API messageport_error_e
+messageport_message_get_bool(messageport_message_t *message, const char *key, bool *value);
+
+EXPORT_API messageport_error_e
+messageport_message_get_str(messageport_message_t *message, const char *key, const char **value);
+
+EXPORT_API messageport_error_e
+messageport_message_get_blob(messageport_message_t *message, const char *key, const void **data, size_t *size);
+
 /**
  * messageport_unregister_local_port:
  * @local_port_id: The local message port ID
@@ -264,6 +682,46 @@ messageport_check_trusted_remote_port(const char* remote_app_id, const char *rem
 EXPORT_API messageport_error_e
 messageport_send_message(const char* remote_app_id, const char* remote_port, bundle* message);
 
+/**
+ * messageport_send_typed_message:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote port is a trusted port
+ * @message: Message to be passed to the remote application
+ *
+ * Sends a typed message to the message port of a remote application, like #messageport_send_message.
+ * Ports registered with #messageport_register_local_port_typed get the values as they were set,
+ * other ports get a bundle with the strings and blobs as they are, and the numbers and booleans
+ * as strings.
+ *
+ * Returns #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *         #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *         #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *         #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *         #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_typed_message(const char *remote_app_id, const char *remote_port, bool trusted, messageport_message_t *message);
+
+/**
+ * messageport_send_bidirectional_typed_message:
+ * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote port is a trusted port
+ * @message: Message to be passed to the remote application
+ *
+ * Sends a typed message, like #messageport_send_typed_message, the receiver can reply to the local port #id.
+ *
+ * Returns #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *         #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *         #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The local port or the message port of the remote application is not found
+ *         #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *         #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_bidirectional_typed_message(int id, const char *remote_app_id, const char *remote_port, bool trusted, messageport_message_t *message);
+
 /**
  * messageport_send_trusted_message:
  * @remote_app_id: The ID of the remote application
@@ -349,34 +807,620 @@ EXPORT_API messageport_error_e
 messageport_send_bidirectional_trusted_message(int id, const char* remote_app_id, const char* remote_port, bundle* message);
 
 /**
- * messageport_get_local_port_name:
- * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
- * @name: Return location to hold name of the message port or NULL
+ * messageport_send_messages:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE to send the messages to the trusted message port
+ * @messages: Array of messages to be passed to the remote application
+ * @n_messages: Number of messages in #messages
  *
- * Gets the name of the local message port. On success, the #name is filled with the registered message port name, which muste be released with #free().
+ * Sends a batch of messages to the message port of a remote application in a single call.
+ * The remote application receives them one by one, in the same order.
  *
  * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
- *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter
- *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND No local message port found for #id
- *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY Out of memory
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY Memory error occured
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_MAX_EXCEEDED The size of messages has exceeded the maximum limit
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
  */
 EXPORT_API messageport_error_e
-messageport_get_local_port_name(int id, char **name);
+messageport_send_messages(const char *remote_app_id, const char *remote_port, bool trusted, bundle **messages, unsigned int n_messages);
 
 /**
- * messageport_check_trusted_local_port:
- * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
- * @is_trusted: Return location to hold the trusted state of the local messge port
+ * messageport_send_message_multi:
+ * @targets: Array of remote message ports to send the message to
+ * @n_targets: Number of the entries in #targets
+ * @message: Message to be passed to the remote applications, the recommended message size is under 4KB
+ * @results: Return location for #n_targets results, or NULL
  *
- * Checks if the local message port is trusted.
+ * Sends the same message to many remote message ports at once. The message is serialized only once and
+ * delivered to all the ports in a single call, a failure with one port does not stop delivery to the rest.
+ * On success, the result of each port is stored in #results at the index of the port in #targets.
  *
- * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ * Returns: #MESSAGEPORT_ERROR_NONE if the message was handed to the daemon, otherwise a negative error value.
  *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
- *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND No local message port found for #id
  *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY Memory error occured
+ *          #MESSAGEPORT_ERROR_MAX_EXCEEDED The size of message has exceeded the maximum limit
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
  */
 EXPORT_API messageport_error_e
-messageport_check_trusted_local_port(int id, bool *is_trusted);
+messageport_send_message_multi(const messageport_target_s *targets, unsigned int n_targets, bundle *message, messageport_error_e *results);
+
+/**
+ * messageport_send_message_async:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE to send the message to the trusted message port
+ * @message: Message to be passed to the remote application, the recommended message size is under 4KB
+ * @callback: The callback function to be called with the result of the send, or NULL
+ * @userdata: client specific data passed to #callback
+ *
+ * Sends a message to the message port of a remote application without waiting for the daemon to handle it.
+ * The #callback is called with the result from the main context of the calling thread, so many messages
+ * can be in flight at once. The #message can be freed as soon as this call returns.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE if the message was queued, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_message_async(const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, messageport_send_done_cb callback, void *userdata);
+
+/**
+ * messageport_send_bidirectional_message_async:
+ * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE to send the message to the trusted message port
+ * @message: Message to be passed to the remote application, the recommended message size is under 4KB
+ * @callback: The callback function to be called with the result of the send, or NULL
+ * @userdata: client specific data passed to #callback
+ *
+ * Asynchronous version of #messageport_send_bidirectional_message, see #messageport_send_message_async.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE if the message was queued, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND No local message port found for #id
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_bidirectional_message_async(int id, const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, messageport_send_done_cb callback, void *userdata);
+
+/**
+ * messageport_send_typed_message_async:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote port is a trusted port
+ * @message: Message to be passed to the remote application
+ * @callback: The callback function to be called with the result of the send, or NULL
+ * @userdata: client specific data passed to #callback
+ *
+ * Asynchronous version of #messageport_send_typed_message, see #messageport_send_message_async.
+ * The #message can be destroyed as soon as this call returns.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE if the message was queued, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_typed_message_async(const char *remote_app_id, const char *remote_port, bool trusted, messageport_message_t *message, messageport_send_done_cb callback, void *userdata);
+
+/**
+ * messageport_send_bidirectional_typed_message_async:
+ * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote port is a trusted port
+ * @message: Message to be passed to the remote application
+ * @callback: The callback function to be called with the result of the send, or NULL
+ * @userdata: client specific data passed to #callback
+ *
+ * Asynchronous version of #messageport_send_bidirectional_typed_message, see #messageport_send_message_async.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE if the message was queued, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND No local message port found for #id
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_bidirectional_typed_message_async(int id, const char *remote_app_id, const char *remote_port, bool trusted, messageport_message_t *message, messageport_send_done_cb callback, void *userdata);
+
+/**
+ * messageport_send_message_noreply:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE to send the message to the trusted message port
+ * @message: Message to be passed to the remote application, the recommended message size is under 4KB
+ *
+ * Sends a message to the message port of a remote application without asking for any acknowledgement.
+ * Delivery failures are not reported back, they are only counted, see #messageport_get_dropped_message_count.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE if the message was queued, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_message_noreply(const char *remote_app_id, const char *remote_port, bool trusted, bundle *message);
+
+/**
+ * messageport_send_bidirectional_message_noreply:
+ * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE to send the message to the trusted message port
+ * @message: Message to be passed to the remote application, the recommended message size is under 4KB
+ *
+ * Bidirectional version of #messageport_send_message_noreply.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE if the message was queued, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND No local message port found for #id
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_bidirectional_message_noreply(int id, const char *remote_app_id, const char *remote_port, bool trusted, bundle *message);
+
+/**
+ * messageport_send_message_with_fds:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote message port is a trusted port
+ * @message: Message to be passed to the remote application
+ * @fds: The file descriptors to pass along with the message
+ * @n_fds: The number of file descriptors in @fds, at most 253
+ *
+ * Sends a message with file descriptors attached to the message port of a remote application.
+ * The descriptors are duplicated, the caller keeps the ownership of @fds.
+ * A receiver registered with #messageport_register_local_port_with_fds gets its own copies,
+ * other receivers get only the message.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER If any of the parameters or file descriptors is invalid
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_message_with_fds(const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, const int *fds, unsigned int n_fds);
+
+/**
+ * messageport_send_bidirectional_message_with_fds:
+ * @id: The ID of the local message port
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote message port is a trusted port
+ * @message: Message to be passed to the remote application
+ * @fds: The file descriptors to pass along with the message
+ * @n_fds: The number of file descriptors in @fds, at most 253
+ *
+ * Same as #messageport_send_message_with_fds, but the remote application can reply
+ * to the local message port @id.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER If any of the parameters or file descriptors is invalid
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The local or remote message port is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_bidirectional_message_with_fds(int id, const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, const int *fds, unsigned int n_fds);
+
+/**
+ * messageport_get_dropped_message_count:
+ * @count: Return location for the number of messages
+ *
+ * Gets the number of messages sent by the calling thread with #messageport_send_message_noreply or
+ * #messageport_send_bidirectional_message_noreply, that could not be delivered.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_get_dropped_message_count(unsigned int *count);
+
+/**
+ * messageport_get_local_port_name:
+ * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
+ * @name: Return location to hold name of the message port or NULL
+ *
+ * Gets the name of the local message port. On success, the #name is filled with the registered message port name, which muste be released with #free().
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND No local message port found for #id
+ *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY Out of memory
+ */
+EXPORT_API messageport_error_e
+messageport_get_local_port_name(int id, char **name);
+
+/**
+ * messageport_check_trusted_local_port:
+ * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
+ * @is_trusted: Return location to hold the trusted state of the local messge port
+ *
+ * Checks if the local message port is trusted.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND No local message port found for #id
+ *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY Memory error occured
+ */
+EXPORT_API messageport_error_e
+messageport_check_trusted_local_port(int id, bool *is_trusted);
+
+/**
+ * messageport_open_remote_port:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote message port is a trusted port
+ * @handle: Return location for the remote port handle
+ *
+ * Resolves the message port #remote_port of the remote application #remote_app_id once, so that messages
+ * can be sent to it with #messageport_send_message_by_handle without resolving the port on every send.
+ * For trusted ports the certificates of both the applications are verified while opening.
+ * The handle stays valid if the remote port goes away, it is resolved again on the next send.
+ * The handle must be released with #messageport_close_remote_port.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_open_remote_port(const char *remote_app_id, const char *remote_port, bool trusted, messageport_remote_port_h *handle);
+
+/**
+ * messageport_close_remote_port:
+ * @handle: The remote port handle returned by #messageport_open_remote_port
+ *
+ * Releases the remote port handle.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid handle passed
+ */
+EXPORT_API messageport_error_e
+messageport_close_remote_port(messageport_remote_port_h handle);
+
+/**
+ * messageport_remote_port_set_compression:
+ * @handle: The remote port handle returned by #messageport_open_remote_port
+ * @threshold: Minimum serialized size of the messages to compress, in bytes, or 0 to not compress
+ *
+ * Compresses the messages sent with #messageport_send_message_by_handle to the remote port,
+ * if those are at least #threshold bytes big. Worth for big, well compressible messages,
+ * like JSON documents or logs. The receiver decompresses the messages transparently.
+ * Messages are sent uncompressed if the daemon does not support it, or compressing
+ * does not make them any smaller.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid handle passed
+ */
+EXPORT_API messageport_error_e
+messageport_remote_port_set_compression(messageport_remote_port_h handle, unsigned int threshold);
+
+/**
+ * messageport_remote_port_set_schema:
+ * @handle: The remote port handle returned by #messageport_open_remote_port
+ * @keys: The keys of the messages sent to the remote port, or NULL
+ * @n_keys: The number of #keys, or 0 to drop the schema
+ *
+ * Registers #keys as a schema with the daemon. Messages sent with #messageport_send_message_by_handle
+ * that have exactly these keys then carry only the schema id and the values, the receiver gets
+ * the keys back from its cache of the schema. Messages with other keys are sent as they are.
+ * Worth for high rate messages that always have the same keys.
+ * Messages are sent as they are if the daemon does not support schemas.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid handle passed, or #keys are not unique
+ *          #MESSAGEPORT_ERROR_OUT_OF_MEMORY The daemon can not hold more schemas
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_remote_port_set_schema(messageport_remote_port_h handle, const char **keys, int n_keys);
+
+/**
+ * messageport_remote_port_set_delta:
+ * @handle: The remote port handle returned by #messageport_open_remote_port
+ * @enable: Whether to send deltas
+ *
+ * Sends only the values that changed since the previous message sent with #messageport_send_message_by_handle,
+ * and the keys that got removed. The receiver rebuilds the whole message transparently. Worth for
+ * high rate messages that mostly repeat the previous one, like state updates.
+ * A whole message is sent every 32 messages, and whenever the remote port got a new receiver,
+ * so that a receiver that missed one recovers. Deltas take precedence over the schema of the handle.
+ * Messages are sent whole if the daemon does not support deltas.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid handle passed
+ */
+EXPORT_API messageport_error_e
+messageport_remote_port_set_delta(messageport_remote_port_h handle, bool enable);
+
+/**
+ * messageport_send_message_by_handle:
+ * @handle: The remote port handle returned by #messageport_open_remote_port
+ * @message: Message to be passed to the remote application, the recommended message size is under 4KB
+ *
+ * Sends a message to the remote message port referred by #handle.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_message_by_handle(messageport_remote_port_h handle, bundle *message);
+
+/**
+ * messageport_send_bidirectional_message_by_handle:
+ * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
+ * @handle: The remote port handle returned by #messageport_open_remote_port
+ * @message: Message to be passed to the remote application, the recommended message size is under 4KB
+ *
+ * Sends a message to the remote message port referred by #handle, the remote application can send back
+ * the return message to the local message port referred by #id.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND Either the local or the remote message port is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_bidirectional_message_by_handle(int id, messageport_remote_port_h handle, bundle *message);
+
+/**
+ * messageport_send_typed_message_by_handle:
+ * @handle: The remote port handle returned by #messageport_open_remote_port
+ * @message: Message to be passed to the remote application
+ *
+ * Sends a typed message to the remote message port referred by #handle, like #messageport_send_typed_message.
+ * The message is compressed as set by #messageport_remote_port_set_compression, it is not packed by schema
+ * nor sent as a delta.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_typed_message_by_handle(messageport_remote_port_h handle, messageport_message_t *message);
+
+/**
+ * messageport_send_bidirectional_typed_message_by_handle:
+ * @id: The message port id returned by messageport_register_local_port() or messageport_register_trusted_local_port()
+ * @handle: The remote port handle returned by #messageport_open_remote_port
+ * @message: Message to be passed to the remote application
+ *
+ * Sends a typed message, like #messageport_send_typed_message_by_handle, the receiver can reply to the local port #id.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND Either the local or the remote message port is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_send_bidirectional_typed_message_by_handle(int id, messageport_remote_port_h handle, messageport_message_t *message);
+
+/**
+ * messageport_open_channel:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote message port is a trusted port
+ * @channel: Return location for the channel handle
+ *
+ * Opens a channel for high rate streams of small messages to the message port #remote_port of the
+ * remote application #remote_app_id. The port is resolved and the certificates are verified as for
+ * any other message, later messages are passed through a ring in shared memory without going through
+ * the message port daemon. The remote application receives them as messages without a remote port.
+ * The daemon revokes the channel when the remote message port is unregistered.
+ * The handle must be released with #messageport_close_channel.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error, or shared memory is not supported
+ */
+EXPORT_API messageport_error_e
+messageport_open_channel(const char *remote_app_id, const char *remote_port, bool trusted, messageport_channel_h *channel);
+
+/**
+ * messageport_open_peer_channel:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote message port is a trusted port
+ * @channel: Return location for the channel handle
+ *
+ * Opens a direct connection to the message port #remote_port of the remote application #remote_app_id.
+ * The port is resolved and the certificates are verified by the message port daemon, which then hands
+ * one end of a socket pair to each application, later messages are passed on that socket without going
+ * through the daemon. Unlike #messageport_open_channel the size of messages is only limited by the socket
+ * buffers. The remote application receives them as messages without a remote port.
+ * The connection is closed when the remote message port is unregistered.
+ * The handle must be released with #messageport_close_channel.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_open_peer_channel(const char *remote_app_id, const char *remote_port, bool trusted, messageport_channel_h *channel);
+
+/**
+ * messageport_channel_send:
+ * @channel: The channel handle returned by #messageport_open_channel
+ * @message: Message to be passed to the remote application
+ *
+ * Sends a message on the channel, without blocking and without any round trip to the daemon.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE The channel is full, the remote application did not catch up yet
+ *          #MESSAGEPORT_ERROR_MAX_EXCEEDED The message does not fit in the channel
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The channel got revoked
+ */
+EXPORT_API messageport_error_e
+messageport_channel_send(messageport_channel_h channel, bundle *message);
+
+/**
+ * messageport_close_channel:
+ * @channel: The channel handle returned by #messageport_open_channel
+ *
+ * Closes the channel and releases the handle, messages not yet received by the remote application are lost.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid handle passed
+ */
+EXPORT_API messageport_error_e
+messageport_close_channel(messageport_channel_h channel);
+
+/**
+ * messageport_set_stream_handler:
+ * @id: The ID of a registered local message port
+ * @callback: The callback function to be called for each chunk of incoming streams, or NULL to refuse streams
+ * @userdata: client specific data passed to #callback
+ *
+ * Accepts streams opened to the local message port with #messageport_open_stream.
+ * Streams opened to a port without a stream handler are refused.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND No local message port is registered with #id
+ */
+EXPORT_API messageport_error_e
+messageport_set_stream_handler(int id, messageport_stream_cb callback, void *userdata);
+
+/**
+ * messageport_open_stream:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE if the remote message port is a trusted port
+ * @stream: Return location for the stream handle
+ *
+ * Opens a stream to transfer large amounts of data to the message port #remote_port of the remote
+ * application #remote_app_id, without building a single large message. The port is resolved and the
+ * certificates are verified as for any other message, then the data is passed on a socket brokered
+ * by the message port daemon, see #messageport_open_peer_channel.
+ * The handle must be released with #messageport_close_stream.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The message port of the remote application is not found
+ *          #MESSAGEPORT_ERROR_CERTIFICATE_NOT_MATCH The remote application is not signed with the same certificate
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_open_stream(const char *remote_app_id, const char *remote_port, bool trusted, messageport_stream_h *stream);
+
+/**
+ * messageport_stream_write:
+ * @stream: The stream handle returned by #messageport_open_stream
+ * @data: The data to write
+ * @size: The size of #data
+ *
+ * Writes data on the stream, split in chunks of at most 64 KiB, without blocking. Only the chunks
+ * the socket buffers can take are written, so that the memory used on both sides stays bounded
+ * whatever the size of the transfer. The rest is to be written again once the remote application
+ * caught up, see #messageport_stream_set_writable_cb.
+ *
+ * Returns: The number of bytes written on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE Nothing could be written, the remote application did not catch up yet
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The remote message port refused the stream or went away
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API int
+messageport_stream_write(messageport_stream_h stream, const void *data, unsigned int size);
+
+/**
+ * messageport_stream_set_writable_cb:
+ * @stream: The stream handle returned by #messageport_open_stream
+ * @callback: The callback function to be called when the stream can take more data, or NULL
+ * @userdata: client specific data passed to #callback
+ *
+ * Sets the callback telling that the remote application caught up after #messageport_stream_write
+ * or #messageport_close_stream returned #MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE, or after a write
+ * that wrote less than asked. The callback is dispatched on the thread default main context of the caller.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid handle passed
+ */
+EXPORT_API messageport_error_e
+messageport_stream_set_writable_cb(messageport_stream_h stream, messageport_stream_writable_cb callback, void *userdata);
+
+/**
+ * messageport_close_stream:
+ * @stream: The stream handle returned by #messageport_open_stream
+ *
+ * Completes the stream and releases the handle, the remote application receives all the chunks
+ * written so far before the end of the stream. The handle is not released if the end of the stream
+ * could not be queued yet, the call is to be repeated once the stream gets writable.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid handle passed
+ *          #MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE The remote application did not catch up yet, the handle is still valid
+ *          #MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND The remote message port refused the stream or went away
+ */
+EXPORT_API messageport_error_e
+messageport_close_stream(messageport_stream_h stream);
+
+/**
+ * messageport_abort_stream:
+ * @stream: The stream handle returned by #messageport_open_stream
+ *
+ * Releases the handle without completing the stream, the remote application receives the end
+ * of the stream with #MESSAGEPORT_ERROR_IO_ERROR.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid handle passed
+ */
+EXPORT_API messageport_error_e
+messageport_abort_stream(messageport_stream_h stream);
+
+/**
+ * messageport_watch_remote_port:
+ * @remote_app_id: The ID of the remote application
+ * @remote_port: The name of the remote message port
+ * @trusted: TRUE to watch the trusted message port
+ * @callback: The callback function to be called when the remote message port appears or disappears
+ * @userdata: client specific data passed to #callback
+ *
+ * Watches the message port #remote_port of the remote application #remote_app_id, instead of polling
+ * it with #messageport_check_remote_port. The #callback is first called with the current state of the port,
+ * and later whenever the port is registered or unregistered, or the remote application quits.
+ * The callbacks are dispatched on the main context of the calling thread.
+ * For trusted ports the certificates are verified only when sending the message.
+ *
+ * Returns: A watch id on success, that can be passed to #messageport_unwatch_remote_port, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER Invalid parameter passed
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API int
+messageport_watch_remote_port(const char *remote_app_id, const char *remote_port, bool trusted, messageport_remote_port_watch_cb callback, void *userdata);
+
+/**
+ * messageport_unwatch_remote_port:
+ * @watch_id: The watch id returned by #messageport_watch_remote_port
+ *
+ * Stops watching the remote message port, #callback is not called anymore for this watch.
+ * It must be called from the same thread that added the watch.
+ *
+ * Returns: #MESSAGEPORT_ERROR_NONE on success, otherwise a negative error value.
+ *          #MESSAGEPORT_ERROR_INVALID_PARAMETER No watch found for #watch_id
+ *          #MESSAGEPORT_ERROR_IO_ERROR Internal I/O error
+ */
+EXPORT_API messageport_error_e
+messageport_unwatch_remote_port(int watch_id);
 
 G_END_DECLS
 
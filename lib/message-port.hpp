@@ -0,0 +1,377 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C++; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MESSAGE_PORT_HPP
+#define __MESSAGE_PORT_HPP
+
+#if __cplusplus < 201703L
+#error "message-port.hpp needs C++17"
+#endif
+
+#include <message-port.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * Header only C++ layer over the C API: ports are registered and opened
+ * for the lifetime of their objects, messages are move-only owners, and
+ * the values of received messages are read in place, without copies.
+ * Handlers are called on the thread running the default main context,
+ * and must not throw.
+ */
+namespace messageport {
+
+using Error = messageport_error_e;
+
+struct Blob {
+    const uint8_t *data;
+    size_t         size;
+};
+
+/* who sent a message, only valid while the handler runs */
+struct Sender {
+    std::string_view appId; /* empty unless the message is bidirectional */
+    std::string_view port;  /* empty unless the message is bidirectional */
+    bool             trusted;
+};
+
+namespace detail {
+
+inline std::string_view view (const char *str)
+{
+    return str ? std::string_view (str) : std::string_view ();
+}
+
+/* see message-port-coro.hpp */
+struct RegisterOperation;
+
+} // namespace detail
+
+/*
+ * A bundle to send, freed with the object.
+ */
+class Bundle {
+public:
+    Bundle () : m_bundle (bundle_create ()) { }
+    /* takes b */
+    explicit Bundle (bundle *b) : m_bundle (b) { }
+    ~Bundle () { if (m_bundle) bundle_free (m_bundle); }
+
+    Bundle (Bundle &&other) noexcept : m_bundle (std::exchange (other.m_bundle, nullptr)) { }
+    Bundle &operator= (Bundle &&other) noexcept {
+        if (this != &other) {
+            if (m_bundle) bundle_free (m_bundle);
+            m_bundle = std::exchange (other.m_bundle, nullptr);
+        }
+        return *this;
+    }
+    Bundle (const Bundle &) = delete;
+    Bundle &operator= (const Bundle &) = delete;
+
+    explicit operator bool () const { return m_bundle != nullptr; }
+
+    bool add (const char *key, const char *value) { return bundle_add (m_bundle, key, value) == 0; }
+    bool add (const char *key, const std::string &value) { return add (key, value.c_str ()); }
+    bool addBytes (const char *key, const void *data, size_t size) { return bundle_add_byte (m_bundle, key, data, size) == 0; }
+
+    std::optional<std::string_view> getString (const char *key) const {
+        const char *value = bundle_get_val (m_bundle, key);
+        if (!value) return std::nullopt;
+        return std::string_view (value);
+    }
+
+    bundle *get () const { return m_bundle; }
+    bundle *release () { return std::exchange (m_bundle, nullptr); }
+
+private:
+    bundle *m_bundle;
+};
+
+/*
+ * A received bundle message, values point into the received data and
+ * are only valid while the handler runs.
+ */
+class BundleView {
+public:
+    explicit BundleView (messageport_message_view_h message) : m_message (message) { }
+
+    std::optional<std::string_view> getString (const char *key) const {
+        const char *value = nullptr;
+        if (messageport_message_view_get_str (m_message, key, &value) != MESSAGEPORT_ERROR_NONE) return std::nullopt;
+        return std::string_view (value);
+    }
+
+    std::optional<Blob> getBytes (const char *key) const {
+        const void *data = nullptr;
+        size_t size = 0;
+        if (messageport_message_view_get_byte (m_message, key, &data, &size) != MESSAGEPORT_ERROR_NONE) return std::nullopt;
+        return Blob { static_cast<const uint8_t *> (data), size };
+    }
+
+    std::optional<std::vector<std::string_view>> getStringArray (const char *key) const {
+        const char **array = nullptr;
+        int len = 0;
+        if (messageport_message_view_get_str_array (m_message, key, &array, &len) != MESSAGEPORT_ERROR_NONE) return std::nullopt;
+        return std::vector<std::string_view> (array, array + len);
+    }
+
+    /* copies the message, to keep it after the handler returns */
+    Bundle toBundle () const { return Bundle (messageport_message_view_to_bundle (m_message)); }
+
+    messageport_message_view_h get () const { return m_message; }
+
+private:
+    messageport_message_view_h m_message;
+};
+
+/*
+ * A received typed message, values point into the received data.
+ */
+class MessageView {
+public:
+    explicit MessageView (messageport_message_t *message) : m_message (message) { }
+
+    std::optional<int64_t> getInt64 (const char *key) const {
+        int64_t value = 0;
+        if (messageport_message_get_int64 (m_message, key, &value) != MESSAGEPORT_ERROR_NONE) return std::nullopt;
+        return value;
+    }
+
+    std::optional<double> getDouble (const char *key) const {
+        double value = 0;
+        if (messageport_message_get_double (m_message, key, &value) != MESSAGEPORT_ERROR_NONE) return std::nullopt;
+        return value;
+    }
+
+    std::optional<bool> getBool (const char *key) const {
+        bool value = false;
+        if (messageport_message_get_bool (m_message, key, &value) != MESSAGEPORT_ERROR_NONE) return std::nullopt;
+        return value;
+    }
+
+    std::optional<std::string_view> getString (const char *key) const {
+        const char *value = nullptr;
+        if (messageport_message_get_str (m_message, key, &value) != MESSAGEPORT_ERROR_NONE) return std::nullopt;
+        return std::string_view (value);
+    }
+
+    std::optional<Blob> getBlob (const char *key) const {
+        const void *data = nullptr;
+        size_t size = 0;
+        if (messageport_message_get_blob (m_message, key, &data, &size) != MESSAGEPORT_ERROR_NONE) return std::nullopt;
+        return Blob { static_cast<const uint8_t *> (data), size };
+    }
+
+    messageport_message_t *get () const { return m_message; }
+
+protected:
+    messageport_message_t *m_message;
+};
+
+/*
+ * A typed message to send, freed with the object.
+ */
+class Message : public MessageView {
+public:
+    Message () : MessageView (messageport_message_create ()) { }
+    /* takes data, as built by msgport-codegen generated encoders */
+    explicit Message (GVariant *data) : MessageView (messageport_message_create_from_data (data)) { }
+    ~Message () { if (m_message) messageport_message_destroy (m_message); }
+
+    Message (Message &&other) noexcept : MessageView (std::exchange (other.m_message, nullptr)) { }
+    Message &operator= (Message &&other) noexcept {
+        if (this != &other) {
+            if (m_message) messageport_message_destroy (m_message);
+            m_message = std::exchange (other.m_message, nullptr);
+        }
+        return *this;
+    }
+    Message (const Message &) = delete;
+    Message &operator= (const Message &) = delete;
+
+    Error setInt64 (const char *key, int64_t value) { return messageport_message_set_int64 (m_message, key, value); }
+    Error setDouble (const char *key, double value) { return messageport_message_set_double (m_message, key, value); }
+    Error setBool (const char *key, bool value) { return messageport_message_set_bool (m_message, key, value); }
+    Error setString (const char *key, const char *value) { return messageport_message_set_str (m_message, key, value); }
+    Error setString (const char *key, const std::string &value) { return setString (key, value.c_str ()); }
+    Error setString (const char *key, std::string_view value) { return setString (key, std::string (value)); }
+    Error setBlob (const char *key, const void *data, size_t size) { return messageport_message_set_blob (m_message, key, data, size); }
+};
+
+/*
+ * A registered local port, unregistered with the object. The handler
+ * lives on the heap, so that the port can be moved while registered.
+ */
+class LocalPort {
+public:
+    using Handler = std::function<void (const Sender &, MessageView)>;
+    using BundleHandler = std::function<void (const Sender &, BundleView)>;
+
+    /* messages are received as typed messages, bundles sent to the port too */
+    LocalPort (const char *name, bool trusted, Handler handler)
+        : m_handlers (new Handlers { std::move (handler), nullptr }), m_trusted (trusted) {
+        m_id = messageport_register_local_port_typed (name, trusted, &LocalPort::onMessage, m_handlers.get ());
+    }
+
+    /* bundles are read in place, without building a bundle for each message */
+    LocalPort (const char *name, bool trusted, BundleHandler handler)
+        : m_handlers (new Handlers { nullptr, std::move (handler) }), m_trusted (trusted) {
+        m_id = messageport_register_local_port_with_view (name, trusted, &LocalPort::onBundle, m_handlers.get ());
+    }
+
+    ~LocalPort () { unregister (); }
+
+    LocalPort (LocalPort &&other) noexcept
+        : m_handlers (std::move (other.m_handlers)), m_id (std::exchange (other.m_id, 0)), m_trusted (other.m_trusted) { }
+    LocalPort &operator= (LocalPort &&other) noexcept {
+        if (this != &other) {
+            unregister ();
+            m_handlers = std::move (other.m_handlers);
+            m_id = std::exchange (other.m_id, 0);
+            m_trusted = other.m_trusted;
+        }
+        return *this;
+    }
+    LocalPort (const LocalPort &) = delete;
+    LocalPort &operator= (const LocalPort &) = delete;
+
+    explicit operator bool () const { return m_id > 0; }
+    /* why registering failed */
+    Error error () const { return m_id > 0 ? MESSAGEPORT_ERROR_NONE : static_cast<Error> (m_id); }
+    int id () const { return m_id; }
+    bool trusted () const { return m_trusted; }
+
+private:
+    friend struct detail::RegisterOperation;
+    friend class RegisterAwaiter;
+
+    struct Handlers {
+        Handler       message;
+        BundleHandler bundle;
+    };
+
+    /* adopts a port registered with onMessage or onBundle and handlers as userdata */
+    LocalPort (std::unique_ptr<Handlers> handlers, int id, bool trusted)
+        : m_handlers (std::move (handlers)), m_id (id), m_trusted (trusted) { }
+
+    void unregister () {
+        if (m_id <= 0) return;
+        if (m_trusted) messageport_unregister_trusted_local_port (m_id);
+        else messageport_unregister_local_port (m_id);
+        m_id = 0;
+    }
+
+    static void onMessage (int, const char *app_id, const char *port, bool trusted, messageport_message_t *message, void *userdata) noexcept {
+        static_cast<Handlers *> (userdata)->message (Sender { detail::view (app_id), detail::view (port), trusted },
+                                                     MessageView (message));
+    }
+
+    static void onBundle (int, const char *app_id, const char *port, bool trusted, messageport_message_view_h message, void *userdata) noexcept {
+        static_cast<Handlers *> (userdata)->bundle (Sender { detail::view (app_id), detail::view (port), trusted },
+                                                    BundleView (message));
+    }
+
+    std::unique_ptr<Handlers> m_handlers;
+    int  m_id;
+    bool m_trusted;
+};
+
+/*
+ * An opened remote port, closed with the object.
+ */
+class RemotePort {
+public:
+    RemotePort (std::string appId, std::string port, bool trusted)
+        : m_appId (std::move (appId)), m_port (std::move (port)), m_trusted (trusted), m_handle (nullptr) {
+        m_error = messageport_open_remote_port (m_appId.c_str (), m_port.c_str (), trusted, &m_handle);
+    }
+
+    ~RemotePort () { if (m_handle) messageport_close_remote_port (m_handle); }
+
+    RemotePort (RemotePort &&other) noexcept
+        : m_appId (std::move (other.m_appId)), m_port (std::move (other.m_port)), m_trusted (other.m_trusted),
+          m_handle (std::exchange (other.m_handle, nullptr)), m_error (other.m_error) { }
+    RemotePort &operator= (RemotePort &&other) noexcept {
+        if (this != &other) {
+            if (m_handle) messageport_close_remote_port (m_handle);
+            m_appId = std::move (other.m_appId);
+            m_port = std::move (other.m_port);
+            m_trusted = other.m_trusted;
+            m_handle = std::exchange (other.m_handle, nullptr);
+            m_error = other.m_error;
+        }
+        return *this;
+    }
+    RemotePort (const RemotePort &) = delete;
+    RemotePort &operator= (const RemotePort &) = delete;
+
+    explicit operator bool () const { return m_handle != nullptr; }
+    /* why opening failed */
+    Error error () const { return m_error; }
+    const std::string &appId () const { return m_appId; }
+    const std::string &port () const { return m_port; }
+    bool trusted () const { return m_trusted; }
+    messageport_remote_port_h get () const { return m_handle; }
+
+    Error send (const Bundle &message) {
+        if (!m_handle) return m_error;
+        return messageport_send_message_by_handle (m_handle, message.get ());
+    }
+
+    Error send (const Bundle &message, const LocalPort &from) {
+        if (!m_handle) return m_error;
+        return messageport_send_bidirectional_message_by_handle (from.id (), m_handle, message.get ());
+    }
+
+    Error send (const MessageView &message) {
+        if (!m_handle) return m_error;
+        return messageport_send_typed_message_by_handle (m_handle, message.get ());
+    }
+
+    Error send (const MessageView &message, const LocalPort &from) {
+        if (!m_handle) return m_error;
+        return messageport_send_bidirectional_typed_message_by_handle (from.id (), m_handle, message.get ());
+    }
+
+    Error setCompression (unsigned int threshold) { return messageport_remote_port_set_compression (m_handle, threshold); }
+    Error setDelta (bool enable) { return messageport_remote_port_set_delta (m_handle, enable); }
+
+private:
+    std::string m_appId;
+    std::string m_port;
+    bool        m_trusted;
+    messageport_remote_port_h m_handle;
+    Error       m_error;
+};
+
+} // namespace messageport
+
+#endif /* __MESSAGE_PORT_HPP */
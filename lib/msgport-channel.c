@@ -0,0 +1,497 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "msgport-channel.h"
+#include "common/ring-buffer.h"
+#include "common/log.h"
+
+#include <errno.h>
+#include <glib-unix.h>
+#include <glib-object.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* packets read from a socket channel at once */
+#define MSGPORT_CHANNEL_MAX_BURST 32
+
+/*
+ * Either a shared memory ring with an eventfd doorbell, or one end of
+ * a SOCK_SEQPACKET socket pair brokered by the daemon. Streams are socket
+ * channels carrying raw chunks, an empty packet marks the end of a stream.
+ */
+struct _messageport_channel_s
+{
+    MsgPortManager            *manager; /* NULL on the receiving end */
+    guint                      id;
+    MsgPortRing               *ring; /* NULL for socket channels */
+    gint                       fd; /* doorbell or socket */
+    gboolean                   is_stream;
+    GSource                   *source;
+    MsgPortChannelMessageFunc  func;
+    gpointer                   userdata;
+    GDestroyNotify             destroy;
+    gboolean                  *freed; /* set while delivering, func might free the channel */
+    /* sending end of streams */
+    gboolean                   is_full; /* the last write left data behind */
+    GSource                   *writable_source;
+    GMainContext              *writable_context;
+    MsgPortChannelWritableFunc writable_func;
+    gpointer                   writable_userdata;
+};
+
+/*
+ * Takes the ownership of ring_fd and doorbell_fd, even on failure.
+ */
+MsgPortChannel *
+msgport_channel_new (MsgPortManager *manager, guint channel_id, gint ring_fd, gint doorbell_fd)
+{
+    GError *error = NULL;
+    MsgPortChannel *channel = NULL;
+    MsgPortRing *ring = msgport_ring_map (ring_fd, &error);
+
+    close (ring_fd);
+
+    if (!ring) {
+        WARN ("Failed to map ring of channel %u : %s", channel_id, error->message);
+        g_error_free (error);
+        close (doorbell_fd);
+        return NULL;
+    }
+
+    channel = g_slice_new0 (MsgPortChannel);
+    channel->manager = manager ? g_object_ref (manager) : NULL;
+    channel->id = channel_id;
+    channel->ring = ring;
+    channel->fd = doorbell_fd;
+
+    return channel;
+}
+
+/*
+ * Takes the ownership of socket_fd.
+ */
+MsgPortChannel *
+msgport_channel_new_socket (MsgPortManager *manager, guint channel_id, gint socket_fd)
+{
+    MsgPortChannel *channel = g_slice_new0 (MsgPortChannel);
+
+    channel->manager = manager ? g_object_ref (manager) : NULL;
+    channel->id = channel_id;
+    channel->fd = socket_fd;
+
+    return channel;
+}
+
+/*
+ * Takes the ownership of socket_fd.
+ */
+MsgPortChannel *
+msgport_channel_new_stream (MsgPortManager *manager, guint stream_id, gint socket_fd)
+{
+    MsgPortChannel *channel = msgport_channel_new_socket (manager, stream_id, socket_fd);
+
+    channel->is_stream = TRUE;
+
+    return channel;
+}
+
+void
+msgport_channel_free (MsgPortChannel *channel)
+{
+    g_return_if_fail (channel);
+
+    if (channel->freed) *channel->freed = TRUE;
+    if (channel->source) {
+        g_source_destroy (channel->source);
+        g_source_unref (channel->source);
+    }
+    if (channel->writable_source) {
+        g_source_destroy (channel->writable_source);
+        g_source_unref (channel->writable_source);
+    }
+    if (channel->writable_context) g_main_context_unref (channel->writable_context);
+    if (channel->destroy) channel->destroy (channel->userdata);
+
+    if (channel->ring) msgport_ring_unmap (channel->ring);
+    close (channel->fd);
+    if (channel->manager) g_object_unref (channel->manager);
+
+    g_slice_free (MsgPortChannel, channel);
+}
+
+guint
+msgport_channel_id (MsgPortChannel *channel)
+{
+    g_return_val_if_fail (channel, 0);
+
+    return channel->id;
+}
+
+MsgPortManager *
+msgport_channel_get_manager (MsgPortChannel *channel)
+{
+    g_return_val_if_fail (channel, NULL);
+
+    return channel->manager;
+}
+
+static messageport_error_e
+_channel_send_ring (MsgPortChannel *channel, gconstpointer data, gsize size)
+{
+    gboolean wake_up = FALSE;
+    guint64 one = 1;
+
+    if (msgport_ring_is_revoked (channel->ring))
+        return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
+    if (size > msgport_ring_max_message_size (channel->ring))
+        return MESSAGEPORT_ERROR_MAX_EXCEEDED;
+    if (!msgport_ring_write (channel->ring, data, (guint32)size, &wake_up))
+        return MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE;
+
+    if (wake_up && write (channel->fd, &one, sizeof (one)) < 0)
+        WARN ("Failed to ring doorbell of channel %u : %s", channel->id, strerror (errno));
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+static messageport_error_e
+_channel_send_socket (MsgPortChannel *channel, gconstpointer data, gsize size)
+{
+    /* the size header keeps packets non empty, so that they differ from end of stream */
+    guint32 header = (guint32)size;
+    struct iovec iov[2] = { { &header, sizeof (header) }, { (gpointer)data, size } };
+    struct msghdr msg;
+
+    memset (&msg, 0, sizeof (msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = size ? 2 : 1;
+
+    while (sendmsg (channel->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        switch (errno) {
+            case EINTR:
+                continue;
+            case EAGAIN:
+                return MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE;
+            case EMSGSIZE:
+                return MESSAGEPORT_ERROR_MAX_EXCEEDED;
+            case EPIPE:
+            case ECONNRESET:
+                return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
+            default:
+                WARN ("Failed to send on channel %u : %s", channel->id, strerror (errno));
+                return MESSAGEPORT_ERROR_IO_ERROR;
+        }
+    }
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+gboolean
+msgport_channel_is_socket (MsgPortChannel *channel)
+{
+    g_return_val_if_fail (channel, FALSE);
+
+    return channel->ring == NULL;
+}
+
+messageport_error_e
+msgport_channel_send (MsgPortChannel *channel, GVariant *data)
+{
+    messageport_error_e err;
+
+    g_return_val_if_fail (channel && data, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail (!channel->is_stream, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    g_variant_ref_sink (data);
+
+    if (channel->ring)
+        err = _channel_send_ring (channel, g_variant_get_data (data), g_variant_get_size (data));
+    else
+        err = _channel_send_socket (channel, g_variant_get_data (data), g_variant_get_size (data));
+
+    g_variant_unref (data);
+
+    return err;
+}
+
+static gboolean
+_channel_on_writable (gint fd, GIOCondition condition, gpointer userdata)
+{
+    MsgPortChannel *channel = (MsgPortChannel *)userdata;
+
+    g_source_unref (channel->writable_source);
+    channel->writable_source = NULL;
+    channel->is_full = FALSE;
+
+    /* might write again, or free the channel */
+    channel->writable_func (channel, channel->writable_userdata);
+
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Watches the socket until the receiver catches up, if anyone is to be told.
+ */
+static void
+_channel_watch_writable (MsgPortChannel *channel)
+{
+    channel->is_full = TRUE;
+
+    if (!channel->writable_func || channel->writable_source) return;
+
+    channel->writable_source = g_unix_fd_source_new (channel->fd, G_IO_OUT | G_IO_HUP | G_IO_ERR);
+    g_source_set_callback (channel->writable_source, (GSourceFunc)_channel_on_writable, channel, NULL);
+    g_source_attach (channel->writable_source, channel->writable_context);
+}
+
+/*
+ * Never blocks, a receiver that does not read must not hang the sender, nor
+ * a stream to a port of the same thread deadlock. Writes as many chunks as
+ * the socket takes, RESOURCE_UNAVAILABLE if it took none.
+ */
+messageport_error_e
+msgport_channel_write (MsgPortChannel *channel, gconstpointer data, gsize size, gsize *written)
+{
+    messageport_error_e err = MESSAGEPORT_ERROR_NONE;
+    const guint8 *chunk = data;
+    gsize n_written = 0;
+
+    g_return_val_if_fail (channel && (data || !size) && written, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail (channel->is_stream, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    while (n_written < size) {
+        gsize chunk_size = MIN (size - n_written, MSGPORT_CHANNEL_CHUNK_SIZE);
+
+        err = _channel_send_socket (channel, chunk + n_written, chunk_size);
+        if (err != MESSAGEPORT_ERROR_NONE) break;
+        n_written += chunk_size;
+    }
+
+    if (err == MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE) {
+        _channel_watch_writable (channel);
+        if (n_written > 0) err = MESSAGEPORT_ERROR_NONE;
+    }
+
+    *written = n_written;
+
+    return err;
+}
+
+/*
+ * RESOURCE_UNAVAILABLE if the end marker could not be queued yet, to be
+ * retried once the stream gets writable.
+ */
+messageport_error_e
+msgport_channel_finish (MsgPortChannel *channel)
+{
+    messageport_error_e err;
+
+    g_return_val_if_fail (channel && channel->is_stream, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    /* queued behind the chunks, so the receiver gets them all first */
+    err = _channel_send_socket (channel, NULL, 0);
+    if (err == MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE) _channel_watch_writable (channel);
+
+    return err;
+}
+
+/*
+ * Sending end of streams, func is called on context once the receiver caught
+ * up after a write or finish that returned RESOURCE_UNAVAILABLE or wrote
+ * less than asked. A NULL func stops watching.
+ */
+void
+msgport_channel_set_writable_func (MsgPortChannel *channel, GMainContext *context, MsgPortChannelWritableFunc func, gpointer userdata)
+{
+    g_return_if_fail (channel && channel->is_stream);
+
+    if (channel->writable_source) {
+        g_source_destroy (channel->writable_source);
+        g_source_unref (channel->writable_source);
+        channel->writable_source = NULL;
+    }
+    if (channel->writable_context) g_main_context_unref (channel->writable_context);
+
+    channel->writable_context = context ? g_main_context_ref (context) : NULL;
+    channel->writable_func = func;
+    channel->writable_userdata = userdata;
+
+    if (channel->is_full) _channel_watch_writable (channel);
+}
+
+/*
+ * Returns FALSE if the channel got freed meanwhile, say by a message
+ * handler unregistering its port.
+ */
+static gboolean
+_channel_deliver (MsgPortChannel *channel, gpointer data, guint32 size)
+{
+    gboolean freed = FALSE;
+    GVariant *v = g_variant_ref_sink (g_variant_new_from_data (
+            channel->is_stream ? G_VARIANT_TYPE_BYTESTRING : G_VARIANT_TYPE_VARDICT,
+            data, size, FALSE, g_free, data));
+
+    channel->freed = &freed;
+    channel->func (channel, v, channel->userdata);
+    g_variant_unref (v);
+
+    if (freed) return FALSE;
+    channel->freed = NULL;
+
+    return TRUE;
+}
+
+static gboolean
+_channel_on_doorbell (gint fd, GIOCondition condition, gpointer userdata)
+{
+    MsgPortChannel *channel = (MsgPortChannel *)userdata;
+    guint64 count = 0;
+    guint32 size = 0;
+    gpointer data = NULL;
+
+    /* the counter is only a wake up, the records are in the ring */
+    if (read (fd, &count, sizeof (count)) < 0 && errno != EAGAIN)
+        WARN ("Failed to read doorbell of channel %u : %s", channel->id, strerror (errno));
+
+    do {
+        while ((data = msgport_ring_read (channel->ring, &size)) != NULL)
+            if (!_channel_deliver (channel, data, size)) return G_SOURCE_REMOVE;
+    } while (!msgport_ring_is_revoked (channel->ring) && !msgport_ring_wait (channel->ring));
+
+    if (msgport_ring_is_revoked (channel->ring)) {
+        /* might free the channel */
+        channel->func (channel, NULL, channel->userdata);
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_channel_on_socket (gint fd, GIOCondition condition, gpointer userdata)
+{
+    MsgPortChannel *channel = (MsgPortChannel *)userdata;
+    guint32 header = 0;
+    gpointer data = NULL;
+    ssize_t len;
+    guint n_packets = 0;
+
+    for (;;) {
+        struct iovec iov[2];
+        struct msghdr msg;
+
+        /* a busy sender should not starve the other sources of the context */
+        if (n_packets++ == MSGPORT_CHANNEL_MAX_BURST) return G_SOURCE_CONTINUE;
+
+        /* the packet length, without consuming it */
+        len = recv (fd, NULL, 0, MSG_DONTWAIT | MSG_PEEK | MSG_TRUNC);
+        if (len < 0 && errno == EINTR) continue;
+        if (len < 0 && errno == EAGAIN) return G_SOURCE_CONTINUE;
+        if (len < (ssize_t)sizeof (header)) break;
+
+        data = g_malloc (MAX (len - sizeof (header), 1));
+        iov[0].iov_base = &header;
+        iov[0].iov_len = sizeof (header);
+        iov[1].iov_base = data;
+        iov[1].iov_len = len - sizeof (header);
+        memset (&msg, 0, sizeof (msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+
+        if (recvmsg (fd, &msg, MSG_DONTWAIT) != len || header != len - sizeof (header)) {
+            g_free (data);
+            break;
+        }
+
+        if (channel->is_stream && header == 0) {
+            /* end of stream, might free the channel */
+            _channel_deliver (channel, data, 0);
+            return G_SOURCE_REMOVE;
+        }
+
+        /* refused streams and handlers unregistering their port free the channel */
+        if (!_channel_deliver (channel, data, header)) return G_SOURCE_REMOVE;
+    }
+
+    /* end of stream, the other end got closed */
+    DBG ("Channel %u got closed", channel->id);
+    /* might free the channel */
+    channel->func (channel, NULL, channel->userdata);
+
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * The daemon told the ring is no more. Sending fails from now on, the
+ * receiving end delivers what is left in the ring and calls func with
+ * NULL data.
+ */
+void
+msgport_channel_revoke (MsgPortChannel *channel)
+{
+    guint64 one = 1;
+
+    g_return_if_fail (channel && channel->ring);
+
+    DBG ("Channel %u got revoked", channel->id);
+    msgport_ring_revoke (channel->ring);
+
+    if (channel->source && write (channel->fd, &one, sizeof (one)) < 0)
+        WARN ("Failed to ring doorbell of channel %u : %s", channel->id, strerror (errno));
+}
+
+/*
+ * Receiving end, func is called on context for every message on the channel.
+ */
+void
+msgport_channel_attach (MsgPortChannel *channel, GMainContext *context, MsgPortChannelMessageFunc func, gpointer userdata, GDestroyNotify destroy)
+{
+    g_return_if_fail (channel && func);
+    g_return_if_fail (channel->source == NULL);
+
+    channel->func = func;
+    channel->userdata = userdata;
+    channel->destroy = destroy;
+
+    if (!channel->ring) {
+        channel->source = g_unix_fd_source_new (channel->fd, G_IO_IN | G_IO_HUP | G_IO_ERR);
+        g_source_set_callback (channel->source, (GSourceFunc)_channel_on_socket, channel, NULL);
+        g_source_attach (channel->source, context);
+        return;
+    }
+
+    channel->source = g_unix_fd_source_new (channel->fd, G_IO_IN);
+    g_source_set_callback (channel->source, (GSourceFunc)_channel_on_doorbell, channel, NULL);
+    g_source_attach (channel->source, context);
+
+    /* records written before we got here */
+    if (!msgport_ring_wait (channel->ring)) {
+        guint64 one = 1;
+        if (write (channel->fd, &one, sizeof (one)) < 0)
+            WARN ("Failed to ring doorbell of channel %u : %s", channel->id, strerror (errno));
+    }
+}
@@ -0,0 +1,89 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MSGPORT_CHANNEL_H
+#define __MSGPORT_CHANNEL_H
+
+#include <glib.h>
+#include <message-port.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MsgPortManager MsgPortManager;
+typedef struct _messageport_channel_s MsgPortChannel;
+
+/* largest chunk written on a stream at once */
+#define MSGPORT_CHANNEL_CHUNK_SIZE (64 * 1024)
+
+/*
+ * data is NULL once the channel got revoked. On streams data is a bytestring
+ * holding a chunk, and an empty one marks the end of the stream.
+ */
+typedef void (*MsgPortChannelMessageFunc) (MsgPortChannel *channel, GVariant *data, gpointer userdata);
+
+typedef void (*MsgPortChannelWritableFunc) (MsgPortChannel *channel, gpointer userdata);
+
+MsgPortChannel *
+msgport_channel_new (MsgPortManager *manager, guint channel_id, gint ring_fd, gint doorbell_fd);
+
+MsgPortChannel *
+msgport_channel_new_socket (MsgPortManager *manager, guint channel_id, gint socket_fd);
+
+MsgPortChannel *
+msgport_channel_new_stream (MsgPortManager *manager, guint stream_id, gint socket_fd);
+
+void
+msgport_channel_free (MsgPortChannel *channel);
+
+guint
+msgport_channel_id (MsgPortChannel *channel);
+
+MsgPortManager *
+msgport_channel_get_manager (MsgPortChannel *channel);
+
+gboolean
+msgport_channel_is_socket (MsgPortChannel *channel);
+
+messageport_error_e
+msgport_channel_send (MsgPortChannel *channel, GVariant *data);
+
+messageport_error_e
+msgport_channel_write (MsgPortChannel *channel, gconstpointer data, gsize size, gsize *written);
+
+messageport_error_e
+msgport_channel_finish (MsgPortChannel *channel);
+
+void
+msgport_channel_set_writable_func (MsgPortChannel *channel, GMainContext *context, MsgPortChannelWritableFunc func, gpointer userdata);
+
+void
+msgport_channel_revoke (MsgPortChannel *channel);
+
+void
+msgport_channel_attach (MsgPortChannel *channel, GMainContext *context, MsgPortChannelMessageFunc func, gpointer userdata, GDestroyNotify destroy);
+
+G_END_DECLS
+
+#endif /* __MSGPORT_CHANNEL_H */
@@ -24,15 +24,22 @@
  */
 #include "config.h" /* MESSAGEPORT_BUS_ADDRESS */
 
+#include "msgport-channel.h"
 #include "msgport-manager.h"
 #include "msgport-service.h"
 #include "msgport-utils.h" /* msgport_daemon_error_to_error */
 #include "common/dbus-manager-glue.h"
+#include "common/delta.h"
+#include "common/features.h"
+#include "common/memfd.h"
 #ifdef  USE_SESSION_BUS
 #include "common/dbus-server-glue.h"
 #endif
 #include "common/log.h"
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+#include <stdlib.h> /* strtoul */
+#include <unistd.h> /* close */
 
 struct _MsgPortManager
 {
@@ -41,7 +48,46 @@ struct _MsgPortManager
     MsgPortDbusGlueManager *proxy;
     GHashTable *services; /* {gchar*:MsgPortService*} */
     GHashTable *local_services; /* {gint: gchar *} */ 
-    GHashTable *remote_services; /* {gint: gchar *} */
+    GHashTable *remote_services; /* {gchar *: guint} resolved remote service ids */
+    GHashTable *remote_ports; /* {MsgPortRemotePort *} opened remote port handles */
+    GHashTable *watches; /* {guint: MsgPortWatch*} remote port watches */
+    GHashTable *watched_ports; /* {gchar *: MsgPortWatchedPort*} ports watched on the daemon */
+    guint       last_watch_id;
+    GMainContext *context; /* context the manager signals are dispatched on */
+    guint       fd_message_filter_id;
+    GHashTable *incoming_channels; /* {guint: MsgPortIncomingChannel*} channels and streams opened to local services */
+    GHashTable *channels; /* {guint: MsgPortChannel*} rings opened to remote services */
+    guint       features; /* MsgPortFeatures the daemon agreed on */
+    GHashTable *schemas; /* {guint: GStrv} keys of the schemas seen so far */
+};
+
+typedef struct {
+    gchar   *app_id;
+    gchar   *port_name;
+    gboolean is_trusted;
+    guint    service_id; /* 0 if the port is not available */
+    guint    n_watches;
+} MsgPortWatchedPort;
+
+typedef struct {
+    guint               id;
+    MsgPortWatchedPort *port;
+    messageport_remote_port_watch_cb cb;
+    void               *userdata;
+} MsgPortWatch;
+
+struct _messageport_remote_port_s
+{
+    MsgPortManager *manager;
+    gchar          *app_id;
+    gchar          *port_name;
+    gboolean        is_trusted;
+    guint           service_id; /* 0 if invalidated, resolved again on next send */
+    gsize           compress_threshold; /* 0 if messages are not compressed */
+    guint           schema_id; /* 0 if messages are sent as maps */
+    const gchar * const *schema_keys; /* owned by the manager schemas table */
+    MsgPortDeltaSource *delta; /* NULL if messages are sent whole */
+    guint           delta_service_id; /* service the last delta went to */
 };
 
 G_DEFINE_TYPE (MsgPortManager, msgport_manager, G_TYPE_OBJECT)
@@ -54,11 +100,40 @@ _unregister_service_cb (int service_id, const gchar *object_path, MsgPortManager
     if (service) msgport_service_unregister (service);
 }
 
+static void
+_watched_port_free (MsgPortWatchedPort *port)
+{
+    g_free (port->app_id);
+    g_free (port->port_name);
+    g_slice_free (MsgPortWatchedPort, port);
+}
+
+static void
+_watch_free (MsgPortWatch *watch)
+{
+    g_slice_free (MsgPortWatch, watch);
+}
+
 static void
 _finalize (GObject *self)
 {
     MsgPortManager *manager = MSGPORT_MANAGER (self);
 
+    if (manager->watches) {
+        g_hash_table_unref (manager->watches);
+        manager->watches = NULL;
+    }
+
+    if (manager->watched_ports) {
+        g_hash_table_unref (manager->watched_ports);
+        manager->watched_ports = NULL;
+    }
+
+    if (manager->context) {
+        g_main_context_unref (manager->context);
+        manager->context = NULL;
+    }
+
     if (manager->local_services) {
         g_hash_table_unref (manager->local_services);
         manager->local_services = NULL;
@@ -69,6 +144,16 @@ _finalize (GObject *self)
         manager->remote_services = NULL;
     }
 
+    if (manager->remote_ports) {
+        g_hash_table_unref (manager->remote_ports);
+        manager->remote_ports = NULL;
+    }
+
+    if (manager->schemas) {
+        g_hash_table_unref (manager->schemas);
+        manager->schemas = NULL;
+    }
+
     G_OBJECT_CLASS (msgport_manager_parent_class)->finalize (self);
 }
 
@@ -79,11 +164,27 @@ _dispose (GObject *self)
 
     g_hash_table_foreach (manager->local_services, (GHFunc)_unregister_service_cb, manager);
 
+    if (manager->incoming_channels) {
+        g_hash_table_unref (manager->incoming_channels);
+        manager->incoming_channels = NULL;
+    }
+
+    if (manager->channels) {
+        g_hash_table_unref (manager->channels);
+        manager->channels = NULL;
+    }
+
     if (manager->services) {
         g_hash_table_unref (manager->services);
         manager->services = NULL;
     }
 
+    if (manager->fd_message_filter_id) {
+        g_dbus_connection_remove_filter (g_dbus_proxy_get_connection (G_DBUS_PROXY (manager->proxy)),
+                manager->fd_message_filter_id);
+        manager->fd_message_filter_id = 0;
+    }
+
     g_clear_object (&manager->proxy);
 
     G_OBJECT_CLASS (msgport_manager_parent_class)->dispose (self);
@@ -98,16 +199,582 @@ msgport_manager_class_init (MsgPortManagerClass *klass)
     g_klass->dispose = _dispose;
 }
 
+static gboolean
+_remote_service_has_id (gpointer key, gpointer value, gpointer data)
+{
+    return GPOINTER_TO_UINT (value) == GPOINTER_TO_UINT (data);
+}
+
+static void
+_invalidate_remote_port (gpointer key, gpointer value, gpointer data)
+{
+    MsgPortRemotePort *remote_port = (MsgPortRemotePort *)key;
+
+    if (remote_port->service_id == GPOINTER_TO_UINT (data)) remote_port->service_id = 0;
+}
+
+static void
+_on_remote_service_unregistered (MsgPortManager *manager, guint service_id, gpointer userdata)
+{
+    guint n_removed = g_hash_table_foreach_remove (manager->remote_services,
+            _remote_service_has_id, GUINT_TO_POINTER (service_id));
+
+    DBG ("Remote service %d unregistered, dropped %d cached entries", service_id, n_removed);
+
+    g_hash_table_foreach (manager->remote_ports, _invalidate_remote_port, GUINT_TO_POINTER (service_id));
+}
+
+static gchar *
+_remote_service_key (const gchar *app_id, const gchar *port, gboolean is_trusted)
+{
+    return g_strdup_printf ("%s\x1f%s\x1f%d", app_id, port, is_trusted ? 1 : 0);
+}
+
+static void
+_notify_watch (MsgPortManager *manager, guint watch_id)
+{
+    /* watch might have been removed by an earlier callback */
+    MsgPortWatch *watch = g_hash_table_lookup (manager->watches, GUINT_TO_POINTER (watch_id));
+
+    if (!watch) return;
+
+    watch->cb (watch->port->app_id, watch->port->port_name, (bool)watch->port->is_trusted,
+               watch->port->service_id != 0, watch->userdata);
+}
+
+/*
+ * A ring opened to a remote service got revoked, say on the port going away.
+ */
+static void
+_on_channel_revoked (MsgPortManager *manager, guint channel_id, gpointer userdata)
+{
+    MsgPortChannel *channel = NULL;
+
+    if (!manager->channels) return;
+
+    channel = g_hash_table_lookup (manager->channels, GUINT_TO_POINTER (channel_id));
+    if (channel) msgport_channel_revoke (channel);
+}
+
+static void
+_on_schema_shared (MsgPortManager *manager, guint schema_id, const gchar * const *keys, gpointer userdata)
+{
+    DBG ("Got schema %u of %u keys", schema_id, g_strv_length ((gchar **)keys));
+
+    /* the daemon never reuses schema ids */
+    if (!g_hash_table_lookup (manager->schemas, GUINT_TO_POINTER (schema_id)))
+        g_hash_table_insert (manager->schemas, GUINT_TO_POINTER (schema_id), g_strdupv ((gchar **)keys));
+}
+
+static void
+_on_remote_service_changed (MsgPortManager *manager, const gchar *app_id, const gchar *port, gboolean is_trusted, guint service_id, gpointer userdata)
+{
+    gchar *key = _remote_service_key (app_id, port, is_trusted);
+    MsgPortWatchedPort *watched_port = g_hash_table_lookup (manager->watched_ports, key);
+    GArray *watch_ids = NULL;
+    GHashTableIter iter;
+    MsgPortWatch *watch = NULL;
+    gboolean was_available;
+    guint i;
+
+    if (service_id)
+        g_hash_table_replace (manager->remote_services, key, GUINT_TO_POINTER (service_id));
+    else {
+        g_hash_table_remove (manager->remote_services, key);
+        g_free (key);
+    }
+
+    if (!watched_port) return;
+
+    was_available = watched_port->service_id != 0;
+    watched_port->service_id = service_id;
+
+    DBG ("Watched port %s:%s is %s, service id %d", app_id, port, service_id ? "available" : "gone", service_id);
+
+    /* only a switch over to other connection of the same application */
+    if (was_available == (service_id != 0)) return;
+
+    /* callbacks might add or remove watches */
+    watch_ids = g_array_new (FALSE, FALSE, sizeof (guint));
+    g_hash_table_iter_init (&iter, manager->watches);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&watch)) {
+        if (watch->port == watched_port) g_array_append_val (watch_ids, watch->id);
+    }
+
+    for (i = 0; i < watch_ids->len; i++)
+        _notify_watch (manager, g_array_index (watch_ids, guint, i));
+
+    g_array_free (watch_ids, TRUE);
+}
+
+static guint
+_lookup_remote_service (MsgPortManager *manager, const gchar *app_id, const gchar *port, gboolean is_trusted)
+{
+    gchar *key = _remote_service_key (app_id, port, is_trusted);
+    guint service_id = GPOINTER_TO_UINT (g_hash_table_lookup (manager->remote_services, key));
+
+    g_free (key);
+
+    return service_id;
+}
+
+static void
+_cache_remote_service (MsgPortManager *manager, const gchar *app_id, const gchar *port, gboolean is_trusted, guint service_id)
+{
+    if (!service_id) return;
+
+    g_hash_table_replace (manager->remote_services,
+            _remote_service_key (app_id, port, is_trusted), GUINT_TO_POINTER (service_id));
+}
+
+static void
+_uncache_remote_service (MsgPortManager *manager, const gchar *app_id, const gchar *port, gboolean is_trusted)
+{
+    gchar *key = _remote_service_key (app_id, port, is_trusted);
+
+    g_hash_table_remove (manager->remote_services, key);
+    g_free (key);
+}
+
+typedef struct {
+    MsgPortManager *manager;
+    gchar          *object_path;
+    GVariant       *data;
+    gint           *fds;
+    guint           n_fds;
+    gchar          *app_id;
+    gchar          *port_name;
+    gboolean        is_trusted;
+} MsgPortFdMessage;
+
+static void
+_fd_message_free (gpointer userdata)
+{
+    MsgPortFdMessage *message = (MsgPortFdMessage *)userdata;
+    guint i;
+
+    /* received descriptors are owned by the library */
+    for (i = 0; i < message->n_fds; i++) close (message->fds[i]);
+    g_free (message->fds);
+
+    g_object_unref (message->manager);
+    g_free (message->object_path);
+    g_variant_unref (message->data);
+    g_free (message->app_id);
+    g_free (message->port_name);
+    g_slice_free (MsgPortFdMessage, message);
+}
+
+static gboolean
+_deliver_fd_message (gpointer userdata)
+{
+    MsgPortFdMessage *message = (MsgPortFdMessage *)userdata;
+    MsgPortService *service = NULL;
+
+    /* manager is being disposed */
+    if (!message->manager->services) return FALSE;
+
+    service = g_hash_table_lookup (message->manager->services, message->object_path);
+    if (!service) {
+        WARN ("No local service found at '%s' for message", message->object_path);
+        return FALSE;
+    }
+
+    msgport_service_handle_message_with_fds (service, message->data, message->fds, message->n_fds,
+            message->app_id, message->port_name, message->is_trusted);
+
+    return FALSE;
+}
+
+static GVariant *
+_parse_large_message (GVariant *body, GUnixFDList *fd_list, const gchar **app_id, const gchar **port_name, gboolean *is_trusted)
+{
+    GVariant *data = NULL;
+    gint32 handle = 0;
+    guint64 size = 0;
+    gint fd;
+
+    if (!g_variant_is_of_type (body, G_VARIANT_TYPE ("(htssb)"))) return NULL;
+
+    g_variant_get (body, "(ht&s&sb)", &handle, &size, app_id, port_name, is_trusted);
+
+    fd = g_unix_fd_list_get (fd_list, handle, NULL);
+    if (fd < 0) return NULL;
+    data = msgport_variant_from_memfd (fd, (gsize)size, G_VARIANT_TYPE_VARDICT);
+    close (fd);
+
+    return data;
+}
+
+static GVariant *
+_parse_message_with_fds (GVariant *body, GUnixFDList *fd_list, gint **fds_out, guint *n_fds_out, const gchar **app_id, const gchar **port_name, gboolean *is_trusted)
+{
+    GVariant *data = NULL;
+    GVariant *handles = NULL;
+    gint *fds = NULL;
+    gsize i, n_fds;
+
+    if (!g_variant_is_of_type (body, G_VARIANT_TYPE ("(a{sv}ahssb)"))) return NULL;
+
+    g_variant_get (body, "(@a{sv}@ah&s&sb)", &data, &handles, app_id, port_name, is_trusted);
+
+    n_fds = g_variant_n_children (handles);
+    fds = g_new0 (gint, n_fds + 1);
+    for (i = 0; i < n_fds; i++) {
+        gint32 handle = 0;
+
+        g_variant_get_child (handles, i, "h", &handle);
+        fds[i] = g_unix_fd_list_get (fd_list, handle, NULL);
+        if (fds[i] < 0) {
+            WARN ("Invalid file descriptor handle %d in message", handle);
+            while (i-- > 0) close (fds[i]);
+            g_free (fds);
+            g_variant_unref (handles);
+            g_variant_unref (data);
+            return NULL;
+        }
+    }
+    g_variant_unref (handles);
+
+    *fds_out = fds;
+    *n_fds_out = (guint)n_fds;
+
+    return data;
+}
+
+typedef struct {
+    MsgPortManager *manager; /* owns a reference till handed over to the manager */
+    gchar          *object_path;
+    MsgPortChannel *channel;
+    gchar          *app_id;
+    gchar          *port_name;
+    gboolean        is_trusted;
+    gboolean        is_stream;
+    gboolean        attached;
+} MsgPortIncomingChannel;
+
+static void
+_incoming_channel_free (gpointer userdata)
+{
+    MsgPortIncomingChannel *incoming = (MsgPortIncomingChannel *)userdata;
+
+    if (!incoming->attached) {
+        msgport_channel_free (incoming->channel);
+        g_object_unref (incoming->manager);
+    }
+    g_free (incoming->object_path);
+    g_free (incoming->app_id);
+    g_free (incoming->port_name);
+    g_slice_free (MsgPortIncomingChannel, incoming);
+}
+
+static void
+_incoming_channel_release (gpointer userdata)
+{
+    MsgPortIncomingChannel *incoming = (MsgPortIncomingChannel *)userdata;
+
+    /* once attached it goes along with the channel, only the manager reference is dropped */
+    if (incoming->attached) g_object_unref (incoming->manager);
+    else _incoming_channel_free (incoming);
+}
+
+static void
+_incoming_channel_drop (gpointer userdata)
+{
+    MsgPortIncomingChannel *incoming = (MsgPortIncomingChannel *)userdata;
+
+    /* frees the incoming channel too */
+    msgport_channel_free (incoming->channel);
+}
+
+static gboolean
+_incoming_channel_has_path (gpointer key, gpointer value, gpointer userdata)
+{
+    return g_strcmp0 (((MsgPortIncomingChannel *)value)->object_path, (const gchar *)userdata) == 0;
+}
+
+static void
+_on_stream_chunk (MsgPortIncomingChannel *incoming, MsgPortService *service, GVariant *chunk)
+{
+    guint stream_id = msgport_channel_id (incoming->channel);
+    gsize size = chunk ? g_variant_get_size (chunk) : 0;
+    gboolean accepted = FALSE;
+
+    /* an empty chunk completes the stream, a revoked channel aborts it */
+    if (service)
+        accepted = msgport_service_handle_stream_chunk (service, stream_id,
+                size ? g_variant_get_data (chunk) : NULL, size,
+                chunk ? MESSAGEPORT_ERROR_NONE : MESSAGEPORT_ERROR_IO_ERROR,
+                incoming->app_id, incoming->port_name, incoming->is_trusted);
+
+    /* closing our end tells the sender the stream got refused */
+    if (!accepted || !size)
+        g_hash_table_remove (incoming->manager->incoming_channels, GUINT_TO_POINTER (stream_id));
+}
+
+static void
+_on_channel_message (MsgPortChannel *channel, GVariant *data, gpointer userdata)
+{
+    MsgPortIncomingChannel *incoming = (MsgPortIncomingChannel *)userdata;
+    MsgPortService *service = NULL;
+
+    if (incoming->is_stream) {
+        _on_stream_chunk (incoming, g_hash_table_lookup (incoming->manager->services, incoming->object_path), data);
+        return;
+    }
+
+    if (!data) {
+        /* frees the incoming channel */
+        g_hash_table_remove (incoming->manager->incoming_channels, GUINT_TO_POINTER (msgport_channel_id (channel)));
+        return;
+    }
+
+    service = g_hash_table_lookup (incoming->manager->services, incoming->object_path);
+    if (!service) {
+        WARN ("No local service found at '%s' for channel %u", incoming->object_path, msgport_channel_id (channel));
+        g_hash_table_remove (incoming->manager->incoming_channels, GUINT_TO_POINTER (msgport_channel_id (channel)));
+        return;
+    }
+
+    msgport_service_handle_message_with_fds (service, data, NULL, 0,
+            incoming->app_id, incoming->port_name, incoming->is_trusted);
+}
+
+static gboolean
+_attach_incoming_channel (gpointer userdata)
+{
+    MsgPortIncomingChannel *incoming = (MsgPortIncomingChannel *)userdata;
+    MsgPortManager *manager = incoming->manager;
+
+    /* manager is being disposed */
+    if (!manager->incoming_channels) return FALSE;
+
+    if (!g_hash_table_contains (manager->services, incoming->object_path)) {
+        WARN ("No local service found at '%s' for channel", incoming->object_path);
+        return FALSE;
+    }
+
+    DBG ("Channel %u opened to '%s' by '%s'", msgport_channel_id (incoming->channel),
+            incoming->object_path, incoming->app_id);
+
+    incoming->attached = TRUE;
+    g_hash_table_insert (manager->incoming_channels,
+            GUINT_TO_POINTER (msgport_channel_id (incoming->channel)), incoming);
+    msgport_channel_attach (incoming->channel, manager->context,
+            _on_channel_message, incoming, _incoming_channel_free);
+
+    return FALSE;
+}
+
+static MsgPortChannel *
+_parse_channel_opened (GVariant *body, GUnixFDList *fd_list, const gchar **app_id, const gchar **port_name, gboolean *is_trusted)
+{
+    guint channel_id = 0;
+    gint32 ring_handle = 0, doorbell_handle = 0;
+    gint ring_fd, doorbell_fd;
+
+    if (!g_variant_is_of_type (body, G_VARIANT_TYPE ("(uhhssb)"))) return NULL;
+
+    g_variant_get (body, "(uhh&s&sb)", &channel_id, &ring_handle, &doorbell_handle, app_id, port_name, is_trusted);
+
+    ring_fd = g_unix_fd_list_get (fd_list, ring_handle, NULL);
+    doorbell_fd = g_unix_fd_list_get (fd_list, doorbell_handle, NULL);
+    if (ring_fd < 0 || doorbell_fd < 0) {
+        if (ring_fd >= 0) close (ring_fd);
+        if (doorbell_fd >= 0) close (doorbell_fd);
+        return NULL;
+    }
+
+    return msgport_channel_new (NULL, channel_id, ring_fd, doorbell_fd);
+}
+
+static MsgPortChannel *
+_parse_peer_connected (GVariant *body, GUnixFDList *fd_list, gboolean is_stream, const gchar **app_id, const gchar **port_name, gboolean *is_trusted)
+{
+    guint channel_id = 0;
+    gint32 socket_handle = 0;
+    gint socket_fd;
+
+    if (!g_variant_is_of_type (body, G_VARIANT_TYPE ("(uhssb)"))) return NULL;
+
+    g_variant_get (body, "(uh&s&sb)", &channel_id, &socket_handle, app_id, port_name, is_trusted);
+
+    socket_fd = g_unix_fd_list_get (fd_list, socket_handle, NULL);
+    if (socket_fd < 0) return NULL;
+
+    return is_stream ? msgport_channel_new_stream (NULL, channel_id, socket_fd)
+                     : msgport_channel_new_socket (NULL, channel_id, socket_fd);
+}
+
+/*
+ * Service proxies can not see the file descriptors attached to onLargeMessage,
+ * onMessageWithFds, onChannelOpened, onPeerConnected and onStreamOpened signals, so such signals are picked here,
+ * on the dbus worker thread, and handed over to the manager's context.
+ */
+static GDBusMessage *
+_fd_message_filter (GDBusConnection *connection, GDBusMessage *msg, gboolean incoming, gpointer userdata)
+{
+    GWeakRef *manager_ref = (GWeakRef *)userdata;
+    MsgPortManager *manager = NULL;
+    MsgPortFdMessage *message = NULL;
+    GUnixFDList *fd_list = NULL;
+    GVariant *body = NULL;
+    GVariant *data = NULL;
+    gint *fds = NULL;
+    guint i, n_fds = 0;
+    const gchar *member = NULL;
+    const gchar *app_id = NULL, *port_name = NULL;
+    gboolean is_trusted = FALSE;
+    gboolean is_stream = FALSE;
+
+    if (!incoming ||
+        g_dbus_message_get_message_type (msg) != G_DBUS_MESSAGE_TYPE_SIGNAL ||
+        g_strcmp0 (g_dbus_message_get_interface (msg), "org.tizen.messageport.Service") != 0)
+        return msg;
+
+    member = g_dbus_message_get_member (msg);
+    if (g_strcmp0 (member, "onLargeMessage") != 0 &&
+        g_strcmp0 (member, "onMessageWithFds") != 0 &&
+        g_strcmp0 (member, "onChannelOpened") != 0 &&
+        g_strcmp0 (member, "onPeerConnected") != 0 &&
+        g_strcmp0 (member, "onStreamOpened") != 0)
+        return msg;
+
+    body = g_dbus_message_get_body (msg);
+    fd_list = g_dbus_message_get_unix_fd_list (msg);
+    if (!body || !fd_list) goto out;
+
+    is_stream = g_strcmp0 (member, "onStreamOpened") == 0;
+    if (g_strcmp0 (member, "onChannelOpened") == 0 || g_strcmp0 (member, "onPeerConnected") == 0 || is_stream) {
+        MsgPortIncomingChannel *incoming = NULL;
+        MsgPortChannel *channel = g_strcmp0 (member, "onChannelOpened") == 0
+            ? _parse_channel_opened (body, fd_list, &app_id, &port_name, &is_trusted)
+            : _parse_peer_connected (body, fd_list, is_stream, &app_id, &port_name, &is_trusted);
+
+        if (!channel) goto out;
+
+        manager = g_weak_ref_get (manager_ref);
+        if (!manager) {
+            msgport_channel_free (channel);
+            goto out;
+        }
+
+        incoming = g_slice_new0 (MsgPortIncomingChannel);
+        incoming->manager = manager;
+        incoming->object_path = g_strdup (g_dbus_message_get_path (msg));
+        incoming->channel = channel;
+        incoming->app_id = g_strdup (app_id[0] ? app_id : NULL);
+        incoming->port_name = g_strdup (port_name[0] ? port_name : NULL);
+        incoming->is_trusted = is_trusted;
+        incoming->is_stream = is_stream;
+
+        g_main_context_invoke_full (manager->context, G_PRIORITY_DEFAULT,
+                _attach_incoming_channel, incoming, _incoming_channel_release);
+        goto out;
+    }
+
+    if (g_strcmp0 (member, "onLargeMessage") == 0)
+        data = _parse_large_message (body, fd_list, &app_id, &port_name, &is_trusted);
+    else
+        data = _parse_message_with_fds (body, fd_list, &fds, &n_fds, &app_id, &port_name, &is_trusted);
+    if (!data) goto out;
+
+    manager = g_weak_ref_get (manager_ref);
+    if (!manager) {
+        for (i = 0; i < n_fds; i++) close (fds[i]);
+        g_free (fds);
+        g_variant_unref (data);
+        goto out;
+    }
+
+    message = g_slice_new0 (MsgPortFdMessage);
+    message->manager = manager;
+    message->object_path = g_strdup (g_dbus_message_get_path (msg));
+    message->data = data;
+    message->fds = fds;
+    message->n_fds = n_fds;
+    message->app_id = g_strdup (app_id[0] ? app_id : NULL);
+    message->port_name = g_strdup (port_name[0] ? port_name : NULL);
+    message->is_trusted = is_trusted;
+
+    g_main_context_invoke_full (manager->context, G_PRIORITY_DEFAULT,
+            _deliver_fd_message, message, _fd_message_free);
+
+out:
+    /* consumed, nobody else can make use of it */
+    g_object_unref (msg);
+    return NULL;
+}
+
+static void
+_weak_ref_free (gpointer userdata)
+{
+    g_weak_ref_clear ((GWeakRef *)userdata);
+    g_slice_free (GWeakRef, userdata);
+}
+
+static gsize
+_large_message_threshold ()
+{
+    static gsize threshold = 0;
+
+    if (g_once_init_enter (&threshold)) {
+        gsize value = MESSAGEPORT_LARGE_MESSAGE_THRESHOLD;
+        const gchar *env = g_getenv ("MESSAGEPORT_LARGE_MESSAGE_THRESHOLD");
+
+        if (env && strtoul (env, NULL, 10) > 0) value = strtoul (env, NULL, 10);
+
+        g_once_init_leave (&threshold, value);
+    }
+
+    return threshold;
+}
+
+static void
+_negotiate_features (MsgPortManager *manager)
+{
+    GError *error = NULL;
+    gchar **features = msgport_features_to_strv (MSGPORT_FEATURES_SUPPORTED);
+    gchar **accepted = NULL;
+
+    /* older daemons do not know the method, they get none of the features */
+    msgport_dbus_glue_manager_call_negotiate_features_sync (manager->proxy,
+            (const gchar * const *)features, &accepted, NULL, &error);
+    if (error) {
+        DBG ("Failed to negotiate features : %s", error->message);
+        g_error_free (error);
+    }
+    else {
+        manager->features = msgport_features_from_strv ((const gchar * const *)accepted) & MSGPORT_FEATURES_SUPPORTED;
+        g_strfreev (accepted);
+    }
+
+    g_strfreev (features);
+}
+
 static void
 msgport_manager_init (MsgPortManager *manager)
 {
     GError          *error = NULL;
     GDBusConnection *connection = NULL;
     gchar           *bus_address = NULL;
+    GWeakRef        *manager_ref = NULL;
 
     manager->services = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
     manager->local_services = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, NULL);
-    manager->remote_services = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, NULL);
+    manager->remote_services = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    manager->remote_ports = g_hash_table_new (g_direct_hash, g_direct_equal);
+    manager->watches = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify)_watch_free);
+    manager->watched_ports = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify)_watched_port_free);
+    manager->context = g_main_context_ref_thread_default ();
+    manager->incoming_channels = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+            NULL, _incoming_channel_drop);
+    /* the channels are owned by the caller, closing them drops them from here */
+    manager->channels = g_hash_table_new (g_direct_hash, g_direct_equal);
+    manager->schemas = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+            NULL, (GDestroyNotify)g_strfreev);
 
 #ifdef USE_SESSION_BUS
     MsgPortDbusGlueServer *server = NULL;
@@ -155,6 +822,25 @@ msgport_manager_init (MsgPortManager *manager)
             WARN ("Fail to get manager proxy : %s", error->message);
             g_error_free (error);
         }
+        else {
+            g_signal_connect_swapped (manager->proxy, "remote-service-unregistered",
+                    G_CALLBACK (_on_remote_service_unregistered), manager);
+            g_signal_connect_swapped (manager->proxy, "remote-service-changed",
+                    G_CALLBACK (_on_remote_service_changed), manager);
+            g_signal_connect_swapped (manager->proxy, "schema-shared",
+                    G_CALLBACK (_on_schema_shared), manager);
+            g_signal_connect_swapped (manager->proxy, "channel-revoked",
+                    G_CALLBACK (_on_channel_revoked), manager);
+
+            /* filter runs on the dbus worker thread, might outlive the manager */
+            manager_ref = g_slice_new0 (GWeakRef);
+            g_weak_ref_init (manager_ref, manager);
+            manager->fd_message_filter_id = g_dbus_connection_add_filter (connection,
+                    _fd_message_filter, manager_ref, _weak_ref_free);
+
+            _negotiate_features (manager);
+        }
+        g_object_unref (connection);
     }
 
     g_free (bus_address);
@@ -165,13 +851,28 @@ MsgPortManager * msgport_manager_new ()
     return g_object_new (MSGPORT_TYPE_MANAGER, NULL);
 }
 
+/*
+ * The message data for b, as the encoded bundle if the daemon accepts it.
+ */
+GVariant *
+msgport_manager_bundle_to_message (MsgPortManager *manager, bundle *b)
+{
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), NULL);
+    g_return_val_if_fail (b, NULL);
+
+    if (manager->features & MSGPORT_FEATURE_ENCODED_BUNDLE)
+        return bundle_to_encoded_variant_map (b);
+
+    return bundle_to_variant_map (b);
+}
+
 static messageport_error_e
-_create_and_cache_service (MsgPortManager *manager, gchar *object_path, messageport_message_cb_full cb, int *service_id, void *userdata)
+_create_and_cache_service (MsgPortManager *manager, gchar *object_path, messageport_message_cb_full cb, messageport_message_with_fds_cb fds_cb, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, int *service_id, void *userdata)
 {
     int id;
-    MsgPortService *service = msgport_service_new (
+    MsgPortService *service = msgport_service_new (manager,
             g_dbus_proxy_get_connection (G_DBUS_PROXY(manager->proxy)),
-            object_path, cb, userdata);
+            object_path, cb, fds_cb, view_cb, typed_cb, userdata);
     if (!service) {
         g_free (object_path);
         return MESSAGEPORT_ERROR_OUT_OF_MEMORY;
@@ -201,31 +902,39 @@ _find_service (gpointer key, gpointer value, gpointer data)
     return g_strcmp0 (msgport_service_name (service), service_data->name) == 0
            && msgport_service_is_trusted (service) == service_data->is_trusted;
 }
+
+static MsgPortService *
+_lookup_local_service (MsgPortManager *manager, const gchar *port_name, gboolean is_trusted)
+{
+    FindServiceData service_data;
+
+    service_data.name = port_name;
+    service_data.is_trusted = is_trusted;
+
+    return g_hash_table_find (manager->services, _find_service, &service_data);
+}
     
 
 messageport_error_e
-msgport_manager_register_service (MsgPortManager *manager, const gchar *port_name, gboolean is_trusted, messageport_message_cb_full message_cb, void *userdata, int *service_id)
+msgport_manager_register_service (MsgPortManager *manager, const gchar *port_name, gboolean is_trusted, messageport_message_cb_full message_cb, messageport_message_with_fds_cb fds_cb, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, void *userdata, int *service_id)
 {
     GError *error = NULL;
     gchar *object_path = NULL;
-    FindServiceData service_data;
     MsgPortService *service = NULL;
 
     g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
     g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
-    g_return_val_if_fail (service_id && port_name && message_cb, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail (service_id && port_name && (message_cb || fds_cb || view_cb || typed_cb), MESSAGEPORT_ERROR_INVALID_PARAMETER);
 
     /* first check in cached services if found any */
-    service_data.name = port_name;
-    service_data.is_trusted = is_trusted;
-    service = g_hash_table_find (manager->services, _find_service, &service_data);
+    service = _lookup_local_service (manager, port_name, is_trusted);
 
     if (service) {
         int id = msgport_service_id (service);
         DBG ("Cached local port found for name '%s:%d' with ID : %d", port_name, is_trusted, id);
 
         /* update message handler */
-        msgport_service_set_message_handler (service, message_cb, userdata);
+        msgport_service_set_message_handler (service, message_cb, fds_cb, view_cb, typed_cb, userdata);
         *service_id = id;
 
         return MESSAGEPORT_ERROR_NONE;
@@ -241,14 +950,123 @@ msgport_manager_register_service (MsgPortManager *manager, const gchar *port_nam
         return err; 
     }
 
-    return _create_and_cache_service (manager, object_path, message_cb, service_id, userdata);
+    return _create_and_cache_service (manager, object_path, message_cb, fds_cb, view_cb, typed_cb, service_id, userdata);
 }
 
-static MsgPortService *
-_get_local_port (MsgPortManager *manager, int service_id)
-{
-    const gchar *object_path = NULL;
-    MsgPortService *service = NULL;
+typedef struct {
+    MsgPortManager *manager;
+    gchar          *port_name;
+    gboolean        is_trusted;
+    messageport_message_cb_full cb;
+    messageport_message_with_fds_cb fds_cb;
+    messageport_message_view_cb view_cb;
+    messageport_message_typed_cb typed_cb;
+    void           *userdata;
+    int             service_id;
+    messageport_error_e result;
+    messageport_register_done_cb done;
+    void           *done_data;
+} MsgPortRegisterData;
+
+static void
+_register_service_async_done (MsgPortRegisterData *register_data)
+{
+    register_data->done (register_data->service_id > 0 ? register_data->service_id : (int)register_data->result,
+            register_data->done_data);
+
+    g_object_unref (register_data->manager);
+    g_free (register_data->port_name);
+    g_slice_free (MsgPortRegisterData, register_data);
+}
+
+static gboolean
+_on_register_service_idle (gpointer userdata)
+{
+    _register_service_async_done ((MsgPortRegisterData *)userdata);
+
+    return FALSE;
+}
+
+static void
+_on_register_service_finished (GObject *source, GAsyncResult *result, gpointer userdata)
+{
+    GError *error = NULL;
+    gchar *object_path = NULL;
+    MsgPortService *service = NULL;
+    MsgPortRegisterData *register_data = (MsgPortRegisterData *)userdata;
+    MsgPortManager *manager = register_data->manager;
+
+    if (!msgport_dbus_glue_manager_call_register_service_finish (manager->proxy, &object_path, result, &error)) {
+        register_data->result = msgport_daemon_error_to_error (error);
+        WARN ("unable to register service (%s): %s", register_data->port_name, error->message);
+        g_error_free (error);
+    }
+    else if ((service = _lookup_local_service (manager, register_data->port_name, register_data->is_trusted))) {
+        /* another registration of the same port finished first, the daemon gave both the same path */
+        WARN ("Local port '%s:%d' got registered meanwhile", register_data->port_name, register_data->is_trusted);
+        register_data->result = MESSAGEPORT_ERROR_INVALID_PARAMETER;
+        g_free (object_path);
+    }
+    else {
+        register_data->result = _create_and_cache_service (manager, object_path, register_data->cb,
+                register_data->fds_cb, register_data->view_cb, register_data->typed_cb,
+                &register_data->service_id, register_data->userdata);
+    }
+
+    _register_service_async_done (register_data);
+}
+
+messageport_error_e
+msgport_manager_register_service_async (MsgPortManager *manager, const gchar *port_name, gboolean is_trusted, messageport_message_cb_full message_cb, messageport_message_with_fds_cb fds_cb, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, void *userdata, messageport_register_done_cb done, void *done_data)
+{
+    MsgPortService *service = NULL;
+    MsgPortRegisterData *register_data = NULL;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (done && port_name && (message_cb || fds_cb || view_cb || typed_cb), MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    register_data = g_slice_new0 (MsgPortRegisterData);
+    register_data->manager = g_object_ref (manager);
+    register_data->port_name = g_strdup (port_name);
+    register_data->is_trusted = is_trusted;
+    register_data->cb = message_cb;
+    register_data->fds_cb = fds_cb;
+    register_data->view_cb = view_cb;
+    register_data->typed_cb = typed_cb;
+    register_data->userdata = userdata;
+    register_data->done = done;
+    register_data->done_data = done_data;
+
+    service = _lookup_local_service (manager, port_name, is_trusted);
+    if (service) {
+        GSource *source = NULL;
+
+        /* its handlers are left alone, the caller owning the port might still be using those */
+        WARN ("Local port '%s:%d' is registered already", port_name, is_trusted);
+        register_data->result = MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+        /* done is never called before we return, as for the daemon replies */
+        source = g_idle_source_new ();
+        g_source_set_callback (source, _on_register_service_idle, register_data, NULL);
+        g_source_attach (source, g_main_context_get_thread_default ());
+        g_source_unref (source);
+
+        return MESSAGEPORT_ERROR_NONE;
+    }
+
+    /* replies are dispatched on the thread default main context of the caller */
+    msgport_dbus_glue_manager_call_register_service (manager->proxy, port_name, is_trusted,
+            NULL, _on_register_service_finished, register_data);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+static MsgPortService *
+_get_local_port (MsgPortManager *manager, int service_id)
+{
+    const gchar *object_path = NULL;
+    MsgPortService *service = NULL;
 
     object_path = g_hash_table_lookup (manager->local_services, GINT_TO_POINTER(service_id));
     if (!object_path) return NULL;
@@ -281,6 +1099,8 @@ msgport_manager_unregister_service (MsgPortManager *manager, int service_id)
 
     object_path = (const gchar *)g_hash_table_lookup (manager->local_services,
                                                       GINT_TO_POINTER(service_id));
+    /* the daemon keeps no copy of peer channel sockets, closing ours tells the senders */
+    g_hash_table_foreach_remove (manager->incoming_channels, _incoming_channel_has_path, (gpointer)object_path);
     g_hash_table_remove (manager->local_services, GINT_TO_POINTER(service_id));
     g_hash_table_remove (manager->services, object_path);
 
@@ -313,6 +1133,7 @@ msgport_manager_check_remote_service (MsgPortManager *manager, const gchar *app_
     }
     else {
         DBG ("Got service id %d for %s, %s", remote_service_id, app_id, port);
+        _cache_remote_service (manager, app_id, port, is_trusted, remote_service_id);
         if (service_id_out)  *service_id_out = remote_service_id;
     }
 
@@ -351,38 +1172,167 @@ msgport_manager_get_service_is_trusted (MsgPortManager *manager, int service_id,
     return MESSAGEPORT_ERROR_NONE;
 }
 
-messageport_error_e
-msgport_manager_send_message (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *data)
+/*
+ * Keys of schema_id, the daemon shares a schema before the first message
+ * packed with it, so that the lookup never blocks.
+ */
+static const gchar * const *
+_lookup_schema (guint schema_id, gpointer userdata)
+{
+    MsgPortManager *manager = MSGPORT_MANAGER (userdata);
+    gchar **keys = g_hash_table_lookup (manager->schemas, GUINT_TO_POINTER (schema_id));
+
+    if (!keys) WARN ("Schema %u was never shared with this client", schema_id);
+
+    return (const gchar * const *)keys;
+}
+
+/*
+ * The sealed memfd holding the serialized message, if it is large enough
+ * to pass by descriptor. Returns -1 if the message is small, the daemon
+ * does not know large messages or memfd is not available, so that the
+ * caller falls back to the inline path.
+ */
+static gint
+_large_message_fd (MsgPortManager *manager, GVariant *data)
+{
+    if (g_variant_get_size (data) < _large_message_threshold ()) return -1;
+
+    /* older daemons forward the descriptor to receivers that could not read it */
+    if (!(manager->features & MSGPORT_FEATURE_LARGE_MESSAGE)) return -1;
+
+    return msgport_variant_to_memfd (data);
+}
+
+/*
+ * Passes the serialized message in a sealed memfd, the daemon forwards
+ * only the descriptor to receivers that can unpack it. Returns FALSE if
+ * the message goes inline, see _large_message_fd().
+ */
+static gboolean
+_send_large_message (MsgPortManager *manager, MsgPortService *local_service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, guint *service_id, GVariant *data, messageport_error_e *err)
 {
-    guint service_id = 0;
     GError *error = NULL;
-    messageport_error_e err;
+    GUnixFDList *fd_list = NULL;
+    gsize size = g_variant_get_size (data);
+    gint fd;
 
-    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
-    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
-    g_return_val_if_fail (remote_app_id && remote_port, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+    fd = _large_message_fd (manager, data);
+    if (fd < 0) return FALSE;
 
-    err = msgport_manager_check_remote_service (manager, remote_app_id, remote_port, is_trusted, &service_id);
-    if (service_id == 0) return err;
+    DBG ("Sending message of size %lu to %s:%s through memfd", (gulong)size, remote_app_id, remote_port);
+
+    if (local_service) {
+        *err = msgport_service_send_large_message_to (local_service, remote_app_id, remote_port, is_trusted, fd, size, service_id);
+        return TRUE;
+    }
 
-    msgport_dbus_glue_manager_call_send_message_sync (manager->proxy, service_id, data, NULL, &error);
+    fd_list = g_unix_fd_list_new_from_array (&fd, 1); /* takes the fd */
+    msgport_dbus_glue_manager_call_send_large_message_to_sync (manager->proxy,
+            remote_app_id, remote_port, is_trusted, g_variant_new_handle (0), size,
+            fd_list, service_id, NULL, NULL, &error);
+    g_object_unref (fd_list);
 
     if (error) {
-        err = msgport_daemon_error_to_error (error);
-        WARN ("Failed to send message to (%s:%s) : %s", remote_app_id, remote_port, error->message);
+        *err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to send large message to (%s:%s) : %s", remote_app_id, remote_port, error->message);
         g_error_free (error);
-        return err;
     }
+    else *err = MESSAGEPORT_ERROR_NONE;
 
-    return MESSAGEPORT_ERROR_NONE;
+    return TRUE;
+}
+
+/*
+ * Sends the message to the remote port, by the remote service id if it is known,
+ * otherwise or if it went stale lets the daemon resolve the port while sending.
+ * On return service_id holds the remote service id, or 0 if it is not known.
+ */
+static messageport_error_e
+_send_message (MsgPortManager *manager, MsgPortService *local_service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, guint *service_id, GVariant *data)
+{
+    GError *error = NULL;
+    messageport_error_e err = MESSAGEPORT_ERROR_NONE;
+
+    /* data might be sent twice, if the service id went stale */
+    g_variant_ref_sink (data);
+
+    if (_send_large_message (manager, local_service, remote_app_id, remote_port, is_trusted, service_id, data, &err))
+        goto out;
+
+    if (*service_id) {
+        if (local_service) {
+            err = msgport_service_send_message (local_service, *service_id, data);
+        }
+        else {
+            msgport_dbus_glue_manager_call_send_message_sync (manager->proxy, *service_id, data, NULL, &error);
+            if (error) {
+                err = msgport_daemon_error_to_error (error);
+                WARN ("Failed to send message to service %d (%s:%s) : %s", *service_id, remote_app_id, remote_port, error->message);
+                g_error_free (error);
+            }
+        }
+
+        if (err != MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND) goto out;
+
+        /* remote port went away before we got the notification */
+        DBG ("Service id %d for %s:%s is stale", *service_id, remote_app_id, remote_port);
+        *service_id = 0;
+    }
+
+    /* let the daemon resolve the remote port and deliver in one round trip */
+    if (local_service) {
+        DBG ("Sending message from local service '%p' to remote port %s:%s", local_service, remote_app_id, remote_port);
+        err = msgport_service_send_message_to (local_service, remote_app_id, remote_port, is_trusted, data, service_id);
+    }
+    else {
+        msgport_dbus_glue_manager_call_send_message_to_sync (manager->proxy,
+                remote_app_id, remote_port, is_trusted, data, service_id, NULL, &error);
+        if (error) {
+            err = msgport_daemon_error_to_error (error);
+            WARN ("Failed to send message to (%s:%s) : %s", remote_app_id, remote_port, error->message);
+            g_error_free (error);
+        }
+        else err = MESSAGEPORT_ERROR_NONE;
+    }
+
+out:
+    g_variant_unref (data);
+
+    return err;
+}
+
+static messageport_error_e
+_send_message_cached (MsgPortManager *manager, MsgPortService *local_service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *data)
+{
+    messageport_error_e err;
+    guint cached_id = _lookup_remote_service (manager, remote_app_id, remote_port, is_trusted);
+    guint service_id = cached_id;
+
+    err = _send_message (manager, local_service, remote_app_id, remote_port, is_trusted, &service_id, data);
+
+    if (service_id && service_id != cached_id)
+        _cache_remote_service (manager, remote_app_id, remote_port, is_trusted, service_id);
+    else if (!service_id && cached_id)
+        _uncache_remote_service (manager, remote_app_id, remote_port, is_trusted);
+
+    return err;
+}
+
+messageport_error_e
+msgport_manager_send_message (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *data)
+{
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    return _send_message_cached (manager, NULL, remote_app_id, remote_port, is_trusted, data);
 }
 
 messageport_error_e
 msgport_manager_send_bidirectional_message (MsgPortManager *manager, int local_port_id, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *data)
 {
     MsgPortService *service = NULL;
-    guint remote_service_id = 0;
-    messageport_error_e res = 0;
 
     g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
     g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
@@ -394,12 +1344,979 @@ msgport_manager_send_bidirectional_message (MsgPortManager *manager, int local_p
         return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
     }
 
-    if ((res = msgport_manager_check_remote_service (manager, remote_app_id, remote_port, is_trusted, &remote_service_id) != MESSAGEPORT_ERROR_NONE)) {
-        WARN ("No remote %sport informatuon for %s:%s, error : %d", is_trusted ? "trusted " : "", remote_app_id, remote_port, res);
-        return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
+    return _send_message_cached (manager, service, remote_app_id, remote_port, is_trusted, data);
+}
+
+typedef struct {
+    MsgPortManager *manager;
+    MsgPortService *local_service;
+    gchar          *app_id;
+    gchar          *port_name;
+    gboolean        is_trusted;
+    guint           cached_id;
+    guint           service_id;
+    GVariant       *data;
+    messageport_send_done_cb cb;
+    void           *userdata;
+} MsgPortSendData;
+
+static void
+_send_data_free (MsgPortSendData *send_data)
+{
+    g_object_unref (send_data->manager);
+    if (send_data->local_service) g_object_unref (send_data->local_service);
+    g_free (send_data->app_id);
+    g_free (send_data->port_name);
+    g_variant_unref (send_data->data);
+
+    g_slice_free (MsgPortSendData, send_data);
+}
+
+static void
+_send_message_async_done (MsgPortSendData *send_data, messageport_error_e err)
+{
+    MsgPortManager *manager = send_data->manager;
+
+    /* the cache might have been updated meanwhile by other sends, only touch our own entry */
+    if (send_data->service_id && send_data->service_id != send_data->cached_id)
+        _cache_remote_service (manager, send_data->app_id, send_data->port_name,
+                send_data->is_trusted, send_data->service_id);
+    else if (!send_data->service_id && send_data->cached_id &&
+             _lookup_remote_service (manager, send_data->app_id, send_data->port_name,
+                     send_data->is_trusted) == send_data->cached_id)
+        _uncache_remote_service (manager, send_data->app_id, send_data->port_name, send_data->is_trusted);
+
+    if (send_data->cb) send_data->cb (err, send_data->userdata);
+
+    _send_data_free (send_data);
+}
+
+static void
+_on_send_message_to_finished (GObject *source, GAsyncResult *result, gpointer userdata)
+{
+    GError *error = NULL;
+    messageport_error_e err = MESSAGEPORT_ERROR_NONE;
+    MsgPortSendData *send_data = (MsgPortSendData *)userdata;
+
+    if (send_data->local_service) {
+        err = msgport_service_send_message_to_finish (send_data->local_service, result, &send_data->service_id);
+    }
+    else if (!msgport_dbus_glue_manager_call_send_message_to_finish (send_data->manager->proxy,
+                &send_data->service_id, result, &error)) {
+        err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to send message to (%s:%s) : %s", send_data->app_id, send_data->port_name, error->message);
+        g_error_free (error);
+    }
+
+    _send_message_async_done (send_data, err);
+}
+
+static void
+_send_message_to_async (MsgPortSendData *send_data)
+{
+    /* let the daemon resolve the remote port and deliver in one round trip */
+    if (send_data->local_service)
+        msgport_service_send_message_to_async (send_data->local_service,
+                send_data->app_id, send_data->port_name, send_data->is_trusted, send_data->data,
+                _on_send_message_to_finished, send_data);
+    else
+        msgport_dbus_glue_manager_call_send_message_to (send_data->manager->proxy,
+                send_data->app_id, send_data->port_name, send_data->is_trusted, send_data->data,
+                NULL, _on_send_message_to_finished, send_data);
+}
+
+/*
+ * Takes the fd, a NULL cb sends without expecting a reply.
+ */
+static void
+_send_large_message_to_async (MsgPortManager *manager, MsgPortService *local_service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, gint fd, gsize size, GAsyncReadyCallback cb, gpointer userdata)
+{
+    GUnixFDList *fd_list = NULL;
+
+    DBG ("Sending message of size %lu to %s:%s through memfd", (gulong)size, remote_app_id, remote_port);
+
+    if (local_service) {
+        msgport_service_send_large_message_to_async (local_service, remote_app_id, remote_port, is_trusted, fd, size, cb, userdata);
+        return;
+    }
+
+    fd_list = g_unix_fd_list_new_from_array (&fd, 1); /* takes the fd */
+    msgport_dbus_glue_manager_call_send_large_message_to (manager->proxy,
+            remote_app_id, remote_port, is_trusted, g_variant_new_handle (0), size,
+            fd_list, NULL, cb, userdata);
+    g_object_unref (fd_list);
+}
+
+static void
+_on_send_large_message_to_finished (GObject *source, GAsyncResult *result, gpointer userdata)
+{
+    GError *error = NULL;
+    messageport_error_e err = MESSAGEPORT_ERROR_NONE;
+    MsgPortSendData *send_data = (MsgPortSendData *)userdata;
+
+    if (send_data->local_service) {
+        err = msgport_service_send_large_message_to_finish (send_data->local_service, result, &send_data->service_id);
+    }
+    else if (!msgport_dbus_glue_manager_call_send_large_message_to_finish (send_data->manager->proxy,
+                &send_data->service_id, NULL, result, &error)) {
+        err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to send large message to (%s:%s) : %s", send_data->app_id, send_data->port_name, error->message);
+        g_error_free (error);
+    }
+
+    _send_message_async_done (send_data, err);
+}
+
+static void
+_on_send_message_finished (GObject *source, GAsyncResult *result, gpointer userdata)
+{
+    GError *error = NULL;
+    messageport_error_e err = MESSAGEPORT_ERROR_NONE;
+    MsgPortSendData *send_data = (MsgPortSendData *)userdata;
+
+    if (send_data->local_service) {
+        err = msgport_service_send_message_finish (send_data->local_service, result);
+    }
+    else if (!msgport_dbus_glue_manager_call_send_message_finish (send_data->manager->proxy, result, &error)) {
+        err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to send message to service %d (%s:%s) : %s", send_data->service_id,
+                send_data->app_id, send_data->port_name, error->message);
+        g_error_free (error);
+    }
+
+    if (err != MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND) {
+        _send_message_async_done (send_data, err);
+        return;
+    }
+
+    /* remote port went away before we got the notification */
+    DBG ("Service id %d for %s:%s is stale", send_data->service_id, send_data->app_id, send_data->port_name);
+    send_data->service_id = 0;
+    _send_message_to_async (send_data);
+}
+
+messageport_error_e
+msgport_manager_send_message_async (MsgPortManager *manager, int local_port_id, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *data, messageport_send_done_cb cb, void *userdata)
+{
+    MsgPortService *service = NULL;
+    MsgPortSendData *send_data = NULL;
+    gint large_fd;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && data, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    if (local_port_id > 0) {
+        service = _get_local_port (manager, local_port_id);
+        if (!service) {
+            WARN ("No local service found for service id '%d'", local_port_id);
+            return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
+        }
+    }
+
+    send_data = g_slice_new0 (MsgPortSendData);
+    send_data->manager = g_object_ref (manager);
+    send_data->local_service = service ? g_object_ref (service) : NULL;
+    send_data->app_id = g_strdup (remote_app_id);
+    send_data->port_name = g_strdup (remote_port);
+    send_data->is_trusted = is_trusted;
+    send_data->cached_id = _lookup_remote_service (manager, remote_app_id, remote_port, is_trusted);
+    send_data->service_id = send_data->cached_id;
+    /* data might be sent twice, if the service id went stale */
+    send_data->data = g_variant_ref_sink (data);
+    send_data->cb = cb;
+    send_data->userdata = userdata;
+
+    /* replies are dispatched on the thread default main context of the caller */
+    large_fd = _large_message_fd (manager, send_data->data);
+    if (large_fd >= 0)
+        _send_large_message_to_async (manager, service, remote_app_id, remote_port, is_trusted,
+                large_fd, g_variant_get_size (send_data->data), _on_send_large_message_to_finished, send_data);
+    else if (!send_data->service_id)
+        _send_message_to_async (send_data);
+    else if (service)
+        msgport_service_send_message_async (service, send_data->service_id, send_data->data,
+                _on_send_message_finished, send_data);
+    else
+        msgport_dbus_glue_manager_call_send_message (manager->proxy, send_data->service_id,
+                send_data->data, NULL, _on_send_message_finished, send_data);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_manager_send_message_noreply (MsgPortManager *manager, int local_port_id, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *data)
+{
+    MsgPortService *service = NULL;
+    guint service_id = 0;
+    gint large_fd;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && data, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    if (local_port_id > 0) {
+        service = _get_local_port (manager, local_port_id);
+        if (!service) {
+            WARN ("No local service found for service id '%d'", local_port_id);
+            return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
+        }
+    }
+
+    /*
+     * Calls without a reply callback go out with NO_REPLY_EXPECTED flag set,
+     * so the daemon neither replies nor reports errors, it only counts the failures.
+     * Stale ids are dropped by the remote-service-unregistered signal.
+     */
+    service_id = _lookup_remote_service (manager, remote_app_id, remote_port, is_trusted);
+
+    large_fd = _large_message_fd (manager, data);
+    if (large_fd >= 0) {
+        _send_large_message_to_async (manager, service, remote_app_id, remote_port, is_trusted,
+                large_fd, g_variant_get_size (data), NULL, NULL);
+        /* as the calls below would sink it */
+        g_variant_unref (g_variant_ref_sink (data));
+    }
+    else if (service_id) {
+        if (service)
+            msgport_service_send_message_async (service, service_id, data, NULL, NULL);
+        else
+            msgport_dbus_glue_manager_call_send_message (manager->proxy, service_id, data, NULL, NULL, NULL);
+    }
+    else {
+        if (service)
+            msgport_service_send_message_to_async (service, remote_app_id, remote_port, is_trusted, data, NULL, NULL);
+        else
+            msgport_dbus_glue_manager_call_send_message_to (manager->proxy,
+                    remote_app_id, remote_port, is_trusted, data, NULL, NULL, NULL);
+    }
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+/*
+ * The descriptors are duplicated into the message, the caller keeps
+ * the ownership of fds.
+ */
+messageport_error_e
+msgport_manager_send_message_with_fds (MsgPortManager *manager, int local_port_id, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *data, const gint *fds, guint n_fds)
+{
+    GError *error = NULL;
+    GUnixFDList *fd_list = NULL;
+    GVariantBuilder handles;
+    MsgPortService *service = NULL;
+    messageport_error_e err = MESSAGEPORT_ERROR_NONE;
+    guint service_id = 0;
+    guint i;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && data, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail (n_fds <= MSGPORT_MAX_FDS && (fds || !n_fds), MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    if (local_port_id > 0) {
+        service = _get_local_port (manager, local_port_id);
+        if (!service) {
+            WARN ("No local service found for service id '%d'", local_port_id);
+            return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
+        }
+    }
+
+    fd_list = g_unix_fd_list_new ();
+    g_variant_builder_init (&handles, G_VARIANT_TYPE ("ah"));
+    for (i = 0; i < n_fds; i++) {
+        gint handle = g_unix_fd_list_append (fd_list, fds[i], &error);
+        if (handle < 0) {
+            WARN ("Invalid file descriptor %d : %s", fds[i], error->message);
+            g_error_free (error);
+            g_variant_builder_clear (&handles);
+            g_object_unref (fd_list);
+            g_variant_unref (g_variant_ref_sink (data));
+            return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+        }
+        g_variant_builder_add (&handles, "h", handle);
+    }
+
+    DBG ("Sending message with %u fds to %s:%s", n_fds, remote_app_id, remote_port);
+
+    if (service) {
+        err = msgport_service_send_message_with_fds_to (service, remote_app_id, remote_port, is_trusted,
+                data, g_variant_builder_end (&handles), fd_list, &service_id);
+    }
+    else {
+        msgport_dbus_glue_manager_call_send_message_with_fds_to_sync (manager->proxy,
+                remote_app_id, remote_port, is_trusted, data, g_variant_builder_end (&handles),
+                fd_list, &service_id, NULL, NULL, &error);
+        if (error) {
+            err = msgport_daemon_error_to_error (error);
+            WARN ("Failed to send message with fds to (%s:%s) : %s", remote_app_id, remote_port, error->message);
+            g_error_free (error);
+        }
     }
+    g_object_unref (fd_list);
 
-    DBG ("Sending message from local service '%p' to remote sercie id '%d'", service, remote_service_id);
-    return msgport_service_send_message (service, remote_service_id, data);
+    if (err == MESSAGEPORT_ERROR_NONE && service_id)
+        _cache_remote_service (manager, remote_app_id, remote_port, is_trusted, service_id);
+
+    return err;
 }
 
+messageport_error_e
+msgport_manager_get_dropped_message_count (MsgPortManager *manager, guint *count_out)
+{
+    GError *error = NULL;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (count_out, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    msgport_dbus_glue_manager_call_get_dropped_message_count_sync (manager->proxy, count_out, NULL, &error);
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to get dropped message count : %s", error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_manager_send_messages (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *messages)
+{
+    GError *error = NULL;
+    guint service_id = 0;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && messages, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    msgport_dbus_glue_manager_call_send_messages_to_sync (manager->proxy,
+            remote_app_id, remote_port, is_trusted, messages, &service_id, NULL, &error);
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to send messages to (%s:%s) : %s", remote_app_id, remote_port, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    _cache_remote_service (manager, remote_app_id, remote_port, is_trusted, service_id);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_manager_send_message_multi (MsgPortManager *manager, GVariant *targets, GVariant *data, messageport_error_e *results_out, guint n_results)
+{
+    GError *error = NULL;
+    GVariant *results = NULL;
+    GVariantIter iter;
+    guint code = 0, i = 0;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (targets && data, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    msgport_dbus_glue_manager_call_send_message_multi_sync (manager->proxy,
+            targets, data, &results, NULL, &error);
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to send multicast message : %s", error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    g_variant_iter_init (&iter, results);
+    while (g_variant_iter_next (&iter, "u", &code) && i < n_results) {
+        if (results_out) results_out[i] = msgport_daemon_error_code_to_error ((gint)code);
+        i++;
+    }
+    g_variant_unref (results);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_manager_open_remote_port (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, MsgPortRemotePort **remote_port_out)
+{
+    guint service_id = 0;
+    MsgPortRemotePort *remote = NULL;
+    messageport_error_e err;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && remote_port_out, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    /* resolves the port, and for trusted ports verifies the certificates */
+    err = msgport_manager_check_remote_service (manager, remote_app_id, remote_port, is_trusted, &service_id);
+    if (err != MESSAGEPORT_ERROR_NONE) return err;
+
+    remote = g_slice_new0 (MsgPortRemotePort);
+    remote->manager = g_object_ref (manager);
+    remote->app_id = g_strdup (remote_app_id);
+    remote->port_name = g_strdup (remote_port);
+    remote->is_trusted = is_trusted;
+    remote->service_id = service_id;
+
+    g_hash_table_add (manager->remote_ports, remote);
+
+    *remote_port_out = remote;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+void
+msgport_manager_close_remote_port (MsgPortRemotePort *remote_port)
+{
+    g_return_if_fail (remote_port);
+
+    if (remote_port->manager->remote_ports)
+        g_hash_table_remove (remote_port->manager->remote_ports, remote_port);
+    g_object_unref (remote_port->manager);
+    g_free (remote_port->app_id);
+    g_free (remote_port->port_name);
+    msgport_delta_source_free (remote_port->delta);
+
+    g_slice_free (MsgPortRemotePort, remote_port);
+}
+
+void
+msgport_manager_set_remote_port_compression (MsgPortRemotePort *remote_port, gsize threshold)
+{
+    g_return_if_fail (remote_port);
+
+    remote_port->compress_threshold = threshold;
+}
+
+void
+msgport_manager_set_remote_port_delta (MsgPortRemotePort *remote_port, gboolean enable)
+{
+    g_return_if_fail (remote_port);
+
+    if (!enable) {
+        msgport_delta_source_free (remote_port->delta);
+        remote_port->delta = NULL;
+        return;
+    }
+
+    /* older daemons could not patch it for older receivers */
+    if (!(remote_port->manager->features & MSGPORT_FEATURE_DELTA_BUNDLE)) {
+        DBG ("Daemon does not support deltas, sending whole messages to %s:%s", remote_port->app_id, remote_port->port_name);
+        return;
+    }
+
+    if (!remote_port->delta) remote_port->delta = msgport_delta_source_new ();
+}
+
+/*
+ * The received data as the services deliver it, i.e, inflated and expanded
+ * from its schema, encoded bundles are kept as those. Returns NULL if data
+ * could not be unpacked.
+ */
+GVariant *
+msgport_manager_unpack_message (MsgPortManager *manager, GVariant *data)
+{
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), NULL);
+    g_return_val_if_fail (data, NULL);
+
+    return msgport_variant_map_unpack (data, MSGPORT_FEATURE_ENCODED_BUNDLE, _lookup_schema, manager);
+}
+
+messageport_error_e
+msgport_manager_set_remote_port_schema (MsgPortRemotePort *remote_port, const gchar * const *keys)
+{
+    MsgPortManager *manager = NULL;
+    GError *error = NULL;
+    guint schema_id = 0;
+
+    g_return_val_if_fail (remote_port, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    manager = remote_port->manager;
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+
+    if (!keys) {
+        remote_port->schema_id = 0;
+        remote_port->schema_keys = NULL;
+        return MESSAGEPORT_ERROR_NONE;
+    }
+
+    if (!msgport_schema_keys_are_valid (keys)) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    /* older daemons could not expand it for older receivers */
+    if (!(manager->features & MSGPORT_FEATURE_SCHEMA_BUNDLE)) {
+        DBG ("Daemon does not support schemas, sending maps to %s:%s", remote_port->app_id, remote_port->port_name);
+        return MESSAGEPORT_ERROR_NONE;
+    }
+
+    msgport_dbus_glue_manager_call_register_schema_sync (manager->proxy, keys, &schema_id, NULL, &error);
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to register schema : %s", error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    if (!g_hash_table_lookup (manager->schemas, GUINT_TO_POINTER (schema_id)))
+        g_hash_table_insert (manager->schemas, GUINT_TO_POINTER (schema_id), g_strdupv ((gchar **)keys));
+
+    remote_port->schema_id = schema_id;
+    remote_port->schema_keys = g_hash_table_lookup (manager->schemas, GUINT_TO_POINTER (schema_id));
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+/*
+ * Only the values, if the message has exactly the keys of the remote port schema.
+ * Returns a new reference.
+ */
+static GVariant *
+_remote_port_message (MsgPortRemotePort *remote_port, bundle *message)
+{
+    GVariant *map = NULL;
+    GVariant *packed = NULL;
+
+    if (!remote_port->schema_id)
+        return g_variant_ref_sink (msgport_manager_bundle_to_message (remote_port->manager, message));
+
+    map = g_variant_ref_sink (bundle_to_variant_map (message));
+    packed = msgport_variant_map_to_schema (map, remote_port->schema_id, remote_port->schema_keys);
+    if (!packed) {
+        DBG ("Message keys do not match schema %u, sending it as a map", remote_port->schema_id);
+        return map;
+    }
+    g_variant_unref (map);
+
+    return packed;
+}
+
+/*
+ * Takes the reference on data, returns a new reference to the data to send.
+ */
+static GVariant *
+_compress_message (MsgPortManager *manager, GVariant *data, gsize threshold)
+{
+    GVariant *compressed = NULL;
+
+    /* older daemons could not inflate it for older receivers */
+    if (!threshold || !(manager->features & MSGPORT_FEATURE_COMPRESSED_BUNDLE) ||
+        g_variant_get_size (data) < threshold)
+        return data;
+
+    compressed = msgport_variant_map_compress (data);
+    if (!compressed) return data;
+
+    g_variant_unref (data);
+
+    return compressed;
+}
+
+/*
+ * Takes the reference on data.
+ */
+static messageport_error_e
+_send_to_remote_port (MsgPortRemotePort *remote_port, MsgPortService *service, GVariant *data)
+{
+    messageport_error_e err;
+
+    data = _compress_message (remote_port->manager, data, remote_port->compress_threshold);
+    err = _send_message (remote_port->manager, service, remote_port->app_id, remote_port->port_name,
+            remote_port->is_trusted, &remote_port->service_id, data);
+    g_variant_unref (data);
+
+    return err;
+}
+
+/*
+ * The delta of message to the last message sent to the remote port,
+ * or a key frame. Returns a new reference.
+ */
+static GVariant *
+_remote_port_delta (MsgPortRemotePort *remote_port, bundle *message, gboolean key_frame)
+{
+    GVariant *map = g_variant_ref_sink (bundle_to_variant_map (message));
+    GVariant *delta = msgport_delta_source_encode (remote_port->delta, map, key_frame);
+
+    g_variant_unref (map);
+
+    return delta;
+}
+
+/*
+ * Falls back to a key frame if the remote port got a new receiver while
+ * sending, or the daemon does not know the base of the delta.
+ */
+static messageport_error_e
+_send_delta_to_remote_port (MsgPortRemotePort *remote_port, MsgPortService *service, bundle *message)
+{
+    guint service_id = remote_port->service_id;
+    gboolean key_frame = !service_id || service_id != remote_port->delta_service_id;
+    GVariant *data = _remote_port_delta (remote_port, message, key_frame);
+    messageport_error_e err = _send_to_remote_port (remote_port, service, data);
+
+    if (!key_frame && (err == MESSAGEPORT_ERROR_DELTA_BASE_NOT_FOUND ||
+        (err == MESSAGEPORT_ERROR_NONE && remote_port->service_id != service_id))) {
+        DBG ("Base of the delta not known by %s:%s, sending a key frame", remote_port->app_id, remote_port->port_name);
+        data = _remote_port_delta (remote_port, message, TRUE);
+        err = _send_to_remote_port (remote_port, service, data);
+    }
+    if (err == MESSAGEPORT_ERROR_DELTA_BASE_NOT_FOUND) err = MESSAGEPORT_ERROR_IO_ERROR;
+
+    if (err != MESSAGEPORT_ERROR_NONE) msgport_delta_source_reset (remote_port->delta);
+    remote_port->delta_service_id = remote_port->service_id;
+
+    return err;
+}
+
+static messageport_error_e
+_remote_port_local_service (MsgPortRemotePort *remote_port, int local_port_id, MsgPortService **service_out)
+{
+    *service_out = NULL;
+
+    if (local_port_id > 0) {
+        *service_out = _get_local_port (remote_port->manager, local_port_id);
+        if (!*service_out) {
+            WARN ("No local service found for service id '%d'", local_port_id);
+            return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
+        }
+    }
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_manager_send_message_to_remote_port (MsgPortRemotePort *remote_port, int local_port_id, bundle *message)
+{
+    MsgPortService *service = NULL;
+    messageport_error_e err;
+
+    g_return_val_if_fail (remote_port && message, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail (remote_port->manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+
+    err = _remote_port_local_service (remote_port, local_port_id, &service);
+    if (err != MESSAGEPORT_ERROR_NONE) return err;
+
+    if (remote_port->delta) return _send_delta_to_remote_port (remote_port, service, message);
+
+    return _send_to_remote_port (remote_port, service, _remote_port_message (remote_port, message));
+}
+
+/*
+ * Typed messages are sent whole, they carry no keys to pack by schema
+ * or diff against the previous message.
+ */
+messageport_error_e
+msgport_manager_send_typed_message_to_remote_port (MsgPortRemotePort *remote_port, int local_port_id, GVariant *data)
+{
+    MsgPortService *service = NULL;
+    messageport_error_e err;
+
+    g_return_val_if_fail (remote_port && data, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+    g_return_val_if_fail (remote_port->manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+
+    err = _remote_port_local_service (remote_port, local_port_id, &service);
+    if (err != MESSAGEPORT_ERROR_NONE) return err;
+
+    /* receivers keep the base of the delta, the next bundle goes whole */
+    if (remote_port->delta) msgport_delta_source_reset (remote_port->delta);
+
+    return _send_to_remote_port (remote_port, service, g_variant_ref (data));
+}
+
+messageport_error_e
+msgport_manager_open_channel (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, MsgPortChannel **channel_out)
+{
+    GError *error = NULL;
+    GUnixFDList *fd_list = NULL;
+    GVariant *ring = NULL, *doorbell = NULL;
+    MsgPortChannel *channel = NULL;
+    guint channel_id = 0;
+    gint ring_fd = -1, doorbell_fd = -1;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && channel_out, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    /* daemon resolves the port and checks the certificates, as for any message */
+    msgport_dbus_glue_manager_call_open_channel_sync (manager->proxy, remote_app_id, remote_port, is_trusted,
+            NULL, &channel_id, &ring, &doorbell, &fd_list, NULL, &error);
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to open channel to (%s:%s) : %s", remote_app_id, remote_port, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    if (fd_list) {
+        ring_fd = g_unix_fd_list_get (fd_list, g_variant_get_handle (ring), NULL);
+        doorbell_fd = g_unix_fd_list_get (fd_list, g_variant_get_handle (doorbell), NULL);
+        g_object_unref (fd_list);
+    }
+    g_variant_unref (ring);
+    g_variant_unref (doorbell);
+
+    if (ring_fd >= 0 && doorbell_fd >= 0)
+        channel = msgport_channel_new (manager, channel_id, ring_fd, doorbell_fd);
+    else {
+        if (ring_fd >= 0) close (ring_fd);
+        if (doorbell_fd >= 0) close (doorbell_fd);
+    }
+
+    if (!channel) {
+        msgport_dbus_glue_manager_call_close_channel (manager->proxy, channel_id, NULL, NULL, NULL);
+        return MESSAGEPORT_ERROR_IO_ERROR;
+    }
+
+    DBG ("Opened channel %u to %s:%s", channel_id, remote_app_id, remote_port);
+    g_hash_table_insert (manager->channels, GUINT_TO_POINTER (channel_id), channel);
+
+    *channel_out = channel;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+static messageport_error_e
+_open_socket_channel (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, gboolean is_stream, MsgPortChannel **channel_out)
+{
+    GError *error = NULL;
+    GUnixFDList *fd_list = NULL;
+    GVariant *socket = NULL;
+    MsgPortChannel *channel = NULL;
+    guint channel_id = 0;
+    gint socket_fd = -1;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && channel_out, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    if (is_stream)
+        msgport_dbus_glue_manager_call_open_stream_sync (manager->proxy, remote_app_id, remote_port, is_trusted,
+                NULL, &channel_id, &socket, &fd_list, NULL, &error);
+    else
+        msgport_dbus_glue_manager_call_open_peer_channel_sync (manager->proxy, remote_app_id, remote_port, is_trusted,
+                NULL, &channel_id, &socket, &fd_list, NULL, &error);
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Failed to open %s to (%s:%s) : %s", is_stream ? "stream" : "peer channel",
+                remote_app_id, remote_port, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    if (fd_list) {
+        socket_fd = g_unix_fd_list_get (fd_list, g_variant_get_handle (socket), NULL);
+        g_object_unref (fd_list);
+    }
+    g_variant_unref (socket);
+
+    if (socket_fd >= 0)
+        channel = is_stream ? msgport_channel_new_stream (manager, channel_id, socket_fd)
+                            : msgport_channel_new_socket (manager, channel_id, socket_fd);
+
+    if (!channel) return MESSAGEPORT_ERROR_IO_ERROR;
+
+    DBG ("Opened %s %u to %s:%s", is_stream ? "stream" : "peer channel", channel_id, remote_app_id, remote_port);
+
+    *channel_out = channel;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_manager_open_peer_channel (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, MsgPortChannel **channel_out)
+{
+    return _open_socket_channel (manager, remote_app_id, remote_port, is_trusted, FALSE, channel_out);
+}
+
+messageport_error_e
+msgport_manager_open_stream (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, MsgPortChannel **stream_out)
+{
+    return _open_socket_channel (manager, remote_app_id, remote_port, is_trusted, TRUE, stream_out);
+}
+
+messageport_error_e
+msgport_manager_close_stream (MsgPortChannel *stream)
+{
+    messageport_error_e res;
+
+    g_return_val_if_fail (stream, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    /* the end marker is queued on the receiver's socket before our end gets closed */
+    res = msgport_channel_finish (stream);
+    /* the handle stays valid, to retry once the receiver caught up */
+    if (res == MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE) return res;
+    msgport_manager_close_channel (stream);
+
+    return res;
+}
+
+messageport_error_e
+msgport_manager_set_stream_handler (MsgPortManager *manager, int service_id, messageport_stream_cb cb, void *userdata)
+{
+    MsgPortService *service = NULL;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (service_id > 0, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    service = _get_local_port (manager, service_id);
+    if (!service) return MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND;
+
+    msgport_service_set_stream_handler (service, cb, userdata);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+void
+msgport_manager_close_channel (MsgPortChannel *channel)
+{
+    MsgPortManager *manager = NULL;
+
+    g_return_if_fail (channel);
+
+    /* fire and forget, the daemon revokes the receiving end of rings, closing sockets is enough */
+    manager = msgport_channel_get_manager (channel);
+    if (manager && manager->proxy && !msgport_channel_is_socket (channel)) {
+        if (manager->channels) g_hash_table_remove (manager->channels, GUINT_TO_POINTER (msgport_channel_id (channel)));
+        msgport_dbus_glue_manager_call_close_channel (manager->proxy, msgport_channel_id (channel), NULL, NULL, NULL);
+    }
+
+    msgport_channel_free (channel);
+}
+
+/*
+ * The daemon revoked a channel to one of the local services, what is
+ * left in the ring still gets delivered.
+ */
+void
+msgport_manager_revoke_incoming_channel (MsgPortManager *manager, guint channel_id)
+{
+    MsgPortIncomingChannel *incoming = NULL;
+
+    g_return_if_fail (manager && MSGPORT_IS_MANAGER (manager));
+
+    if (!manager->incoming_channels) return;
+
+    incoming = g_hash_table_lookup (manager->incoming_channels, GUINT_TO_POINTER (channel_id));
+    if (incoming && !msgport_channel_is_socket (incoming->channel)) msgport_channel_revoke (incoming->channel);
+}
+
+typedef struct {
+    MsgPortManager *manager;
+    guint           watch_id;
+} MsgPortWatchIdleData;
+
+static gboolean
+_notify_watch_idle_cb (gpointer userdata)
+{
+    MsgPortWatchIdleData *data = (MsgPortWatchIdleData *)userdata;
+
+    _notify_watch (data->manager, data->watch_id);
+
+    return FALSE;
+}
+
+static void
+_watch_idle_data_free (gpointer userdata)
+{
+    MsgPortWatchIdleData *data = (MsgPortWatchIdleData *)userdata;
+
+    g_object_unref (data->manager);
+    g_slice_free (MsgPortWatchIdleData, data);
+}
+
+messageport_error_e
+msgport_manager_watch_remote_service (MsgPortManager *manager, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, messageport_remote_port_watch_cb cb, void *userdata, guint *watch_id_out)
+{
+    gchar *key = NULL;
+    MsgPortWatch *watch = NULL;
+    MsgPortWatchedPort *watched_port = NULL;
+    MsgPortWatchIdleData *idle_data = NULL;
+    GSource *source = NULL;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && cb && watch_id_out, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    key = _remote_service_key (remote_app_id, remote_port, is_trusted);
+    watched_port = g_hash_table_lookup (manager->watched_ports, key);
+
+    if (!watched_port) {
+        GError *error = NULL;
+        guint service_id = 0;
+
+        /* first watch on this port, from now on the daemon signals the changes */
+        msgport_dbus_glue_manager_call_watch_remote_service_sync (manager->proxy,
+                remote_app_id, remote_port, is_trusted, &service_id, NULL, &error);
+        if (error) {
+            messageport_error_e err = msgport_daemon_error_to_error (error);
+            WARN ("Failed to watch remote port %s:%s : %s", remote_app_id, remote_port, error->message);
+            g_error_free (error);
+            g_free (key);
+            return err;
+        }
+
+        watched_port = g_slice_new0 (MsgPortWatchedPort);
+        watched_port->app_id = g_strdup (remote_app_id);
+        watched_port->port_name = g_strdup (remote_port);
+        watched_port->is_trusted = is_trusted;
+        watched_port->service_id = service_id;
+
+        _cache_remote_service (manager, remote_app_id, remote_port, is_trusted, service_id);
+        g_hash_table_insert (manager->watched_ports, key, watched_port);
+    }
+    else g_free (key);
+
+    watched_port->n_watches++;
+
+    watch = g_slice_new0 (MsgPortWatch);
+    watch->id = ++manager->last_watch_id;
+    watch->port = watched_port;
+    watch->cb = cb;
+    watch->userdata = userdata;
+    g_hash_table_insert (manager->watches, GUINT_TO_POINTER (watch->id), watch);
+
+    /* report the current state from the main loop, not from within this call */
+    idle_data = g_slice_new0 (MsgPortWatchIdleData);
+    idle_data->manager = g_object_ref (manager);
+    idle_data->watch_id = watch->id;
+
+    source = g_idle_source_new ();
+    g_source_set_callback (source, _notify_watch_idle_cb, idle_data, _watch_idle_data_free);
+    g_source_attach (source, manager->context);
+    g_source_unref (source);
+
+    *watch_id_out = watch->id;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_manager_unwatch_remote_service (MsgPortManager *manager, guint watch_id)
+{
+    MsgPortWatch *watch = NULL;
+    MsgPortWatchedPort *watched_port = NULL;
+
+    g_return_val_if_fail (manager && MSGPORT_IS_MANAGER (manager), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (manager->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+
+    watch = g_hash_table_lookup (manager->watches, GUINT_TO_POINTER (watch_id));
+    if (!watch) {
+        WARN ("No remote port watch found for id '%d'", watch_id);
+        return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+    }
+
+    watched_port = watch->port;
+    g_hash_table_remove (manager->watches, GUINT_TO_POINTER (watch_id));
+
+    if (--watched_port->n_watches == 0) {
+        gchar *key = _remote_service_key (watched_port->app_id, watched_port->port_name, watched_port->is_trusted);
+
+        /* no reply needed, stale signals are ignored as the port is not watched anymore */
+        msgport_dbus_glue_manager_call_unwatch_remote_service (manager->proxy,
+                watched_port->app_id, watched_port->port_name, watched_port->is_trusted, NULL, NULL, NULL);
+
+        g_hash_table_remove (manager->watched_ports, key);
+        g_free (key);
+    }
+
+    return MESSAGEPORT_ERROR_NONE;
+}
@@ -39,9 +39,14 @@
 typedef struct _MsgPortManager MsgPortManager;
 typedef struct _MsgPortManagerClass MsgPortManagerClass;
 typedef struct _MsgPortService MsgPortService;
+typedef struct _messageport_remote_port_s MsgPortRemotePort;
+typedef struct _messageport_channel_s MsgPortChannel;
 
 G_BEGIN_DECLS
 
+/* kernel limit of descriptors in one message, SCM_MAX_FD */
+#define MSGPORT_MAX_FDS 253
+
 struct _MsgPortManagerClass
 {
     GObjectClass parent_class;
@@ -52,8 +57,14 @@ GType msgport_manager_get_type (void);
 MsgPortManager *
 msgport_manager_new ();
 
+GVariant *
+msgport_manager_bundle_to_message (MsgPortManager *manager, bundle *b);
+
+messageport_error_e
+msgport_manager_register_service (MsgPortManager *manager, const gchar *port_name, gboolean is_trusted, messageport_message_cb_full cb, messageport_message_with_fds_cb fds_cb, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, void *userdata, int *service_id_out);
+
 messageport_error_e
-msgport_manager_register_service (MsgPortManager *manager, const gchar *port_name, gboolean is_trusted, messageport_message_cb_full cb, void *userdata, int *service_id_out);
+msgport_manager_register_service_async (MsgPortManager *manager, const gchar *port_name, gboolean is_trusted, messageport_message_cb_full cb, messageport_message_with_fds_cb fds_cb, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, void *userdata, messageport_register_done_cb done, void *done_data);
 
 messageport_error_e
 msgport_manager_check_remote_service (MsgPortManager *manager, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, guint *service_id_out);
@@ -73,6 +84,75 @@ msgport_manager_send_message (MsgPortManager *manager, const gchar *remote_app_i
 messageport_error_e
 msgport_manager_send_bidirectional_message (MsgPortManager *manager, int from_id, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, GVariant *data);
 
+messageport_error_e
+msgport_manager_send_message_async (MsgPortManager *manager, int from_id, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, GVariant *data, messageport_send_done_cb cb, void *userdata);
+
+messageport_error_e
+msgport_manager_send_message_noreply (MsgPortManager *manager, int from_id, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, GVariant *data);
+
+messageport_error_e
+msgport_manager_send_message_with_fds (MsgPortManager *manager, int from_id, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, GVariant *data, const gint *fds, guint n_fds);
+
+messageport_error_e
+msgport_manager_get_dropped_message_count (MsgPortManager *manager, guint *count_out);
+
+messageport_error_e
+msgport_manager_send_messages (MsgPortManager *manager, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, GVariant *messages);
+
+messageport_error_e
+msgport_manager_send_message_multi (MsgPortManager *manager, GVariant *targets, GVariant *data, messageport_error_e *results_out, guint n_results);
+
+messageport_error_e
+msgport_manager_open_remote_port (MsgPortManager *manager, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, MsgPortRemotePort **remote_port_out);
+
+void
+msgport_manager_close_remote_port (MsgPortRemotePort *remote_port);
+
+messageport_error_e
+msgport_manager_send_message_to_remote_port (MsgPortRemotePort *remote_port, int from_id, bundle *message);
+
+messageport_error_e
+msgport_manager_send_typed_message_to_remote_port (MsgPortRemotePort *remote_port, int from_id, GVariant *data);
+
+void
+msgport_manager_set_remote_port_compression (MsgPortRemotePort *remote_port, gsize threshold);
+
+messageport_error_e
+msgport_manager_set_remote_port_schema (MsgPortRemotePort *remote_port, const gchar * const *keys);
+
+void
+msgport_manager_set_remote_port_delta (MsgPortRemotePort *remote_port, gboolean enable);
+
+GVariant *
+msgport_manager_unpack_message (MsgPortManager *manager, GVariant *data);
+
+messageport_error_e
+msgport_manager_open_channel (MsgPortManager *manager, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, MsgPortChannel **channel_out);
+
+messageport_error_e
+msgport_manager_open_peer_channel (MsgPortManager *manager, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, MsgPortChannel **channel_out);
+
+void
+msgport_manager_close_channel (MsgPortChannel *channel);
+
+void
+msgport_manager_revoke_incoming_channel (MsgPortManager *manager, guint channel_id);
+
+messageport_error_e
+msgport_manager_open_stream (MsgPortManager *manager, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, MsgPortChannel **stream_out);
+
+messageport_error_e
+msgport_manager_close_stream (MsgPortChannel *stream);
+
+messageport_error_e
+msgport_manager_set_stream_handler (MsgPortManager *manager, int service_id, messageport_stream_cb cb, void *userdata);
+
+messageport_error_e
+msgport_manager_watch_remote_service (MsgPortManager *manager, const gchar *remote_app_id, const gchar *port_name, gboolean is_trusted, messageport_remote_port_watch_cb cb, void *userdata, guint *watch_id_out);
+
+messageport_error_e
+msgport_manager_unwatch_remote_service (MsgPortManager *manager, guint watch_id);
+
 G_END_DECLS
 
 #endif /* __MSGPORT_MANAGER_PROXY_H */
@@ -0,0 +1,176 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "msgport-message-view.h"
+#include "common/bundle-variant.h"
+#include "common/log.h"
+
+void
+msgport_message_view_init (MsgPortMessageView *view, GVariant *data)
+{
+    view->data = data;
+    view->decoded = NULL;
+    view->values = NULL;
+    view->arrays = NULL;
+}
+
+void
+msgport_message_view_clear (MsgPortMessageView *view)
+{
+    if (view->decoded) {
+        bundle_free (view->decoded);
+        view->decoded = NULL;
+    }
+    if (view->values) {
+        g_ptr_array_unref (view->values);
+        view->values = NULL;
+    }
+    if (view->arrays) {
+        g_ptr_array_unref (view->arrays);
+        view->arrays = NULL;
+    }
+    view->data = NULL;
+}
+
+/*
+ * Encoded bundles can not be read key by key, those are decoded once
+ * and all later lookups go to the bundle.
+ */
+static bundle *
+_view_get_decoded (MsgPortMessageView *view)
+{
+    if (!view->decoded && msgport_variant_map_is_encoded (view->data)) {
+        DBG ("decoding encoded bundle for message view %p", view);
+        view->decoded = bundle_from_variant_map (view->data);
+    }
+
+    return view->decoded;
+}
+
+static GVariant *
+_view_lookup (MsgPortMessageView *view, const gchar *key, const GVariantType *type)
+{
+    GVariant *value = g_variant_lookup_value (view->data, key, type);
+
+    if (!value) return NULL;
+
+    /* values point into the received message, keep them until the view goes */
+    if (!view->values) view->values = g_ptr_array_new_with_free_func ((GDestroyNotify)g_variant_unref);
+    g_ptr_array_add (view->values, value);
+
+    return value;
+}
+
+messageport_error_e
+msgport_message_view_get_str (MsgPortMessageView *view, const gchar *key, const gchar **value)
+{
+    GVariant *v = NULL;
+    bundle *b = NULL;
+
+    g_return_val_if_fail (view && view->data && key && value, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    if ((b = _view_get_decoded (view)) != NULL) {
+        if (bundle_get_type (b, key) != BUNDLE_TYPE_STR) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+        *value = bundle_get_val (b, key);
+        return MESSAGEPORT_ERROR_NONE;
+    }
+
+    if (!(v = _view_lookup (view, key, G_VARIANT_TYPE_STRING)))
+        return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    *value = g_variant_get_string (v, NULL);
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_message_view_get_byte (MsgPortMessageView *view, const gchar *key, gconstpointer *data, gsize *size)
+{
+    GVariant *v = NULL;
+    bundle *b = NULL;
+
+    g_return_val_if_fail (view && view->data && key && data && size, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    if ((b = _view_get_decoded (view)) != NULL) {
+        void *bytes = NULL;
+        size_t len = 0;
+
+        if (bundle_get_type (b, key) != BUNDLE_TYPE_BYTE ||
+            bundle_get_byte (b, key, &bytes, &len) != 0)
+            return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+        *data = bytes;
+        *size = len;
+        return MESSAGEPORT_ERROR_NONE;
+    }
+
+    if (!(v = _view_lookup (view, key, G_VARIANT_TYPE_BYTESTRING)))
+        return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    *data = g_variant_get_fixed_array (v, size, sizeof (guchar));
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_message_view_get_str_array (MsgPortMessageView *view, const gchar *key, const gchar ***array, gint *len)
+{
+    GVariant *v = NULL;
+    bundle *b = NULL;
+    const gchar **strv = NULL;
+    gsize n = 0;
+
+    g_return_val_if_fail (view && view->data && key && array && len, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    if ((b = _view_get_decoded (view)) != NULL) {
+        if (bundle_get_type (b, key) != BUNDLE_TYPE_STR_ARRAY) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+        *array = bundle_get_str_array (b, key, len);
+        return MESSAGEPORT_ERROR_NONE;
+    }
+
+    if (!(v = _view_lookup (view, key, G_VARIANT_TYPE_STRING_ARRAY)))
+        return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    /* only the array is allocated, the strings are the ones in the message */
+    strv = g_variant_get_strv (v, &n);
+    if (!view->arrays) view->arrays = g_ptr_array_new_with_free_func (g_free);
+    g_ptr_array_add (view->arrays, strv);
+
+    *array = strv;
+    *len = (gint)n;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+bundle *
+msgport_message_view_to_bundle (MsgPortMessageView *view)
+{
+    bundle *b = NULL;
+
+    g_return_val_if_fail (view && view->data, NULL);
+
+    if ((b = _view_get_decoded (view)) != NULL) return bundle_dup (b);
+
+    return bundle_from_variant_map (view->data);
+}
@@ -0,0 +1,69 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MSGPORT_MESSAGE_VIEW_H
+#define __MSGPORT_MESSAGE_VIEW_H
+
+#include <glib.h>
+#include <bundle.h>
+#include <message-port.h>
+
+G_BEGIN_DECLS
+
+typedef struct _messageport_message_view_s MsgPortMessageView;
+
+/*
+ * A view lives on the stack of the delivering function, and is only valid
+ * for the duration of the callback it is passed to.
+ */
+struct _messageport_message_view_s
+{
+    GVariant  *data;     /* received a{sv}, not owned */
+    bundle    *decoded;  /* encoded bundles only, decoded on first access */
+    GPtrArray *values;   /* looked up values, kept alive with the view */
+    GPtrArray *arrays;   /* string arrays handed out */
+};
+
+void
+msgport_message_view_init (MsgPortMessageView *view, GVariant *data);
+
+void
+msgport_message_view_clear (MsgPortMessageView *view);
+
+messageport_error_e
+msgport_message_view_get_str (MsgPortMessageView *view, const gchar *key, const gchar **value);
+
+messageport_error_e
+msgport_message_view_get_byte (MsgPortMessageView *view, const gchar *key, gconstpointer *data, gsize *size);
+
+messageport_error_e
+msgport_message_view_get_str_array (MsgPortMessageView *view, const gchar *key, const gchar ***array, gint *len);
+
+bundle *
+msgport_message_view_to_bundle (MsgPortMessageView *view);
+
+G_END_DECLS
+
+#endif /* __MSGPORT_MESSAGE_VIEW_H */
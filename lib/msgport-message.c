@@ -0,0 +1,197 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "msgport-message.h"
+#include "common/bundle-variant.h"
+#include "common/log.h"
+
+/* keys of the envelopes the library packs messages in */
+#define MSGPORT_RESERVED_KEY_PREFIX "__MESSAGEPORT_"
+
+static void
+_message_init (MsgPortMessage *message, GVariant *data)
+{
+    message->data = data;
+    message->plain = NULL;
+    message->values = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify)g_variant_unref);
+}
+
+MsgPortMessage *
+msgport_message_new (void)
+{
+    MsgPortMessage *message = g_slice_new0 (MsgPortMessage);
+
+    _message_init (message, NULL);
+
+    return message;
+}
+
+/*
+ * Takes the reference on data, values set later replace the ones in data.
+ */
+MsgPortMessage *
+msgport_message_new_from_variant (GVariant *data)
+{
+    MsgPortMessage *message = NULL;
+
+    g_return_val_if_fail (data, NULL);
+
+    if (!g_variant_is_of_type (data, G_VARIANT_TYPE_VARDICT)) {
+        g_variant_unref (g_variant_ref_sink (data));
+        return NULL;
+    }
+
+    message = msgport_message_new ();
+    message->plain = g_variant_ref_sink (data);
+
+    return message;
+}
+
+void
+msgport_message_free (MsgPortMessage *message)
+{
+    if (!message) return;
+
+    msgport_message_clear (message);
+    g_slice_free (MsgPortMessage, message);
+}
+
+void
+msgport_message_init_received (MsgPortMessage *message, GVariant *data)
+{
+    _message_init (message, data);
+}
+
+void
+msgport_message_clear (MsgPortMessage *message)
+{
+    if (message->plain) {
+        g_variant_unref (message->plain);
+        message->plain = NULL;
+    }
+    if (message->values) {
+        g_hash_table_unref (message->values);
+        message->values = NULL;
+    }
+    message->data = NULL;
+}
+
+/*
+ * Encoded bundles can not be read key by key, those are converted
+ * to a map once.
+ */
+static GVariant *
+_message_get_data (MsgPortMessage *message)
+{
+    bundle *b = NULL;
+
+    if (!message->plain && message->data && msgport_variant_map_is_encoded (message->data)) {
+        DBG ("decoding encoded bundle for message %p", message);
+        b = bundle_from_variant_map (message->data);
+        message->plain = g_variant_ref_sink (bundle_to_variant_map (b));
+        bundle_free (b);
+    }
+
+    return message->plain ? message->plain : message->data;
+}
+
+messageport_error_e
+msgport_message_set_value (MsgPortMessage *message, const gchar *key, GVariant *value)
+{
+    g_return_val_if_fail (message && key && value, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    if (!key[0] || g_str_has_prefix (key, MSGPORT_RESERVED_KEY_PREFIX)) {
+        g_variant_unref (g_variant_ref_sink (value));
+        return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+    }
+
+    g_hash_table_replace (message->values, g_strdup (key), g_variant_ref_sink (value));
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+/*
+ * value is owned by the message, until key is set again.
+ */
+messageport_error_e
+msgport_message_get_value (MsgPortMessage *message, const gchar *key, const GVariantType *type, GVariant **value)
+{
+    GVariant *data = NULL;
+    GVariant *found = NULL;
+
+    g_return_val_if_fail (message && key && type && value, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    found = g_hash_table_lookup (message->values, key);
+    if (!found && (data = _message_get_data (message)) != NULL) {
+        found = g_variant_lookup_value (data, key, NULL);
+        /* values point into the received message, keep them with the message */
+        if (found) g_hash_table_insert (message->values, g_strdup (key), found);
+    }
+
+    if (!found || !g_variant_is_of_type (found, type)) return MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    *value = found;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+/*
+ * Returns a new reference, the values as they are, no bundle involved.
+ */
+GVariant *
+msgport_message_to_variant (MsgPortMessage *message)
+{
+    GVariantBuilder builder;
+    GVariantIter iter;
+    GHashTableIter values;
+    GVariant *data = NULL;
+    GVariant *value = NULL;
+    gchar *key = NULL;
+
+    g_return_val_if_fail (message, NULL);
+
+    data = _message_get_data (message);
+    if (data && !g_hash_table_size (message->values)) return g_variant_ref (data);
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+    /* a received or prebuilt map, keep what was not set again */
+    if (data) {
+        g_variant_iter_init (&iter, data);
+        while (g_variant_iter_next (&iter, "{sv}", &key, &value)) {
+            if (!g_hash_table_lookup (message->values, key))
+                g_variant_builder_add (&builder, "{sv}", key, value);
+            g_free (key);
+            g_variant_unref (value);
+        }
+    }
+
+    g_hash_table_iter_init (&values, message->values);
+    while (g_hash_table_iter_next (&values, (gpointer *)&key, (gpointer *)&value))
+        g_variant_builder_add (&builder, "{sv}", key, value);
+
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
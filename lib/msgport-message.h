@@ -0,0 +1,73 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of message-port.
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __MSGPORT_MESSAGE_H
+#define __MSGPORT_MESSAGE_H
+
+#include <glib.h>
+#include <message-port.h>
+
+G_BEGIN_DECLS
+
+typedef struct _messageport_message_s MsgPortMessage;
+
+/*
+ * Messages being built only have values, received ones wrap the received
+ * data for the duration of the callback they are passed to.
+ */
+struct _messageport_message_s
+{
+    GVariant   *data;   /* received a{sv}, not owned, NULL for messages being built */
+    GVariant   *plain;  /* data of encoded bundles as a map, or the map the message was made of */
+    GHashTable *values; /* {gchar *: GVariant *} values set, or looked up in data */
+};
+
+MsgPortMessage *
+msgport_message_new (void);
+
+MsgPortMessage *
+msgport_message_new_from_variant (GVariant *data);
+
+void
+msgport_message_free (MsgPortMessage *message);
+
+void
+msgport_message_init_received (MsgPortMessage *message, GVariant *data);
+
+void
+msgport_message_clear (MsgPortMessage *message);
+
+messageport_error_e
+msgport_message_set_value (MsgPortMessage *message, const gchar *key, GVariant *value);
+
+messageport_error_e
+msgport_message_get_value (MsgPortMessage *message, const gchar *key, const GVariantType *type, GVariant **value);
+
+GVariant *
+msgport_message_to_variant (MsgPortMessage *message);
+
+G_END_DECLS
+
+#endif /* __MSGPORT_MESSAGE_H */
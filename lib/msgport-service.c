@@ -24,20 +24,33 @@
  */
 
 #include "msgport-service.h"
+#include "msgport-manager.h"
 #include "msgport-utils.h"
+#include "msgport-message-view.h"
+#include "msgport-message.h"
 #include "common/dbus-service-glue.h"
+#include "common/delta.h"
 #include "common/log.h"
 #include <bundle.h>
+#include <gio/gunixfdlist.h>
 
 
 struct _MsgPortService
 {
     GObject parent;
 
+    MsgPortManager              *manager; /* not owned, it owns the service */
     MsgPortDbusGlueService      *proxy;
     guint                        on_message_signal_id;
     messageport_message_cb_full  client_cb;
+    messageport_message_with_fds_cb client_fds_cb;
+    messageport_message_view_cb  client_view_cb;
+    messageport_message_typed_cb client_typed_cb;
     void                        *client_data;
+    messageport_stream_cb        client_stream_cb;
+    void                        *client_stream_data;
+    MsgPortDeltaTable           *deltas; /* bases of the deltas received, created on demand */
+    gboolean                     plain_maps; /* daemon was asked to decode bundles for the view or typed handler */
 };
 
 G_DEFINE_TYPE(MsgPortService, msgport_service, G_TYPE_OBJECT)
@@ -49,6 +62,11 @@ _service_dispose (GObject *self)
 
     g_clear_object (&service->proxy);
 
+    if (service->deltas) {
+        msgport_delta_table_free (service->deltas);
+        service->deltas = NULL;
+    }
+
     G_OBJECT_CLASS(msgport_service_parent_class)->dispose (self);
 }
 
@@ -63,13 +81,20 @@ msgport_service_class_init (MsgPortServiceClass *klass)
 static void
 msgport_service_init (MsgPortService *service)
 {
+    service->manager = NULL;
     service->proxy = NULL;
     service->client_cb = NULL;
+    service->client_fds_cb = NULL;
+    service->client_view_cb = NULL;
+    service->client_typed_cb = NULL;
+    service->client_stream_cb = NULL;
+    service->deltas = NULL;
+    service->plain_maps = FALSE;
     service->on_message_signal_id = 0;
 }
 
 static void
-_on_got_message (MsgPortService *service, GVariant *data, const gchar *remote_app_id, const gchar *remote_port, gboolean remote_is_trusted, gpointer userdata)
+_deliver_message (MsgPortService *service, GVariant *data, const gint *fds, guint n_fds, const gchar *remote_app_id, const gchar *remote_port, gboolean remote_is_trusted)
 {
 #ifdef ENABLE_DEBUG
     gchar *str_data = g_variant_print (data, TRUE);
@@ -77,7 +102,30 @@ _on_got_message (MsgPortService *service, GVariant *data, const gchar *remote_ap
             str_data, remote_app_id, remote_port, remote_is_trusted);
     g_free (str_data);
 #endif
-    bundle *b = bundle_from_variant_map (data);
+    bundle *b = NULL;
+    GVariant *unpacked = NULL;
+
+    if (msgport_variant_map_is_compressed (data) || msgport_variant_map_get_schema_id (data, NULL)) {
+        unpacked = msgport_manager_unpack_message (service->manager, data);
+        if (!unpacked) {
+            WARN ("Dropping message from '%s':'%s' that could not be unpacked", remote_app_id, remote_port);
+            return;
+        }
+        data = unpacked;
+    }
+
+    if (msgport_variant_map_is_delta (data)) {
+        GVariant *full = NULL;
+
+        if (!service->deltas) service->deltas = msgport_delta_table_new ();
+        full = msgport_delta_table_apply (service->deltas, remote_app_id, data);
+        if (unpacked) g_variant_unref (unpacked);
+        if (!full) {
+            WARN ("Dropping delta from '%s':'%s' without its base", remote_app_id, remote_port);
+            return;
+        }
+        data = unpacked = full;
+    }
 
     /*
      * NOTE: wrt plugin cannot handle empty strings for port_id and app_id.
@@ -87,11 +135,120 @@ _on_got_message (MsgPortService *service, GVariant *data, const gchar *remote_ap
     if (remote_app_id && !remote_app_id[0]) remote_app_id = NULL;
     if (remote_port   && !remote_port[0])   remote_port = NULL;
 
-    service->client_cb (msgport_dbus_glue_service_get_id (service->proxy), remote_app_id, remote_port, remote_is_trusted, b, service->client_data);
+    if (service->client_view_cb) {
+        /* no bundle at all, the handler looks up the keys it needs */
+        MsgPortMessageView view;
+
+        msgport_message_view_init (&view, data);
+        service->client_view_cb (msgport_dbus_glue_service_get_id (service->proxy), remote_app_id, remote_port,
+                remote_is_trusted, &view, service->client_data);
+        msgport_message_view_clear (&view);
+    }
+    else if (service->client_typed_cb) {
+        /* the values are read from the received map as they are */
+        MsgPortMessage message;
+
+        msgport_message_init_received (&message, data);
+        service->client_typed_cb (msgport_dbus_glue_service_get_id (service->proxy), remote_app_id, remote_port,
+                remote_is_trusted, &message, service->client_data);
+        msgport_message_clear (&message);
+    }
+    else {
+        b = bundle_from_variant_map (data);
+
+        if (service->client_fds_cb)
+            service->client_fds_cb (msgport_dbus_glue_service_get_id (service->proxy), remote_app_id, remote_port,
+                    remote_is_trusted, b, fds, n_fds, service->client_data);
+        else
+            service->client_cb (msgport_dbus_glue_service_get_id (service->proxy), remote_app_id, remote_port,
+                    remote_is_trusted, b, service->client_data);
+    }
+
+    if (unpacked) g_variant_unref (unpacked);
+}
+
+static void
+_on_got_message (MsgPortService *service, GVariant *data, const gchar *remote_app_id, const gchar *remote_port, gboolean remote_is_trusted, gpointer userdata)
+{
+    _deliver_message (service, data, NULL, 0, remote_app_id, remote_port, remote_is_trusted);
+}
+
+static void
+_on_got_messages (MsgPortService *service, GVariant *messages, const gchar *remote_app_id, const gchar *remote_port, gboolean remote_is_trusted, gpointer userdata)
+{
+    GVariantIter iter;
+    GVariant *data = NULL;
+
+    DBG ("Batch of %lu messages received from '%s':'%s':%d",
+            (gulong)g_variant_n_children (messages), remote_app_id, remote_port, remote_is_trusted);
+
+    /* deliver one by one, in the order they were sent */
+    g_variant_iter_init (&iter, messages);
+    while ((data = g_variant_iter_next_value (&iter)) != NULL) {
+        _on_got_message (service, data, remote_app_id, remote_port, remote_is_trusted, userdata);
+        g_variant_unref (data);
+    }
+}
+
+static void
+_on_channel_revoked (MsgPortService *service, guint channel_id, gpointer userdata)
+{
+    msgport_manager_revoke_incoming_channel (service->manager, channel_id);
+}
+
+void
+msgport_service_handle_message_with_fds (MsgPortService *service, GVariant *data, const gint *fds, guint n_fds, const gchar *remote_app_id, const gchar *remote_port, gboolean remote_is_trusted)
+{
+    g_return_if_fail (service && MSGPORT_IS_SERVICE (service));
+
+    DBG ("Message with %u fds received from '%s':'%s':%d", n_fds, remote_app_id, remote_port, remote_is_trusted);
+
+    _deliver_message (service, data, fds, n_fds, remote_app_id, remote_port, remote_is_trusted);
+}
+
+/*
+ * chunk is NULL at the end of the stream, result tells if it got complete.
+ * Returns FALSE if the service does not accept streams.
+ */
+gboolean
+msgport_service_handle_stream_chunk (MsgPortService *service, guint stream_id, gconstpointer chunk, gsize size, messageport_error_e result, const gchar *remote_app_id, const gchar *remote_port, gboolean remote_is_trusted)
+{
+    g_return_val_if_fail (service && MSGPORT_IS_SERVICE (service), FALSE);
+
+    if (!service->client_stream_cb) {
+        WARN ("Service '%s' does not accept streams, dropping stream %u", msgport_service_name (service), stream_id);
+        return FALSE;
+    }
+
+    if (remote_app_id && !remote_app_id[0]) remote_app_id = NULL;
+    if (remote_port   && !remote_port[0])   remote_port = NULL;
+
+    service->client_stream_cb (msgport_dbus_glue_service_get_id (service->proxy), (int)stream_id,
+            remote_app_id, remote_port, remote_is_trusted, chunk, (unsigned int)size, result,
+            service->client_stream_data);
+
+    return TRUE;
+}
+
+/*
+ * View and typed handlers read the values key by key, encoded bundles
+ * would have to be decoded as a whole here. Messages already on the way
+ * might still come encoded.
+ */
+static void
+_service_update_plain_maps (MsgPortService *service)
+{
+    gboolean plain_maps = service->client_view_cb || service->client_typed_cb;
+
+    if (plain_maps == service->plain_maps) return;
+    service->plain_maps = plain_maps;
+
+    /* fire and forget, older daemons do not know the method */
+    msgport_dbus_glue_service_call_set_plain_maps (service->proxy, plain_maps, NULL, NULL, NULL);
 }
 
 MsgPortService *
-msgport_service_new (GDBusConnection *connection, const gchar *path, messageport_message_cb_full message_cb, void *userdata)
+msgport_service_new (MsgPortManager *manager, GDBusConnection *connection, const gchar *path, messageport_message_cb_full message_cb, messageport_message_with_fds_cb fds_cb, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, void *userdata)
 {
     GError *error = NULL;
 
@@ -109,9 +266,16 @@ msgport_service_new (GDBusConnection *connection, const gchar *path, messageport
         return NULL;
     }
 
+    service->manager = manager;
     service->client_cb = message_cb;
+    service->client_fds_cb = fds_cb;
+    service->client_view_cb = view_cb;
+    service->client_typed_cb = typed_cb;
     service->client_data = userdata;
     service->on_message_signal_id = g_signal_connect_swapped (service->proxy, "on-message", G_CALLBACK (_on_got_message), service);
+    g_signal_connect_swapped (service->proxy, "on-messages", G_CALLBACK (_on_got_messages), service);
+    g_signal_connect_swapped (service->proxy, "on-channel-revoked", G_CALLBACK (_on_channel_revoked), service);
+    _service_update_plain_maps (service);
 
     return service;
 }
@@ -144,12 +308,25 @@ msgport_service_is_trusted (MsgPortService *service)
 }
 
 void
-msgport_service_set_message_handler (MsgPortService *service, messageport_message_cb_full handler, void *userdata)
+msgport_service_set_message_handler (MsgPortService *service, messageport_message_cb_full handler, messageport_message_with_fds_cb fds_handler, messageport_message_view_cb view_handler, messageport_message_typed_cb typed_handler, void *userdata)
 {
     g_return_if_fail (service && MSGPORT_IS_SERVICE (service));
 
     service->client_cb = handler;
+    service->client_fds_cb = fds_handler;
+    service->client_view_cb = view_handler;
+    service->client_typed_cb = typed_handler;
     service->client_data = userdata;
+    _service_update_plain_maps (service);
+}
+
+void
+msgport_service_set_stream_handler (MsgPortService *service, messageport_stream_cb handler, void *userdata)
+{
+    g_return_if_fail (service && MSGPORT_IS_SERVICE (service));
+
+    service->client_stream_cb = handler;
+    service->client_stream_data = userdata;
 }
 
 gboolean
@@ -181,3 +358,169 @@ msgport_service_send_message (MsgPortService *service, guint remote_service_id,
 
     return MESSAGEPORT_ERROR_NONE;
 }
+
+messageport_error_e
+msgport_service_send_message_to (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *message, guint *remote_service_id_out)
+{
+    GError *error = NULL;
+    guint remote_service_id = 0;
+    g_return_val_if_fail (service && MSGPORT_IS_SERVICE (service), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (service->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && message, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    msgport_dbus_glue_service_call_send_message_to_sync (service->proxy, remote_app_id, remote_port,
+            is_trusted, message, &remote_service_id, NULL, &error);
+
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Fail to send message on service %p to %s:%s : %s", service, remote_app_id, remote_port, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    if (remote_service_id_out) *remote_service_id_out = remote_service_id;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+void
+msgport_service_send_message_async (MsgPortService *service, guint remote_service_id, GVariant *message, GAsyncReadyCallback cb, gpointer userdata)
+{
+    g_return_if_fail (service && MSGPORT_IS_SERVICE (service));
+    g_return_if_fail (service->proxy);
+
+    msgport_dbus_glue_service_call_send_message (service->proxy, remote_service_id, message, NULL, cb, userdata);
+}
+
+messageport_error_e
+msgport_service_send_message_finish (MsgPortService *service, GAsyncResult *result)
+{
+    GError *error = NULL;
+    g_return_val_if_fail (service && MSGPORT_IS_SERVICE (service), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (service->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+
+    if (!msgport_dbus_glue_service_call_send_message_finish (service->proxy, result, &error)) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Fail to send message on service %p : %s", service, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+void
+msgport_service_send_message_to_async (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *message, GAsyncReadyCallback cb, gpointer userdata)
+{
+    g_return_if_fail (service && MSGPORT_IS_SERVICE (service));
+    g_return_if_fail (service->proxy);
+
+    msgport_dbus_glue_service_call_send_message_to (service->proxy, remote_app_id, remote_port,
+            is_trusted, message, NULL, cb, userdata);
+}
+
+messageport_error_e
+msgport_service_send_message_to_finish (MsgPortService *service, GAsyncResult *result, guint *remote_service_id_out)
+{
+    GError *error = NULL;
+    guint remote_service_id = 0;
+    g_return_val_if_fail (service && MSGPORT_IS_SERVICE (service), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (service->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+
+    if (!msgport_dbus_glue_service_call_send_message_to_finish (service->proxy, &remote_service_id, result, &error)) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Fail to send message on service %p : %s", service, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    if (remote_service_id_out) *remote_service_id_out = remote_service_id;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_service_send_large_message_to (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, gint payload_fd, gsize size, guint *remote_service_id_out)
+{
+    GError *error = NULL;
+    GUnixFDList *fd_list = NULL;
+    guint remote_service_id = 0;
+    g_return_val_if_fail (service && MSGPORT_IS_SERVICE (service), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (service->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && payload_fd >= 0, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    fd_list = g_unix_fd_list_new_from_array (&payload_fd, 1); /* takes the fd */
+
+    msgport_dbus_glue_service_call_send_large_message_to_sync (service->proxy, remote_app_id, remote_port,
+            is_trusted, g_variant_new_handle (0), size, fd_list, &remote_service_id, NULL, NULL, &error);
+    g_object_unref (fd_list);
+
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Fail to send large message on service %p to %s:%s : %s", service, remote_app_id, remote_port, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    if (remote_service_id_out) *remote_service_id_out = remote_service_id;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+void
+msgport_service_send_large_message_to_async (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, gint payload_fd, gsize size, GAsyncReadyCallback cb, gpointer userdata)
+{
+    GUnixFDList *fd_list = NULL;
+    g_return_if_fail (service && MSGPORT_IS_SERVICE (service));
+    g_return_if_fail (service->proxy);
+
+    fd_list = g_unix_fd_list_new_from_array (&payload_fd, 1); /* takes the fd */
+
+    msgport_dbus_glue_service_call_send_large_message_to (service->proxy, remote_app_id, remote_port,
+            is_trusted, g_variant_new_handle (0), size, fd_list, NULL, cb, userdata);
+    g_object_unref (fd_list);
+}
+
+messageport_error_e
+msgport_service_send_large_message_to_finish (MsgPortService *service, GAsyncResult *result, guint *remote_service_id_out)
+{
+    GError *error = NULL;
+    guint remote_service_id = 0;
+    g_return_val_if_fail (service && MSGPORT_IS_SERVICE (service), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (service->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+
+    if (!msgport_dbus_glue_service_call_send_large_message_to_finish (service->proxy, &remote_service_id, NULL, result, &error)) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Fail to send large message on service %p : %s", service, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    if (remote_service_id_out) *remote_service_id_out = remote_service_id;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
+
+messageport_error_e
+msgport_service_send_message_with_fds_to (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *message, GVariant *fds, GUnixFDList *fd_list, guint *remote_service_id_out)
+{
+    GError *error = NULL;
+    guint remote_service_id = 0;
+    g_return_val_if_fail (service && MSGPORT_IS_SERVICE (service), MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (service->proxy, MESSAGEPORT_ERROR_IO_ERROR);
+    g_return_val_if_fail (remote_app_id && remote_port && message && fds, MESSAGEPORT_ERROR_INVALID_PARAMETER);
+
+    msgport_dbus_glue_service_call_send_message_with_fds_to_sync (service->proxy, remote_app_id, remote_port,
+            is_trusted, message, fds, fd_list, &remote_service_id, NULL, NULL, &error);
+
+    if (error) {
+        messageport_error_e err = msgport_daemon_error_to_error (error);
+        WARN ("Fail to send message with fds on service %p to %s:%s : %s", service, remote_app_id, remote_port, error->message);
+        g_error_free (error);
+        return err;
+    }
+
+    if (remote_service_id_out) *remote_service_id_out = remote_service_id;
+
+    return MESSAGEPORT_ERROR_NONE;
+}
@@ -28,6 +28,7 @@
 
 #include <glib.h>
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 #include <glib-object.h>
 #include <message-port.h>
 
@@ -41,6 +42,7 @@ G_BEGIN_DECLS
 
 typedef struct _MsgPortService MsgPortService;
 typedef struct _MsgPortServiceClass MsgPortServiceClass;
+typedef struct _MsgPortManager MsgPortManager;
 
 struct _MsgPortServiceClass
 {
@@ -50,7 +52,7 @@ struct _MsgPortServiceClass
 GType msgport_service_get_type(void);
 
 MsgPortService *
-msgport_service_new (GDBusConnection *connection, const gchar *path, messageport_message_cb_full message_cb, void *userdata);
+msgport_service_new (MsgPortManager *manager, GDBusConnection *connection, const gchar *path, messageport_message_cb_full message_cb, messageport_message_with_fds_cb fds_cb, messageport_message_view_cb view_cb, messageport_message_typed_cb typed_cb, void *userdata);
 
 const gchar *
 msgport_service_name (MsgPortService *service);
@@ -62,7 +64,10 @@ guint
 msgport_service_id (MsgPortService *service);
 
 void
-msgport_service_set_message_handler (MsgPortService *service, messageport_message_cb_full handler, void *userdata);
+msgport_service_set_message_handler (MsgPortService *service, messageport_message_cb_full handler, messageport_message_with_fds_cb fds_handler, messageport_message_view_cb view_handler, messageport_message_typed_cb typed_handler, void *userdata);
+
+void
+msgport_service_set_stream_handler (MsgPortService *service, messageport_stream_cb handler, void *userdata);
 
 gboolean
 msgport_service_unregister (MsgPortService *service);
@@ -70,6 +75,39 @@ msgport_service_unregister (MsgPortService *service);
 messageport_error_e
 msgport_service_send_message (MsgPortService *service, guint remote_service_id, GVariant *message);
 
+messageport_error_e
+msgport_service_send_message_to (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *message, guint *remote_service_id_out);
+
+messageport_error_e
+msgport_service_send_large_message_to (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, gint payload_fd, gsize size, guint *remote_service_id_out);
+
+messageport_error_e
+msgport_service_send_message_with_fds_to (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *message, GVariant *fds, GUnixFDList *fd_list, guint *remote_service_id_out);
+
+void
+msgport_service_handle_message_with_fds (MsgPortService *service, GVariant *data, const gint *fds, guint n_fds, const gchar *remote_app_id, const gchar *remote_port, gboolean remote_is_trusted);
+
+gboolean
+msgport_service_handle_stream_chunk (MsgPortService *service, guint stream_id, gconstpointer chunk, gsize size, messageport_error_e result, const gchar *remote_app_id, const gchar *remote_port, gboolean remote_is_trusted);
+
+void
+msgport_service_send_message_async (MsgPortService *service, guint remote_service_id, GVariant *message, GAsyncReadyCallback cb, gpointer userdata);
+
+messageport_error_e
+msgport_service_send_message_finish (MsgPortService *service, GAsyncResult *result);
+
+void
+msgport_service_send_message_to_async (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, GVariant *message, GAsyncReadyCallback cb, gpointer userdata);
+
+messageport_error_e
+msgport_service_send_message_to_finish (MsgPortService *service, GAsyncResult *result, guint *remote_service_id_out);
+
+void
+msgport_service_send_large_message_to_async (MsgPortService *service, const gchar *remote_app_id, const gchar *remote_port, gboolean is_trusted, gint payload_fd, gsize size, GAsyncReadyCallback cb, gpointer userdata);
+
+messageport_error_e
+msgport_service_send_large_message_to_finish (MsgPortService *service, GAsyncResult *result, guint *remote_service_id_out);
+
 G_END_DECLS
 
 #endif /* __MSGPORT_SERVICE_H */
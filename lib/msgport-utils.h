@@ -26,13 +26,14 @@
 #ifndef __MSGPORT_UTILS_H
 #define __MSGPORT_UTILS_H
 
-#include <bundle.h>
 #include <glib.h>
 #include <message-port.h>
+#include "common/bundle-variant.h"
 
-GVariant *bundle_to_variant_map (bundle *b);
-bundle   *bundle_from_variant_map (GVariant *v);
+/* the daemon did not know the base of a delta, never returned to applications */
+#define MESSAGEPORT_ERROR_DELTA_BASE_NOT_FOUND ((messageport_error_e)(TIZEN_ERROR_MESSAGE_PORT | 0xff))
 
 messageport_error_e msgport_daemon_error_to_error (const GError *error);
+messageport_error_e msgport_daemon_error_code_to_error (gint code);
 
 #endif /* __MSGPORT_UTILS_H */
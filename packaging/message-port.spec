@@ -20,6 +20,9 @@ BuildRequires: pkgconfig(glib-2.0) >= 2.30
 BuildRequires: pkgconfig(gobject-2.0)
 BuildRequires: pkgconfig(pkgmgr-info)
 BuildRequires: pkgconfig(capi-base-common)
+%if %{build_tests} == 1
+BuildRequires: python3
+%endif
 
 %description
 This daemon allows the webapplications to communicates using 
@@ -42,6 +45,7 @@ Client library that porvies C APIs to work with message port.
 Summary:    Development files for libmessage-port 
 Group:      Development/Libraries
 Requires:   lib%{name} = %{version}-%{release}
+Requires:   python3
 
 %description -n lib%{name}-devel
 Development files for message-port client library.
@@ -125,6 +129,8 @@ ldconfig
 %{_libdir}/pkgconfig/%{name}.pc
 %{_libdir}/lib%{name}.so
 %{_includedir}/*.h
+%{_includedir}/*.hpp
+%{_bindir}/msgport-codegen
 
 %if %{build_tests} == 1
 %files -n %{name}-tests
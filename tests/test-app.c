@@ -28,7 +28,9 @@
 #include <glib.h>
 #include <glib/gprintf.h>
 #include <glib-unix.h>
+#include <gio/gio.h>
 #include <message-port.h>
+#include "test-messages.h"
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -38,8 +40,22 @@ pid_t __daemon_pid; /* dbus daemon pid */
 
 const gchar *PARENT_TEST_PORT = "parent_test_port";
 const gchar *PARENT_TEST_TRUSTED_PORT = "parent_test_trusted_port";
+const gchar *PARENT_TEST_UNREGISTER_PORT = "parent_test_unregister_port";
+const gchar *PARENT_TEST_FDS_PORT = "parent_test_fds_port";
+const gchar *PARENT_TEST_STREAM_PORT = "parent_test_stream_port";
+const gchar *PARENT_TEST_VIEW_PORT = "parent_test_view_port";
+const gchar *PARENT_TEST_TYPED_PORT = "parent_test_typed_port";
+#define TEST_INT64 G_GINT64_CONSTANT (-9007199254740993)
+#define TEST_STREAM_SIZE (1024 * 1024)
 const gchar *CHILD_TEST_PORT = "child_test_port";
 const gchar *CHILD_TEST_TRUSTED_PORT = "child_test_trusted_port";
+const gchar *CHILD_TEST_WATCH_PORT = "child_test_watch_port";
+const gchar *CHILD_TEST_LEGACY_PORT = "child_test_legacy_port";
+const gchar *CHILD_TEST_LEGACY_BATCH_PORT = "child_test_legacy_batch_port";
+const gchar *CHILD_TEST_LEGACY_FDS_PORT = "child_test_legacy_fds_port";
+const gchar *CHILD_TEST_PLAIN_MAPS_PORT = "child_test_plain_maps_port";
+const gchar *CHILD_TEST_CHANNEL_PORT = "child_test_channel_port";
+const gchar *CHILD_TEST_STREAM_PORT = "child_test_stream_port";
 
 struct AsyncTestData
 {
@@ -70,10 +86,61 @@ static void _dump_data (const char *key, const int type, const bundle_keyval_t *
 {
     gchar *val = NULL;
     size_t size;
+
+    if (type != BUNDLE_TYPE_STR) {
+        g_debug ("       %s - (type %d)", key, type);
+        return;
+    }
     bundle_keyval_get_basic_val ((bundle_keyval_t*)kv, (void**)&val, &size);
     g_debug ("       %s - %s", key, val);
 }
 
+static const guchar TEST_BYTES[] = { 'a', 0, 'b', 0xff };
+
+#define TEST_LOG_LINE "I/MESSAGEPORT: compressible log line\n"
+#define TEST_LOG_LINES 4096
+
+/* value added by test_send_compressed_message, if any */
+static gboolean _check_log_value (bundle *data)
+{
+    const char *log = bundle_get_val (data, "Log");
+
+    if (!log) return TRUE;
+
+    return strlen (log) == strlen (TEST_LOG_LINE) * TEST_LOG_LINES &&
+           strncmp (log, TEST_LOG_LINE, strlen (TEST_LOG_LINE)) == 0;
+}
+
+/* values added by test_send_message_with_shared_schema, if any */
+static gboolean _check_schema_values (bundle *data)
+{
+    if (g_strcmp0 (bundle_get_val (data, "Type"), "schema") != 0) return TRUE;
+
+    return g_strcmp0 (bundle_get_val (data, "Name"), "Amarnath") == 0;
+}
+
+/* values added by test_send_message_with_typed_values, if any */
+static gboolean _check_typed_values (bundle *data)
+{
+    void *bytes = NULL;
+    size_t size = 0;
+    const char **names = NULL;
+    int n_names = 0;
+
+    if (bundle_get_type (data, "Bytes") < 0) return TRUE;
+
+    if (bundle_get_type (data, "Bytes") != BUNDLE_TYPE_BYTE ||
+        bundle_get_byte (data, "Bytes", &bytes, &size) != 0 ||
+        size != sizeof (TEST_BYTES) || memcmp (bytes, TEST_BYTES, size) != 0)
+        return FALSE;
+
+    names = bundle_get_str_array (data, "Names", &n_names);
+    if (!names || n_names != 2 || g_strcmp0 (names[0], "Amarnath") != 0 || g_strcmp0 (names[1], "") != 0)
+        return FALSE;
+
+    return bundle_get_type (data, "Blobs") == BUNDLE_TYPE_BYTE_ARRAY;
+}
+
 void (_on_child_got_message)(int port_id, const char* remote_app_id, const char* remote_port, gboolean trusted_message, bundle* data)
 {
     gchar *name = NULL;
@@ -110,7 +177,7 @@ void (_on_parent_got_message)(int port_id, const char* remote_app_id, const char
     bundle_foreach (data, _dump_data, NULL);
 
     /* Write acknoledgement */
-    if ( write (__pipe[1], "OK", strlen("OK") + 1) < 3) {
+    if ( write (__pipe[1], _check_typed_values (data) && _check_log_value (data) && _check_schema_values (data) ? "OK" : "KO", strlen("OK") + 1) < 3) {
         g_warning ("WRITE failed");
     }
 
@@ -144,6 +211,111 @@ void (_on_parent_got_message)(int port_id, const char* remote_app_id, const char
     else g_debug ("PARENT: Data sent successfully");
 }
 
+void (_on_parent_got_message_with_fds)(int port_id, const char* remote_app_id, const char* remote_port, bool trusted_message, bundle* data, const int *fds, unsigned int n_fds, void *userdata)
+{
+    gchar buf[32] = { 0 };
+
+    g_debug ("PARENT: GOT MESSAGE with %u fds FROM :'%s'", n_fds, remote_app_id ? remote_app_id : "unknwon");
+    g_assert (data);
+
+    /* the peer wrote its acknowledgement into the passed pipe */
+    if (n_fds != 1 || read (fds[0], buf, sizeof("OK")) < 3) {
+        g_warning ("PARENT: Did not get the expected file descriptor");
+        return;
+    }
+
+    if (write (__pipe[1], buf, strlen(buf) + 1) < 3) {
+        g_warning ("WRITE failed");
+    }
+}
+
+void (_on_parent_got_message_view)(int port_id, const char* remote_app_id, const char* remote_port, bool trusted_message, messageport_message_view_h message, void *userdata)
+{
+    const char *type = NULL;
+    const void *bytes = NULL;
+    size_t size = 0;
+    gboolean ok;
+
+    g_debug ("PARENT: GOT MESSAGE VIEW FROM :'%s'", remote_app_id ? remote_app_id : "unknwon");
+    g_assert (message);
+
+    /* only the keys looked up get decoded, a missing one must not be found */
+    ok = messageport_message_view_get_str (message, "Type", &type) == MESSAGEPORT_ERROR_NONE &&
+         g_strcmp0 (type, "view") == 0 &&
+         messageport_message_view_get_byte (message, "Bytes", &bytes, &size) == MESSAGEPORT_ERROR_NONE &&
+         size == sizeof (TEST_BYTES) && memcmp (bytes, TEST_BYTES, size) == 0 &&
+         messageport_message_view_get_str (message, "Bytes", &type) == MESSAGEPORT_ERROR_INVALID_PARAMETER &&
+         messageport_message_view_get_str (message, "Missing", &type) == MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    if (write (__pipe[1], ok ? "OK" : "KO", strlen("OK") + 1) < 3) {
+        g_warning ("WRITE failed");
+    }
+}
+
+void (_on_parent_got_typed_message)(int port_id, const char* remote_app_id, const char* remote_port, bool trusted_message, messageport_message_t *message, void *userdata)
+{
+    int64_t count = 0;
+    double ratio = 0;
+    bool done = FALSE;
+    const char *type = NULL;
+    const void *bytes = NULL;
+    size_t size = 0;
+    TestTypedMessage decoded;
+    gboolean ok;
+
+    g_debug ("PARENT: GOT TYPED MESSAGE FROM :'%s'", remote_app_id ? remote_app_id : "unknwon");
+    g_assert (message);
+
+    /* values come as they were set, no conversion from or to strings */
+    ok = messageport_message_get_int64 (message, "Count", &count) == MESSAGEPORT_ERROR_NONE && count == TEST_INT64 &&
+         messageport_message_get_double (message, "Ratio", &ratio) == MESSAGEPORT_ERROR_NONE && ratio == 0.25 &&
+         messageport_message_get_bool (message, "Done", &done) == MESSAGEPORT_ERROR_NONE && done &&
+         messageport_message_get_str (message, "Type", &type) == MESSAGEPORT_ERROR_NONE &&
+         g_strcmp0 (type, "typed") == 0 &&
+         messageport_message_get_blob (message, "Bytes", &bytes, &size) == MESSAGEPORT_ERROR_NONE &&
+         size == sizeof (TEST_BYTES) && memcmp (bytes, TEST_BYTES, size) == 0 &&
+         messageport_message_get_int64 (message, "Type", &count) == MESSAGEPORT_ERROR_INVALID_PARAMETER &&
+         messageport_message_get_str (message, "Missing", &type) == MESSAGEPORT_ERROR_INVALID_PARAMETER;
+
+    /* the generated decoder reads the same values */
+    ok = ok && test_typed_message_from_message (message, &decoded) &&
+         decoded.count == TEST_INT64 && decoded.ratio == 0.25 && decoded.done &&
+         g_strcmp0 (decoded.type, "typed") == 0 && decoded.bytes_size == sizeof (TEST_BYTES) &&
+         memcmp (decoded.bytes, TEST_BYTES, decoded.bytes_size) == 0;
+    test_typed_message_clear (&decoded);
+
+    if (write (__pipe[1], ok ? "OK" : "KO", strlen("OK") + 1) < 3) {
+        g_warning ("WRITE failed");
+    }
+}
+
+void (_on_parent_got_stream_chunk)(int port_id, int stream_id, const char* remote_app_id, const char* remote_port, bool trusted_remote_port, const void *chunk, unsigned int size, messageport_error_e result, void *userdata)
+{
+    static gsize received = 0;
+    const guchar *bytes = chunk;
+    unsigned int i;
+
+    if (chunk) {
+        /* the child writes a known pattern */
+        for (i = 0; i < size; i++, received++) {
+            if (bytes[i] != received % 251) {
+                g_warning ("PARENT: Unexpected data at offset %lu of stream %d", (gulong)received, stream_id);
+                return;
+            }
+        }
+        return;
+    }
+
+    g_debug ("PARENT: GOT STREAM %d of %lu bytes FROM :'%s', result : %d", stream_id, (gulong)received,
+        remote_app_id ? remote_app_id : "unknwon", result);
+
+    if (result == MESSAGEPORT_ERROR_NONE && received == TEST_STREAM_SIZE &&
+        write (__pipe[1], "OK", strlen("OK") + 1) < 3) {
+        g_warning ("WRITE failed");
+    }
+    received = 0;
+}
+
 int _register_test_port (const gchar *port_name, gboolean is_trusted, messageport_message_cb cb)
 {
     int port_id = is_trusted ? messageport_register_trusted_local_port (port_name, cb)
@@ -172,6 +344,50 @@ test_register_trusted_local_port()
     return TRUE;
 }
 
+static gboolean
+test_register_local_port_with_fds ()
+{
+    int port_id = messageport_register_local_port_with_fds (PARENT_TEST_FDS_PORT, FALSE, _on_parent_got_message_with_fds, NULL);
+
+    test_assert (port_id >= 0, "Failed to register port '%s', error : %d", PARENT_TEST_FDS_PORT, port_id);
+
+    return TRUE;
+}
+
+static gboolean
+test_set_stream_handler ()
+{
+    messageport_error_e res;
+    int port_id = _register_test_port (PARENT_TEST_STREAM_PORT, FALSE, _on_parent_got_message);
+
+    test_assert (port_id >= 0, "Failed to register port '%s', error : %d", PARENT_TEST_STREAM_PORT, port_id);
+
+    res = messageport_set_stream_handler (port_id, _on_parent_got_stream_chunk, NULL);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Failed to set stream handler on port '%s', error : %d", PARENT_TEST_STREAM_PORT, res);
+
+    return TRUE;
+}
+
+static gboolean
+test_register_local_port_with_view ()
+{
+    int port_id = messageport_register_local_port_with_view (PARENT_TEST_VIEW_PORT, FALSE, _on_parent_got_message_view, NULL);
+
+    test_assert (port_id >= 0, "Failed to register port '%s', error : %d", PARENT_TEST_VIEW_PORT, port_id);
+
+    return TRUE;
+}
+
+static gboolean
+test_register_local_port_typed ()
+{
+    int port_id = messageport_register_local_port_typed (PARENT_TEST_TYPED_PORT, FALSE, _on_parent_got_typed_message, NULL);
+
+    test_assert (port_id >= 0, "Failed to register port '%s', error : %d", PARENT_TEST_TYPED_PORT, port_id);
+
+    return TRUE;
+}
+
 static gboolean
 test_check_remote_port()
 {
@@ -226,154 +442,1287 @@ test_send_message()
 }
 
 static gboolean
-test_send_trusted_message()
+test_send_message_with_typed_values()
 {
     messageport_error_e res;
     gchar remote_app_id[128];
+    gchar result[32];
     bundle *b = bundle_create ();
+
     bundle_add (b, "Name", "Amarnath");
-    bundle_add (b, "Email", "amarnath.valluri@intel.com");
+    bundle_add_byte (b, "Bytes", TEST_BYTES, sizeof (TEST_BYTES));
+    /* second name is left unset and arrives as "" */
+    bundle_add_str_array (b, "Names", NULL, 2);
+    bundle_set_str_array_element (b, "Names", 0, "Amarnath");
+    bundle_add_byte_array (b, "Blobs", NULL, 2);
+    bundle_set_byte_array_element (b, "Blobs", 0, TEST_BYTES, sizeof (TEST_BYTES));
+    bundle_set_byte_array_element (b, "Blobs", 1, "", 0);
 
     g_sprintf (remote_app_id, "%d", getppid());
-    res = messageport_send_trusted_message (remote_app_id, PARENT_TEST_TRUSTED_PORT, b);
+    res = messageport_send_message (remote_app_id, PARENT_TEST_PORT, b);
     bundle_free (b);
     test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
 
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the values with their types");
+
+    return TRUE;
+}
+
+static gboolean
+test_send_message_to_view()
+{
+    messageport_error_e res;
+    gchar remote_app_id[128];
+    gchar result[32];
+    bundle *b = bundle_create ();
+
+    bundle_add (b, "Type", "view");
+    bundle_add_byte (b, "Bytes", TEST_BYTES, sizeof (TEST_BYTES));
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_send_message (remote_app_id, PARENT_TEST_VIEW_PORT, b);
+    bundle_free (b);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_VIEW_PORT, remote_app_id, res);
+
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not read the values from the message view");
+
+    return TRUE;
+}
+
+static gboolean
+test_send_typed_message()
+{
+    messageport_error_e res;
+    gchar remote_app_id[128];
     gchar result[32];
+    messageport_message_t *message = messageport_message_create ();
 
-    test_assert( (read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
-    test_assert( (g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+    messageport_message_set_int64 (message, "Count", TEST_INT64);
+    messageport_message_set_double (message, "Ratio", 0.25);
+    messageport_message_set_bool (message, "Done", TRUE);
+    messageport_message_set_str (message, "Type", "typed");
+    messageport_message_set_blob (message, "Bytes", TEST_BYTES, sizeof (TEST_BYTES));
+
+    res = messageport_message_set_int64 (message, "__MESSAGEPORT_ENCODED_BUNDLE__", 0);
+    test_assert (res == MESSAGEPORT_ERROR_INVALID_PARAMETER, "Reserved key accepted, result : %d", res);
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_send_typed_message (remote_app_id, PARENT_TEST_TYPED_PORT, FALSE, message);
+    messageport_message_destroy (message);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_TYPED_PORT, remote_app_id, res);
+
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not get the typed values");
 
     return TRUE;
 }
 
 static gboolean
-_update_test_result (gpointer data)
+test_send_generated_message()
 {
-    if (__test_data) {
-        __test_data->result = FALSE;
-        g_main_loop_quit (__test_data->m_loop);
+    messageport_error_e res;
+    gchar remote_app_id[128];
+    gchar result[32];
+    TestTypedMessage message = { 0, };
+
+    message.count = TEST_INT64;
+    message.ratio = 0.25;
+    message.done = TRUE;
+    message.type = "typed";
+    message.bytes = (const guint8 *)TEST_BYTES;
+    message.bytes_size = sizeof (TEST_BYTES);
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = test_typed_message_send (remote_app_id, PARENT_TEST_TYPED_PORT, FALSE, &message);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_TYPED_PORT, remote_app_id, res);
+
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not get the generated message");
+
+    return TRUE;
+}
+
+static gboolean
+test_send_message_with_schema()
+{
+    messageport_error_e res;
+    messageport_remote_port_h handle = NULL;
+    gchar remote_app_id[128];
+    gchar result[32];
+    const char *keys[] = { "Type", "Bytes" };
+    int i;
+    bundle *b = bundle_create ();
+
+    bundle_add (b, "Type", "view");
+    bundle_add_byte (b, "Bytes", TEST_BYTES, sizeof (TEST_BYTES));
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_open_remote_port (remote_app_id, PARENT_TEST_VIEW_PORT, FALSE, &handle);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open remote port '%s' at app_id '%s', error: %d", PARENT_TEST_VIEW_PORT, remote_app_id, res);
+
+    res = messageport_remote_port_set_schema (handle, keys, 2);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to set schema, error : %d", res);
+
+    /* the view port reads plain maps, the daemon expands the messages for it */
+    for (i = 0; i < 2; i++) {
+        res = messageport_send_message_by_handle (handle, b);
+        test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message with schema, error : %d", res);
+
+        test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+        test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not get the keys of the schema");
     }
+    bundle_free (b);
+    messageport_close_remote_port (handle);
 
-    return FALSE;
+    return TRUE;
 }
 
 static gboolean
-test_send_bidirectional_message()
+test_send_message_with_shared_schema()
 {
     messageport_error_e res;
-    int local_port_id = 0;
+    messageport_remote_port_h handle = NULL;
     gchar remote_app_id[128];
     gchar result[32];
-    gboolean child_got_message = FALSE;
+    const char *keys[] = { "Type", "Name" };
+    int i;
     bundle *b = bundle_create ();
+
+    bundle_add (b, "Type", "schema");
     bundle_add (b, "Name", "Amarnath");
-    bundle_add (b, "Email", "amarnath.valluri@intel.com");
 
-    child_got_message = FALSE;
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_open_remote_port (remote_app_id, PARENT_TEST_PORT, FALSE, &handle);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open remote port '%s' at app_id '%s', error: %d", PARENT_TEST_PORT, remote_app_id, res);
 
-    /* register local message port for return message */
-    test_assert ((local_port_id = _register_test_port (CHILD_TEST_PORT, FALSE, _on_child_got_message)) > 0,
-        "Fail to register message port");
+    res = messageport_remote_port_set_schema (handle, keys, 2);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to set schema, error : %d", res);
 
-    g_sprintf (remote_app_id, "%d", getppid());
-    res = messageport_send_bidirectional_message (local_port_id, remote_app_id, PARENT_TEST_PORT, b);
+    /* the daemon shares the schema with the parent ahead of the first message only */
+    for (i = 0; i < 2; i++) {
+        res = messageport_send_message_by_handle (handle, b);
+        test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message with schema, error : %d", res);
+
+        test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+        test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not get the keys of the schema");
+    }
     bundle_free (b);
-    test_assert (res == MESSAGEPORT_ERROR_NONE,
-        "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+    messageport_close_remote_port (handle);
 
+    return TRUE;
+}
 
-    test_assert( (read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
-    test_assert( (g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+static gboolean
+test_send_message_with_delta()
+{
+    messageport_error_e res;
+    messageport_remote_port_h handle = NULL;
+    gchar remote_app_id[128];
+    gchar result[32];
+    int i;
+    bundle *b = bundle_create ();
 
-    __test_data = g_new0 (struct AsyncTestData, 1);
-    __test_data->m_loop = g_main_loop_new (NULL, FALSE);
-    g_timeout_add_seconds (5, _update_test_result, NULL);
+    bundle_add (b, "Type", "view");
+    bundle_add_byte (b, "Bytes", TEST_BYTES, sizeof (TEST_BYTES));
+    bundle_add (b, "Extra", "removed from the last message");
 
-    g_main_loop_run (__test_data->m_loop);
-    child_got_message = __test_data->result;
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_open_remote_port (remote_app_id, PARENT_TEST_VIEW_PORT, FALSE, &handle);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open remote port '%s' at app_id '%s', error: %d", PARENT_TEST_VIEW_PORT, remote_app_id, res);
 
-    g_main_loop_unref (__test_data->m_loop);
-    g_free (__test_data);
-    __test_data = NULL;
+    res = messageport_remote_port_set_delta (handle, TRUE);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to enable deltas, error : %d", res);
 
-    test_assert (child_got_message == TRUE, "Child did not recieved reply");
+    /* a key frame, an empty delta, then a delta removing a key */
+    for (i = 0; i < 3; i++) {
+        if (i == 2) bundle_del (b, "Extra");
+
+        res = messageport_send_message_by_handle (handle, b);
+        test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send delta message, error : %d", res);
+
+        test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+        test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not get the whole message back");
+    }
+    bundle_free (b);
+    messageport_close_remote_port (handle);
 
     return TRUE;
 }
 
 static gboolean
-test_send_bidirectional_trusted_message()
+test_send_trusted_message()
 {
     messageport_error_e res;
-    int local_port_id = 0;
     gchar remote_app_id[128];
-    gchar result[32];
-    gboolean child_got_message = FALSE;
     bundle *b = bundle_create ();
     bundle_add (b, "Name", "Amarnath");
     bundle_add (b, "Email", "amarnath.valluri@intel.com");
 
-    child_got_message = FALSE;
-
-    /* register local message port for return message */
-    test_assert ((local_port_id = _register_test_port (CHILD_TEST_TRUSTED_PORT, FALSE, _on_child_got_message)) > 0,
-        "Fail to register message port");
-
     g_sprintf (remote_app_id, "%d", getppid());
-    res = messageport_send_bidirectional_trusted_message (local_port_id, remote_app_id, PARENT_TEST_TRUSTED_PORT, b);
+    res = messageport_send_trusted_message (remote_app_id, PARENT_TEST_TRUSTED_PORT, b);
     bundle_free (b);
-    test_assert (res == MESSAGEPORT_ERROR_NONE,
-        "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_TRUSTED_PORT, remote_app_id, res);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
 
+    gchar result[32];
 
     test_assert( (read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
     test_assert( (g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
 
-    __test_data = g_new0 (struct AsyncTestData, 1);
-    __test_data->m_loop = g_main_loop_new (NULL, FALSE);
-    g_timeout_add_seconds (5, _update_test_result, NULL);
+    return TRUE;
+}
 
-    g_main_loop_run (__test_data->m_loop);
-    child_got_message = __test_data->result;
+static gboolean
+test_send_message_by_handle()
+{
+    messageport_error_e res;
+    messageport_remote_port_h handle = NULL;
+    gchar remote_app_id[128];
+    gchar result[32];
+    int i;
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+    bundle_add (b, "Email", "amarnath.valluri@intel.com");
 
-    g_main_loop_unref (__test_data->m_loop);
-    g_free (__test_data);
-    __test_data = NULL;
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_open_remote_port (remote_app_id, PARENT_TEST_PORT, FALSE, &handle);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open remote port '%s' at app_id '%s', error: %d", PARENT_TEST_PORT, remote_app_id, res);
 
-    test_assert (child_got_message == TRUE, "Child did not recieved reply");
+    for (i = 0; i < 2; i++) {
+        res = messageport_send_message_by_handle (handle, b);
+        test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message by handle, error : %d", res);
+
+        test_assert ((read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+        test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+    }
+    bundle_free (b);
+
+    res = messageport_close_remote_port (handle);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to close remote port handle, error : %d", res);
 
     return TRUE;
 }
 
 static gboolean
-test_get_local_port_name()
+test_send_compressed_message()
 {
-    int local_port_id = 0;
     messageport_error_e res;
-    gchar *port_name = NULL;
+    messageport_remote_port_h handle = NULL;
+    gchar remote_app_id[128];
+    gchar result[32];
+    GString *log = g_string_new (NULL);
+    int i;
+    bundle *b = bundle_create ();
 
-    test_assert ((local_port_id = _register_test_port (CHILD_TEST_TRUSTED_PORT, FALSE, _on_child_got_message)) > 0,
-        "Fail to register test port : error : %d", local_port_id);
-    
-    res = messageport_get_local_port_name (local_port_id, &port_name);
-    test_assert (res == MESSAGEPORT_ERROR_NONE, "Failed to get message port name, error: %d", res);
+    for (i = 0; i < TEST_LOG_LINES; i++) g_string_append (log, TEST_LOG_LINE);
+    bundle_add (b, "Log", log->str);
+    g_string_free (log, TRUE);
 
-    test_assert (g_strcmp0 (port_name, CHILD_TEST_TRUSTED_PORT) == 0, "Got wrong port name");
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_open_remote_port (remote_app_id, PARENT_TEST_PORT, FALSE, &handle);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open remote port '%s' at app_id '%s', error: %d", PARENT_TEST_PORT, remote_app_id, res);
+
+    res = messageport_remote_port_set_compression (handle, 1024);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to enable compression, error : %d", res);
+
+    res = messageport_send_message_by_handle (handle, b);
+    bundle_free (b);
+    messageport_close_remote_port (handle);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send compressed message, error : %d", res);
+
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the decompressed message");
 
     return TRUE;
 }
 
 static gboolean
-test_check_trusted_local_port ()
+_update_test_result (gpointer data)
 {
-    int local_port_id = 0;
-    messageport_error_e res;
-    gboolean is_trusted;
+    if (__test_data) {
+        __test_data->result = FALSE;
+        g_main_loop_quit (__test_data->m_loop);
+    }
 
-    test_assert ((local_port_id = _register_test_port (CHILD_TEST_PORT, FALSE, _on_child_got_message)) > 0,
-        "Fail to register test port : error : %d", local_port_id);
-    
+    return FALSE;
+}
+
+static void
+_on_watched_port_changed (const char *remote_app_id, const char *remote_port, bool trusted, bool available, void *userdata)
+{
+    gboolean expected = GPOINTER_TO_INT (userdata);
+
+    g_debug ("CHILD: Remote port '%s' at '%s' is %s", remote_port, remote_app_id, available ? "available" : "gone");
+
+    if (__test_data && available == expected) {
+        __test_data->result = TRUE;
+        g_main_loop_quit (__test_data->m_loop);
+    }
+}
+
+static gboolean
+_wait_for_result ()
+{
+    guint timeout_id;
+    gboolean result;
+
+    __test_data = g_new0 (struct AsyncTestData, 1);
+    __test_data->m_loop = g_main_loop_new (NULL, FALSE);
+    timeout_id = g_timeout_add_seconds (5, _update_test_result, NULL);
+
+    g_main_loop_run (__test_data->m_loop);
+    result = __test_data->result;
+    g_source_remove (timeout_id);
+
+    g_main_loop_unref (__test_data->m_loop);
+    g_free (__test_data);
+    __test_data = NULL;
+
+    return result;
+}
+
+static void
+_on_message_sent (messageport_error_e result, void *userdata)
+{
+    int *pending = (int *)userdata;
+
+    if (result != MESSAGEPORT_ERROR_NONE) g_warning ("CHILD: Async send failed : %d", result);
+    else (*pending)--;
+
+    if (__test_data && *pending == 0) {
+        __test_data->result = TRUE;
+        g_main_loop_quit (__test_data->m_loop);
+    }
+}
+
+static gboolean
+test_send_message_async()
+{
+    messageport_error_e res;
+    gchar remote_app_id[128];
+    gchar result[32];
+    int i, pending = 3;
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+    bundle_add (b, "Email", "amarnath.valluri@intel.com");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    for (i = 0; i < 3; i++) {
+        res = messageport_send_message_async (remote_app_id, PARENT_TEST_PORT, FALSE, b, _on_message_sent, &pending);
+        test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+    }
+    bundle_free (b);
+
+    test_assert (_wait_for_result () == TRUE, "Did not get all the send results");
+    test_assert (pending == 0, "%d messages were not sent", pending);
+
+    /* acks might be queued up on the pipe, read them one by one */
+    for (i = 0; i < 3; i++) {
+        test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+        test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+    }
+
+    return TRUE;
+}
+
+static gboolean
+test_send_message_noreply()
+{
+    messageport_error_e res;
+    gchar remote_app_id[128];
+    gchar result[32];
+    unsigned int n_dropped = 0;
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_send_message_noreply (remote_app_id, PARENT_TEST_PORT, FALSE, b);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+
+    test_assert ((read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+
+    /* failures are counted, not reported */
+    res = messageport_send_message_noreply (remote_app_id, "no_such_port", FALSE, b);
+    bundle_free (b);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message, error : %d", res);
+
+    res = messageport_get_dropped_message_count (&n_dropped);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to get dropped message count, error : %d", res);
+    test_assert (n_dropped == 1, "Unexpected dropped message count : %u", n_dropped);
+
+    return TRUE;
+}
+
+static gboolean
+test_send_messages()
+{
+    messageport_error_e res;
+    gchar remote_app_id[128];
+    gchar result[32];
+    bundle *messages[3];
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        gchar *index = g_strdup_printf ("%d", i);
+        messages[i] = bundle_create ();
+        bundle_add (messages[i], "Index", index);
+        g_free (index);
+    }
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_send_messages (remote_app_id, PARENT_TEST_PORT, FALSE, messages, 3);
+    for (i = 0; i < 3; i++) bundle_free (messages[i]);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send messages to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+
+    /* parent acknowledges each message of the batch */
+    for (i = 0; i < 3; i++) {
+        test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+        test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+    }
+
+    return TRUE;
+}
+
+static gboolean
+test_send_message_multi()
+{
+    messageport_error_e res;
+    messageport_error_e results[2];
+    messageport_target_s targets[2];
+    gchar remote_app_id[128];
+    gchar result[32];
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    targets[0].remote_app_id = remote_app_id;
+    targets[0].remote_port = PARENT_TEST_PORT;
+    targets[0].trusted = FALSE;
+    targets[1].remote_app_id = remote_app_id;
+    targets[1].remote_port = "no_such_port";
+    targets[1].trusted = FALSE;
+
+    res = messageport_send_message_multi (targets, 2, b, results);
+    bundle_free (b);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send multicast message, error : %d", res);
+    test_assert (results[0] == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s', error : %d", PARENT_TEST_PORT, results[0]);
+    test_assert (results[1] == MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND, "Unexpected result for missing port : %d", results[1]);
+
+    test_assert ((read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+
+    return TRUE;
+}
+
+static gboolean
+test_send_large_message()
+{
+    messageport_error_e res;
+    gchar remote_app_id[128];
+    gchar result[32];
+    int pending = 1;
+    gchar *blob = g_strnfill (256 * 1024, 'x'); /* above the memfd threshold */
+    bundle *b = bundle_create ();
+    bundle_add (b, "Blob", blob);
+    g_free (blob);
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_send_message (remote_app_id, PARENT_TEST_PORT, b);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send large message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+
+    res = messageport_send_message_async (remote_app_id, PARENT_TEST_PORT, FALSE, b, _on_message_sent, &pending);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send large message asynchronously, error : %d", res);
+    test_assert (_wait_for_result () == TRUE && pending == 0, "Did not get the send result");
+
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+
+    res = messageport_send_message_noreply (remote_app_id, PARENT_TEST_PORT, FALSE, b);
+    bundle_free (b);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send large message without reply, error : %d", res);
+
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+
+    return TRUE;
+}
+
+/*
+ * A connection to the daemon that never negotiates features, like the ones of older libraries.
+ */
+static GDBusConnection *
+_legacy_connection_new ()
+{
+    GDBusConnection *connection = NULL;
+    gchar *bus_address = NULL;
+
+#ifdef USE_SESSION_BUS
+    GDBusConnection *session_bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+    if (session_bus) {
+        GVariant *reply = g_dbus_connection_call_sync (session_bus, "org.tizen.messageport", "/",
+                "org.tizen.messageport.Server", "getBusAddress", NULL, G_VARIANT_TYPE ("(s)"),
+                G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+        if (reply) {
+            g_variant_get (reply, "(s)", &bus_address);
+            g_variant_unref (reply);
+        }
+        g_object_unref (session_bus);
+    }
+#endif /* USE_SESSION_BUS */
+    if (!bus_address && g_getenv ("MESSAGEPORT_BUS_ADDRESS"))
+        bus_address = g_strdup (g_getenv ("MESSAGEPORT_BUS_ADDRESS"));
+#ifdef MESSAGEPORT_BUS_ADDRESS
+    if (!bus_address) bus_address = g_strdup_printf (MESSAGEPORT_BUS_ADDRESS);
+#endif
+    if (!bus_address)
+        bus_address = g_strdup_printf ("unix:path=%s/.message-port", g_get_user_runtime_dir());
+
+    connection = g_dbus_connection_new_for_address_sync (bus_address,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, NULL, NULL, NULL);
+    g_free (bus_address);
+
+    return connection;
+}
+
+/*
+ * Registers port_name on a legacy connection, cb gets the signals of the port.
+ * Returns the signal subscription id, or 0 on failure.
+ */
+static guint
+_legacy_port_register (GDBusConnection *connection, const gchar *port_name, GDBusSignalCallback cb, gpointer userdata)
+{
+    GVariant *reply = NULL;
+    gchar *object_path = NULL;
+    guint subscription_id;
+
+    reply = g_dbus_connection_call_sync (connection, NULL, "/", "org.tizen.messageport.Manager",
+            "registerService", g_variant_new ("(sb)", port_name, FALSE), G_VARIANT_TYPE ("(o)"),
+            G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    if (!reply) return 0;
+    g_variant_get (reply, "(o)", &object_path);
+    g_variant_unref (reply);
+
+    subscription_id = g_dbus_connection_signal_subscribe (connection, NULL, "org.tizen.messageport.Service",
+            NULL, object_path, NULL, G_DBUS_SIGNAL_FLAGS_NONE, cb, userdata, NULL);
+    g_free (object_path);
+
+    return subscription_id;
+}
+
+static void
+_on_legacy_port_signal (GDBusConnection *connection, const gchar *sender, const gchar *object_path,
+        const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer userdata)
+{
+    GVariant *data = NULL;
+    const gchar *blob = NULL;
+
+    if (!__test_data) return;
+
+    g_debug ("CHILD: Legacy port got '%s'", signal_name);
+
+    /* older libraries do not know onLargeMessage */
+    if (g_strcmp0 (signal_name, "onMessage") == 0) {
+        data = g_variant_get_child_value (parameters, 0);
+        __test_data->result = g_variant_lookup (data, "Blob", "&s", &blob) && strlen (blob) == 256 * 1024;
+        g_variant_unref (data);
+    }
+    else __test_data->result = FALSE;
+
+    g_main_loop_quit (__test_data->m_loop);
+}
+
+static gboolean
+test_send_large_message_to_legacy_port()
+{
+    messageport_error_e res;
+    GDBusConnection *connection = _legacy_connection_new ();
+    gchar app_id[128];
+    gboolean got_message = FALSE;
+    guint subscription_id;
+    gchar *blob = g_strnfill (256 * 1024, 'x'); /* above the memfd threshold */
+    bundle *b = bundle_create ();
+    bundle_add (b, "Blob", blob);
+    g_free (blob);
+
+    test_assert (connection != NULL, "Failed to connect to the messageport daemon");
+
+    subscription_id = _legacy_port_register (connection, CHILD_TEST_LEGACY_PORT, _on_legacy_port_signal, NULL);
+    test_assert (subscription_id > 0, "Fail to register message port '%s'", CHILD_TEST_LEGACY_PORT);
+
+    g_sprintf (app_id, "%d", getpid());
+    res = messageport_send_message (app_id, CHILD_TEST_LEGACY_PORT, b);
+    bundle_free (b);
+
+    if (res == MESSAGEPORT_ERROR_NONE) got_message = _wait_for_result ();
+
+    g_dbus_connection_signal_unsubscribe (connection, subscription_id);
+    g_dbus_connection_close_sync (connection, NULL, NULL);
+    g_object_unref (connection);
+
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send large message to port '%s' at app_id : '%s', error : %d", CHILD_TEST_LEGACY_PORT, app_id, res);
+    test_assert (got_message == TRUE, "Port without large message support did not receive the message inline");
+
+    return TRUE;
+}
+
+static void
+_on_legacy_batch_port_signal (GDBusConnection *connection, const gchar *sender, const gchar *object_path,
+        const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer userdata)
+{
+    int *n_messages = (int *)userdata;
+
+    if (!__test_data) return;
+
+    g_debug ("CHILD: Legacy port got '%s'", signal_name);
+
+    /* older libraries do not know onMessages */
+    if (g_strcmp0 (signal_name, "onMessage") != 0) {
+        __test_data->result = FALSE;
+        g_main_loop_quit (__test_data->m_loop);
+    }
+    else if (++(*n_messages) == 3) {
+        __test_data->result = TRUE;
+        g_main_loop_quit (__test_data->m_loop);
+    }
+}
+
+static gboolean
+test_send_messages_to_legacy_port()
+{
+    messageport_error_e res;
+    GDBusConnection *connection = _legacy_connection_new ();
+    gchar app_id[128];
+    gboolean got_messages = FALSE;
+    guint subscription_id;
+    bundle *messages[3];
+    int i, n_messages = 0;
+
+    test_assert (connection != NULL, "Failed to connect to the messageport daemon");
+
+    subscription_id = _legacy_port_register (connection, CHILD_TEST_LEGACY_BATCH_PORT, _on_legacy_batch_port_signal, &n_messages);
+    test_assert (subscription_id > 0, "Fail to register message port '%s'", CHILD_TEST_LEGACY_BATCH_PORT);
+
+    for (i = 0; i < 3; i++) {
+        messages[i] = bundle_create ();
+        bundle_add (messages[i], "Name", "Amarnath");
+    }
+
+    g_sprintf (app_id, "%d", getpid());
+    res = messageport_send_messages (app_id, CHILD_TEST_LEGACY_BATCH_PORT, FALSE, messages, 3);
+    for (i = 0; i < 3; i++) bundle_free (messages[i]);
+
+    if (res == MESSAGEPORT_ERROR_NONE) got_messages = _wait_for_result ();
+
+    g_dbus_connection_signal_unsubscribe (connection, subscription_id);
+    g_dbus_connection_close_sync (connection, NULL, NULL);
+    g_object_unref (connection);
+
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send messages to port '%s' at app_id : '%s', error : %d", CHILD_TEST_LEGACY_BATCH_PORT, app_id, res);
+    test_assert (got_messages == TRUE, "Port without batch support did not receive the messages one by one");
+
+    return TRUE;
+}
+
+static gboolean
+test_send_message_with_fds()
+{
+    messageport_error_e res;
+    gchar remote_app_id[128];
+    gchar result[32];
+    int fds[2];
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+
+    test_assert (pipe (fds) == 0, "Failed to open pipe");
+    test_assert (write (fds[1], "OK", strlen("OK") + 1) == 3, "Failed to write to pipe");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_send_message_with_fds (remote_app_id, PARENT_TEST_FDS_PORT, FALSE, b, &fds[0], 1);
+    bundle_free (b);
+    /* the library duplicates the descriptors */
+    close (fds[0]);
+    close (fds[1]);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_FDS_PORT, remote_app_id, res);
+
+    test_assert ((read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not read from the passed descriptor");
+
+    return TRUE;
+}
+
+/*
+ * Only onMessage is expected, carrying "Name" as a plain value.
+ */
+static void
+_on_legacy_named_port_signal (GDBusConnection *connection, const gchar *sender, const gchar *object_path,
+        const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer userdata)
+{
+    GVariant *data = NULL;
+    const gchar *name = NULL;
+
+    if (!__test_data) return;
+
+    g_debug ("CHILD: Legacy port got '%s'", signal_name);
+
+    if (g_strcmp0 (signal_name, "onMessage") == 0) {
+        data = g_variant_get_child_value (parameters, 0);
+        __test_data->result = g_variant_lookup (data, "Name", "&s", &name) && g_strcmp0 (name, "Amarnath") == 0;
+        g_variant_unref (data);
+    }
+    else __test_data->result = FALSE;
+
+    g_main_loop_quit (__test_data->m_loop);
+}
+
+static gboolean
+test_send_message_with_fds_to_legacy_port()
+{
+    messageport_error_e res;
+    GDBusConnection *connection = _legacy_connection_new ();
+    gchar app_id[128];
+    gboolean got_message = FALSE;
+    guint subscription_id;
+    int fds[2];
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+
+    test_assert (connection != NULL, "Failed to connect to the messageport daemon");
+    test_assert (pipe (fds) == 0, "Failed to open pipe");
+
+    subscription_id = _legacy_port_register (connection, CHILD_TEST_LEGACY_FDS_PORT, _on_legacy_named_port_signal, NULL);
+    test_assert (subscription_id > 0, "Fail to register message port '%s'", CHILD_TEST_LEGACY_FDS_PORT);
+
+    g_sprintf (app_id, "%d", getpid());
+    res = messageport_send_message_with_fds (app_id, CHILD_TEST_LEGACY_FDS_PORT, FALSE, b, &fds[0], 1);
+    bundle_free (b);
+    close (fds[0]);
+    close (fds[1]);
+
+    if (res == MESSAGEPORT_ERROR_NONE) got_message = _wait_for_result ();
+
+    g_dbus_connection_signal_unsubscribe (connection, subscription_id);
+    g_dbus_connection_close_sync (connection, NULL, NULL);
+    g_object_unref (connection);
+
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", CHILD_TEST_LEGACY_FDS_PORT, app_id, res);
+    test_assert (got_message == TRUE, "Port without descriptor support did not receive the message alone");
+
+    return TRUE;
+}
+
+/*
+ * The daemon fails a delta the receiver has no base for, so that the
+ * sender answers with a key frame instead of the receiver dropping it.
+ */
+static gboolean
+test_send_delta_without_base()
+{
+    GDBusConnection *connection = _legacy_connection_new ();
+    GVariantBuilder builder;
+    GVariant *reply = NULL;
+    GError *error = NULL;
+    gchar *error_name = NULL;
+    gchar remote_app_id[128];
+    guint service_id = 0;
+    gboolean base_not_found;
+
+    test_assert (connection != NULL, "Failed to connect to the messageport daemon");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    reply = g_dbus_connection_call_sync (connection, NULL, "/", "org.tizen.messageport.Manager",
+            "checkForRemoteService", g_variant_new ("(ssb)", remote_app_id, PARENT_TEST_PORT, FALSE),
+            G_VARIANT_TYPE ("(u)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    test_assert (reply != NULL, "Fail to find remote port '%s' at app_id '%s'", PARENT_TEST_PORT, remote_app_id);
+    g_variant_get (reply, "(u)", &service_id);
+    g_variant_unref (reply);
+
+    /* delta 2 to message 1 of a stream the parent never got a key frame of */
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", "__MESSAGEPORT_DELTA_BUNDLE__",
+            g_variant_new ("(tuu@a{sv}@as)", G_GUINT64_CONSTANT (1), 2, 1,
+                    g_variant_new ("a{sv}", NULL), g_variant_new_strv (NULL, 0)));
+    reply = g_dbus_connection_call_sync (connection, NULL, "/", "org.tizen.messageport.Manager",
+            "sendMessage", g_variant_new ("(ua{sv})", service_id, &builder), NULL,
+            G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+
+    g_dbus_connection_close_sync (connection, NULL, NULL);
+    g_object_unref (connection);
+
+    if (reply) g_variant_unref (reply);
+    if (error) {
+        error_name = g_dbus_error_get_remote_error (error);
+        g_error_free (error);
+    }
+    base_not_found = g_strcmp0 (error_name, "org.tizen.MessagePort.Error.DeltaBaseNotFound") == 0;
+    g_free (error_name);
+
+    test_assert (base_not_found, "Delta without its base was not refused to the sender");
+
+    return TRUE;
+}
+
+/*
+ * A port that negotiated encoded bundles but asked for plain maps,
+ * as the library does for view and typed handlers.
+ */
+static gboolean
+test_send_message_to_plain_maps_port()
+{
+    messageport_error_e res;
+    GDBusConnection *connection = _legacy_connection_new ();
+    const gchar *features[] = { "encoded-bundle", NULL };
+    GVariant *reply = NULL;
+    gchar *object_path = NULL;
+    gchar app_id[128];
+    gboolean got_message = FALSE;
+    guint subscription_id;
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+
+    test_assert (connection != NULL, "Failed to connect to the messageport daemon");
+
+    reply = g_dbus_connection_call_sync (connection, NULL, "/", "org.tizen.messageport.Manager",
+            "negotiateFeatures", g_variant_new ("(^as)", features), G_VARIANT_TYPE ("(as)"),
+            G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    test_assert (reply != NULL, "Failed to negotiate features");
+    g_variant_unref (reply);
+
+    reply = g_dbus_connection_call_sync (connection, NULL, "/", "org.tizen.messageport.Manager",
+            "registerService", g_variant_new ("(sb)", CHILD_TEST_PLAIN_MAPS_PORT, FALSE), G_VARIANT_TYPE ("(o)"),
+            G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    test_assert (reply != NULL, "Fail to register message port '%s'", CHILD_TEST_PLAIN_MAPS_PORT);
+    g_variant_get (reply, "(o)", &object_path);
+    g_variant_unref (reply);
+
+    reply = g_dbus_connection_call_sync (connection, NULL, object_path, "org.tizen.messageport.Service",
+            "setPlainMaps", g_variant_new ("(b)", TRUE), NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    test_assert (reply != NULL, "Failed to ask for plain maps");
+    g_variant_unref (reply);
+
+    subscription_id = g_dbus_connection_signal_subscribe (connection, NULL, "org.tizen.messageport.Service",
+            NULL, object_path, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _on_legacy_named_port_signal, NULL, NULL);
+    g_free (object_path);
+
+    g_sprintf (app_id, "%d", getpid());
+    res = messageport_send_message (app_id, CHILD_TEST_PLAIN_MAPS_PORT, b);
+    bundle_free (b);
+
+    if (res == MESSAGEPORT_ERROR_NONE) got_message = _wait_for_result ();
+
+    g_dbus_connection_signal_unsubscribe (connection, subscription_id);
+    g_dbus_connection_close_sync (connection, NULL, NULL);
+    g_object_unref (connection);
+
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message to port '%s' at app_id : '%s', error : %d", CHILD_TEST_PLAIN_MAPS_PORT, app_id, res);
+    test_assert (got_message == TRUE, "Port asking for plain maps got an encoded bundle");
+
+    return TRUE;
+}
+
+static gboolean
+test_channel()
+{
+    messageport_error_e res;
+    messageport_channel_h channel = NULL;
+    gchar remote_app_id[128];
+    gchar result[32];
+    int i;
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_open_channel (remote_app_id, "no_such_port", FALSE, &channel);
+    test_assert (res == MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND, "Unexpected result for missing port : %d", res);
+
+    res = messageport_open_channel (remote_app_id, PARENT_TEST_PORT, FALSE, &channel);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open channel to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+
+    for (i = 0; i < 3; i++) {
+        res = messageport_channel_send (channel, b);
+        test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message on channel, error : %d", res);
+    }
+    bundle_free (b);
+
+    /* parent acknowledges each message on the channel */
+    for (i = 0; i < 3; i++) {
+        test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+        test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+    }
+
+    res = messageport_close_channel (channel);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to close channel, error : %d", res);
+
+    return TRUE;
+}
+
+/*
+ * Unregistering the receiving port revokes the channel. The daemon tells
+ * the sender over the bus, the ring shared with the receiver has no say.
+ */
+static gboolean
+test_channel_revoked()
+{
+    messageport_error_e res;
+    messageport_channel_h channel = NULL;
+    gchar app_id[128];
+    gint64 deadline;
+    int port_id = _register_test_port (CHILD_TEST_CHANNEL_PORT, FALSE, _on_child_got_message);
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+
+    test_assert (port_id > 0, "Failed to register port '%s', error : %d", CHILD_TEST_CHANNEL_PORT, port_id);
+
+    g_sprintf (app_id, "%d", getpid());
+    res = messageport_open_channel (app_id, CHILD_TEST_CHANNEL_PORT, FALSE, &channel);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open channel to port '%s' at app_id : '%s', error : %d", CHILD_TEST_CHANNEL_PORT, app_id, res);
+
+    test_assert (messageport_unregister_local_port (port_id) == MESSAGEPORT_ERROR_NONE, "Fail to unregister message port");
+
+    deadline = g_get_monotonic_time () + 5 * G_USEC_PER_SEC;
+    while ((res = messageport_channel_send (channel, b)) == MESSAGEPORT_ERROR_NONE && g_get_monotonic_time () < deadline) {
+        g_main_context_iteration (NULL, FALSE);
+        g_usleep (10000);
+    }
+    bundle_free (b);
+    messageport_close_channel (channel);
+
+    test_assert (res == MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND, "Unexpected result on revoked channel : %d", res);
+
+    return TRUE;
+}
+
+static gboolean
+test_peer_channel()
+{
+    messageport_error_e res;
+    messageport_channel_h channel = NULL;
+    gchar remote_app_id[128];
+    gchar result[32];
+    int i;
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_open_peer_channel (remote_app_id, "no_such_port", FALSE, &channel);
+    test_assert (res == MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND, "Unexpected result for missing port : %d", res);
+
+    res = messageport_open_peer_channel (remote_app_id, PARENT_TEST_PORT, FALSE, &channel);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open peer channel to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+
+    for (i = 0; i < 3; i++) {
+        res = messageport_channel_send (channel, b);
+        test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to send message on peer channel, error : %d", res);
+    }
+    bundle_free (b);
+
+    for (i = 0; i < 3; i++) {
+        test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the message");
+        test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+    }
+
+    res = messageport_close_channel (channel);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to close peer channel, error : %d", res);
+
+    return TRUE;
+}
+
+static void
+_on_stream_writable (messageport_stream_h stream, void *userdata)
+{
+    if (__test_data) {
+        __test_data->result = TRUE;
+        g_main_loop_quit (__test_data->m_loop);
+    }
+}
+
+/*
+ * Writes and completes the stream, running the main loop whenever the
+ * receiver did not catch up.
+ */
+static messageport_error_e
+_write_stream (messageport_stream_h stream, const guchar *data, gsize size)
+{
+    messageport_error_e res;
+    gsize offset = 0;
+
+    messageport_stream_set_writable_cb (stream, _on_stream_writable, NULL);
+
+    /* odd sized writes, more than the socket buffers hold */
+    while (offset < size) {
+        int written = messageport_stream_write (stream, data + offset, MIN (100000, size - offset));
+
+        if (written == MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE) {
+            if (!_wait_for_result ()) return MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE;
+            continue;
+        }
+        if (written < 0) return (messageport_error_e)written;
+        offset += written;
+    }
+
+    while ((res = messageport_close_stream (stream)) == MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE)
+        if (!_wait_for_result ()) return res;
+
+    return res;
+}
+
+static gboolean
+test_stream()
+{
+    messageport_error_e res;
+    messageport_stream_h stream = NULL;
+    gchar remote_app_id[128];
+    gchar result[32];
+    guchar *data = g_malloc (TEST_STREAM_SIZE);
+    gsize i;
+
+    for (i = 0; i < TEST_STREAM_SIZE; i++) data[i] = i % 251;
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_open_stream (remote_app_id, "no_such_port", FALSE, &stream);
+    test_assert (res == MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND, "Unexpected result for missing port : %d", res);
+
+    res = messageport_open_stream (remote_app_id, PARENT_TEST_STREAM_PORT, FALSE, &stream);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open stream to port '%s' at app_id : '%s', error : %d", PARENT_TEST_STREAM_PORT, remote_app_id, res);
+
+    res = _write_stream (stream, data, TEST_STREAM_SIZE);
+    g_free (data);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to write stream, error : %d", res);
+
+    test_assert ((read (__pipe[0], &result, sizeof("OK")) > 0), "Parent did not received the stream");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent did not received the stream");
+
+    return TRUE;
+}
+
+static void
+_on_child_got_stream_chunk (int port_id, int stream_id, const char* remote_app_id, const char* remote_port, bool trusted_remote_port, const void *chunk, unsigned int size, messageport_error_e result, void *userdata)
+{
+    gsize *received = (gsize *)userdata;
+
+    if (chunk) {
+        *received += size;
+        return;
+    }
+
+    g_debug ("CHILD: GOT STREAM %d of %lu bytes, result : %d", stream_id, (gulong)*received, result);
+
+    if (__test_data) {
+        __test_data->result = result == MESSAGEPORT_ERROR_NONE && *received == TEST_STREAM_SIZE;
+        g_main_loop_quit (__test_data->m_loop);
+    }
+}
+
+static gboolean
+test_stream_to_local_port()
+{
+    messageport_error_e res;
+    messageport_stream_h stream = NULL;
+    gchar app_id[128];
+    gsize received = 0;
+    guchar *data = g_malloc0 (TEST_STREAM_SIZE);
+    int port_id = _register_test_port (CHILD_TEST_STREAM_PORT, FALSE, _on_child_got_message);
+
+    test_assert (port_id > 0, "Failed to register port '%s', error : %d", CHILD_TEST_STREAM_PORT, port_id);
+    res = messageport_set_stream_handler (port_id, _on_child_got_stream_chunk, &received);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Failed to set stream handler on port '%s', error : %d", CHILD_TEST_STREAM_PORT, res);
+
+    /* the receiver only reads when the writer gets back to the main loop */
+    g_sprintf (app_id, "%d", getpid());
+    res = messageport_open_stream (app_id, CHILD_TEST_STREAM_PORT, FALSE, &stream);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open stream to port '%s' at app_id : '%s', error : %d", CHILD_TEST_STREAM_PORT, app_id, res);
+
+    res = _write_stream (stream, data, TEST_STREAM_SIZE);
+    g_free (data);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to write stream, error : %d", res);
+
+    test_assert (_wait_for_result (), "Local port did not receive the stream");
+    test_assert (messageport_unregister_local_port (port_id) == MESSAGEPORT_ERROR_NONE, "Fail to unregister message port");
+
+    return TRUE;
+}
+
+static gboolean
+test_stream_refused()
+{
+    int res = MESSAGEPORT_ERROR_NONE;
+    messageport_stream_h stream = NULL;
+    gchar remote_app_id[128];
+    guchar data[1024] = { 0 };
+    int i;
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    /* the port has no stream handler */
+    res = messageport_open_stream (remote_app_id, PARENT_TEST_PORT, FALSE, &stream);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Fail to open stream to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+
+    /* the first chunks might be queued before the receiver closes its end */
+    for (i = 0; i < 1000 && (res >= 0 || res == MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE); i++) {
+        res = messageport_stream_write (stream, data, sizeof (data));
+        if (res >= 0 || res == MESSAGEPORT_ERROR_RESOURCE_UNAVAILABLE) g_usleep (1000);
+    }
+    messageport_abort_stream (stream);
+
+    test_assert (res == MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND, "Unexpected result for refused stream : %d", res);
+
+    return TRUE;
+}
+
+static gboolean
+test_watch_remote_port()
+{
+    int watch_id, local_port_id;
+    gchar app_id[128];
+
+    g_sprintf (app_id, "%d", getppid());
+    watch_id = messageport_watch_remote_port (app_id, PARENT_TEST_PORT, FALSE, _on_watched_port_changed, GINT_TO_POINTER (TRUE));
+    test_assert (watch_id > 0, "Fail to watch remote port '%s' at app_id '%s', error : %d", PARENT_TEST_PORT, app_id, watch_id);
+    test_assert (_wait_for_result () == TRUE, "Did not get the state of the registered port");
+    test_assert (messageport_unwatch_remote_port (watch_id) == MESSAGEPORT_ERROR_NONE, "Fail to remove watch");
+
+    /* watch own port, that comes and goes */
+    g_sprintf (app_id, "%d", getpid());
+    watch_id = messageport_watch_remote_port (app_id, CHILD_TEST_WATCH_PORT, FALSE, _on_watched_port_changed, GINT_TO_POINTER (FALSE));
+    test_assert (watch_id > 0, "Fail to watch remote port '%s' at app_id '%s', error : %d", CHILD_TEST_WATCH_PORT, app_id, watch_id);
+    test_assert (_wait_for_result () == TRUE, "Did not get the state of the unregistered port");
+    test_assert (messageport_unwatch_remote_port (watch_id) == MESSAGEPORT_ERROR_NONE, "Fail to remove watch");
+
+    watch_id = messageport_watch_remote_port (app_id, CHILD_TEST_WATCH_PORT, FALSE, _on_watched_port_changed, GINT_TO_POINTER (TRUE));
+    test_assert (watch_id > 0, "Fail to watch remote port '%s', error : %d", CHILD_TEST_WATCH_PORT, watch_id);
+    local_port_id = _register_test_port (CHILD_TEST_WATCH_PORT, FALSE, _on_child_got_message);
+    test_assert (local_port_id > 0, "Fail to register message port");
+    test_assert (_wait_for_result () == TRUE, "Did not get notified on port registration");
+    test_assert (messageport_unwatch_remote_port (watch_id) == MESSAGEPORT_ERROR_NONE, "Fail to remove watch");
+
+    watch_id = messageport_watch_remote_port (app_id, CHILD_TEST_WATCH_PORT, FALSE, _on_watched_port_changed, GINT_TO_POINTER (FALSE));
+    test_assert (watch_id > 0, "Fail to watch remote port '%s', error : %d", CHILD_TEST_WATCH_PORT, watch_id);
+    test_assert (messageport_unregister_local_port (local_port_id) == MESSAGEPORT_ERROR_NONE, "Fail to unregister message port");
+    test_assert (_wait_for_result () == TRUE, "Did not get notified on port unregistration");
+    test_assert (messageport_unwatch_remote_port (watch_id) == MESSAGEPORT_ERROR_NONE, "Fail to remove watch");
+
+    return TRUE;
+}
+
+static gboolean
+test_send_bidirectional_message()
+{
+    messageport_error_e res;
+    int local_port_id = 0;
+    gchar remote_app_id[128];
+    gchar result[32];
+    gboolean child_got_message = FALSE;
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+    bundle_add (b, "Email", "amarnath.valluri@intel.com");
+
+    child_got_message = FALSE;
+
+    /* register local message port for return message */
+    test_assert ((local_port_id = _register_test_port (CHILD_TEST_PORT, FALSE, _on_child_got_message)) > 0,
+        "Fail to register message port");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_send_bidirectional_message (local_port_id, remote_app_id, PARENT_TEST_PORT, b);
+    bundle_free (b);
+    test_assert (res == MESSAGEPORT_ERROR_NONE,
+        "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_PORT, remote_app_id, res);
+
+
+    test_assert( (read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+    test_assert( (g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+
+    __test_data = g_new0 (struct AsyncTestData, 1);
+    __test_data->m_loop = g_main_loop_new (NULL, FALSE);
+    g_timeout_add_seconds (5, _update_test_result, NULL);
+
+    g_main_loop_run (__test_data->m_loop);
+    child_got_message = __test_data->result;
+
+    g_main_loop_unref (__test_data->m_loop);
+    g_free (__test_data);
+    __test_data = NULL;
+
+    test_assert (child_got_message == TRUE, "Child did not recieved reply");
+
+    return TRUE;
+}
+
+static gboolean
+test_send_bidirectional_trusted_message()
+{
+    messageport_error_e res;
+    int local_port_id = 0;
+    gchar remote_app_id[128];
+    gchar result[32];
+    gboolean child_got_message = FALSE;
+    bundle *b = bundle_create ();
+    bundle_add (b, "Name", "Amarnath");
+    bundle_add (b, "Email", "amarnath.valluri@intel.com");
+
+    child_got_message = FALSE;
+
+    /* register local message port for return message */
+    test_assert ((local_port_id = _register_test_port (CHILD_TEST_TRUSTED_PORT, FALSE, _on_child_got_message)) > 0,
+        "Fail to register message port");
+
+    g_sprintf (remote_app_id, "%d", getppid());
+    res = messageport_send_bidirectional_trusted_message (local_port_id, remote_app_id, PARENT_TEST_TRUSTED_PORT, b);
+    bundle_free (b);
+    test_assert (res == MESSAGEPORT_ERROR_NONE,
+        "Fail to send message to port '%s' at app_id : '%s', error : %d", PARENT_TEST_TRUSTED_PORT, remote_app_id, res);
+
+
+    test_assert( (read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+    test_assert( (g_strcmp0 (result, "OK") == 0), "Parent did not received the message");
+
+    __test_data = g_new0 (struct AsyncTestData, 1);
+    __test_data->m_loop = g_main_loop_new (NULL, FALSE);
+    g_timeout_add_seconds (5, _update_test_result, NULL);
+
+    g_main_loop_run (__test_data->m_loop);
+    child_got_message = __test_data->result;
+
+    g_main_loop_unref (__test_data->m_loop);
+    g_free (__test_data);
+    __test_data = NULL;
+
+    test_assert (child_got_message == TRUE, "Child did not recieved reply");
+
+    return TRUE;
+}
+
+static gboolean
+test_get_local_port_name()
+{
+    int local_port_id = 0;
+    messageport_error_e res;
+    gchar *port_name = NULL;
+
+    test_assert ((local_port_id = _register_test_port (CHILD_TEST_TRUSTED_PORT, FALSE, _on_child_got_message)) > 0,
+        "Fail to register test port : error : %d", local_port_id);
+    
+    res = messageport_get_local_port_name (local_port_id, &port_name);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Failed to get message port name, error: %d", res);
+
+    test_assert (g_strcmp0 (port_name, CHILD_TEST_TRUSTED_PORT) == 0, "Got wrong port name");
+
+    return TRUE;
+}
+
+static gboolean
+test_check_trusted_local_port ()
+{
+    int local_port_id = 0;
+    messageport_error_e res;
+    gboolean is_trusted;
+
+    test_assert ((local_port_id = _register_test_port (CHILD_TEST_PORT, FALSE, _on_child_got_message)) > 0,
+        "Fail to register test port : error : %d", local_port_id);
+    
     res = messageport_check_trusted_local_port (local_port_id, &is_trusted);
     test_assert (res == MESSAGEPORT_ERROR_NONE, "Failed to get message port name, error: %d", res);
     test_assert (is_trusted == FALSE, "Go FLSE for trusted port");
@@ -388,6 +1737,33 @@ test_check_trusted_local_port ()
     return TRUE;
 }
 
+static gboolean
+test_unregister_local_port ()
+{
+    int port_id = 0;
+    int trusted_port_id = 0;
+    messageport_error_e res;
+
+    test_assert ((port_id = _register_test_port (PARENT_TEST_UNREGISTER_PORT, FALSE, _on_parent_got_message)) > 0,
+        "Fail to register test port : error : %d", port_id);
+    test_assert ((trusted_port_id = _register_test_port (PARENT_TEST_UNREGISTER_PORT, TRUE, _on_parent_got_message)) > 0,
+        "Fail to register trusted test port : error : %d", trusted_port_id);
+
+    res = messageport_unregister_trusted_local_port (port_id);
+    test_assert (res == MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND,
+        "Unregistered plain port as trusted, error : %d", res);
+    res = messageport_unregister_local_port (trusted_port_id);
+    test_assert (res == MESSAGEPORT_ERROR_MESSAGEPORT_NOT_FOUND,
+        "Unregistered trusted port as plain, error : %d", res);
+
+    res = messageport_unregister_local_port (port_id);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Failed to unregister port, error : %d", res);
+    res = messageport_unregister_trusted_local_port (trusted_port_id);
+    test_assert (res == MESSAGEPORT_ERROR_NONE, "Failed to unregister trusted port, error : %d", res);
+
+    return TRUE;
+}
+
 
 static gboolean
 _on_term (gpointer userdata)
@@ -487,6 +1863,11 @@ int main (int argc, char *argv[])
         TEST_CASE(test_register_trusted_local_port);
         TEST_CASE(test_get_local_port_name);
         TEST_CASE(test_check_trusted_local_port);
+        TEST_CASE(test_unregister_local_port);
+        TEST_CASE(test_register_local_port_with_fds);
+        TEST_CASE(test_set_stream_handler);
+        TEST_CASE(test_register_local_port_with_view);
+        TEST_CASE(test_register_local_port_typed);
 
         g_unix_signal_add (SIGTERM, _on_term, m_loop);
 
@@ -501,6 +1882,33 @@ int main (int argc, char *argv[])
         TEST_CASE(test_check_remote_port);
         TEST_CASE(test_check_trusted_remote_port);
         TEST_CASE(test_send_message);
+        TEST_CASE(test_send_message_with_typed_values);
+        TEST_CASE(test_send_message_to_view);
+        TEST_CASE(test_send_typed_message);
+        TEST_CASE(test_send_generated_message);
+        TEST_CASE(test_send_message_with_schema);
+        TEST_CASE(test_send_message_with_shared_schema);
+        TEST_CASE(test_send_message_with_delta);
+        TEST_CASE(test_send_delta_without_base);
+        TEST_CASE(test_send_message_by_handle);
+        TEST_CASE(test_send_compressed_message);
+        TEST_CASE(test_watch_remote_port);
+        TEST_CASE(test_send_message_async);
+        TEST_CASE(test_send_message_noreply);
+        TEST_CASE(test_send_messages);
+        TEST_CASE(test_send_message_multi);
+        TEST_CASE(test_send_large_message);
+        TEST_CASE(test_send_large_message_to_legacy_port);
+        TEST_CASE(test_send_messages_to_legacy_port);
+        TEST_CASE(test_send_message_with_fds);
+        TEST_CASE(test_send_message_with_fds_to_legacy_port);
+        TEST_CASE(test_send_message_to_plain_maps_port);
+        TEST_CASE(test_channel);
+        TEST_CASE(test_channel_revoked);
+        TEST_CASE(test_peer_channel);
+        TEST_CASE(test_stream);
+        TEST_CASE(test_stream_to_local_port);
+        TEST_CASE(test_stream_refused);
         TEST_CASE(test_send_bidirectional_message);
         TEST_CASE(test_send_trusted_message);
         TEST_CASE(test_send_bidirectional_trusted_message);
@@ -25,6 +25,9 @@
 
 #include "config.h"
 #include <message-port.h>
+#ifdef HAVE_CXX20
+#include <message-port-coro.hpp>
+#endif
 #include <bundle.h>       // bundle 
 #include <string>         // std::string
 #include <map>            // std::map
@@ -49,6 +52,10 @@ static pid_t __daemon_pid = 0;
 #define TEST_PARENT_TRUSTED_PORT "test-parent-trusted-port"
 #define TEST_CHILD_PORT  "test-child-port"
 #define TEST_CHILD_TRUSTED_PORT "test-child-trusted-port"
+#define TEST_PARENT_TYPED_PORT "test-parent-typed-port"
+#define TEST_PARENT_VIEW_PORT "test-parent-view-port"
+#define TEST_CHILD_TYPED_PORT "test-child-typed-port"
+#define TEST_CHILD_TAKEN_PORT "test-child-taken-port"
 
 #define TEST_CASE(case) \
     do { \
@@ -471,6 +478,172 @@ test_send_bidirectional_trusted_message()
     return true;
 }
 
+static void
+_writeAck (bool ok)
+{
+    string ack(ok ? "OK" : "FAIL");
+    int len = ack.length () + 1;
+    if (write (__pipe[1], ack.c_str(), len) < len) {
+        cerr << "WRITE to pipe failed";
+    }
+}
+
+static bool
+test_register_binding_ports ()
+{
+    static messageport::LocalPort typedPort (TEST_PARENT_TYPED_PORT, false,
+        [] (const messageport::Sender &sender, messageport::MessageView message) {
+            _writeAck (message.getInt64 ("Count") == 42 &&
+                       message.getString ("Name") == std::string_view ("Amarnath") &&
+                       message.getBool ("Done") == true);
+            /* echo bidirectional messages */
+            if (!sender.port.empty ())
+                messageport_send_typed_message (std::string (sender.appId).c_str (), std::string (sender.port).c_str (),
+                                                sender.trusted, message.get ());
+        });
+    test_assert (typedPort.error () == MESSAGEPORT_ERROR_NONE, "Failed to register typed port : " + toString (typedPort.error ()));
+
+    static messageport::LocalPort viewPort (TEST_PARENT_VIEW_PORT, false,
+        [] (const messageport::Sender &, messageport::BundleView message) {
+            _writeAck (message.getString ("Name") == std::string_view ("Amarnath") &&
+                       !message.getString ("Missing"));
+        });
+    test_assert (viewPort.error () == MESSAGEPORT_ERROR_NONE, "Failed to register view port : " + toString (viewPort.error ()));
+
+    return true;
+}
+
+static bool
+test_send_with_binding ()
+{
+    gchar result[32];
+    messageport::RemotePort typedPort (toString (getppid ()), TEST_PARENT_TYPED_PORT, false);
+    test_assert (typedPort.error () == MESSAGEPORT_ERROR_NONE, "Failed to open typed port : " + toString (typedPort.error ()));
+
+    messageport::Message message;
+    message.setInt64 ("Count", 42);
+    message.setString ("Name", std::string_view ("Amarnath"));
+    message.setBool ("Done", true);
+    messageport::Message moved (std::move (message));
+
+    test_assert (typedPort.send (moved) == MESSAGEPORT_ERROR_NONE, "Fail to send typed message");
+    test_assert ((read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent got wrong message");
+
+    messageport::RemotePort missingPort (toString (getppid ()), "missing_port", false);
+    test_assert (!missingPort && missingPort.send (moved) == missingPort.error (),
+        "Typed send to an unopened port did not fail with the open error");
+
+    messageport::RemotePort viewPort (toString (getppid ()), TEST_PARENT_VIEW_PORT, false);
+    test_assert (viewPort.error () == MESSAGEPORT_ERROR_NONE, "Failed to open view port : " + toString (viewPort.error ()));
+
+    messageport::Bundle b;
+    b.add ("Name", "Amarnath");
+    test_assert (viewPort.send (b) == MESSAGEPORT_ERROR_NONE, "Fail to send message");
+    test_assert ((read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent got wrong message");
+
+    return true;
+}
+
+#ifdef HAVE_CXX20
+struct TestTask {
+    struct promise_type {
+        TestTask get_return_object () { return TestTask (); }
+        std::suspend_never initial_suspend () { return std::suspend_never (); }
+        std::suspend_never final_suspend () noexcept { return std::suspend_never (); }
+        void return_void () { }
+        void unhandled_exception () { std::terminate (); }
+    };
+};
+
+static TestTask
+_sendAndWaitForEcho (AsyncTestData *test_data)
+{
+    messageport::Inbox inbox;
+    messageport::LocalPort port = co_await messageport::registerPortAsync (TEST_CHILD_TYPED_PORT, false, inbox.handler ());
+    bool ok = port.error () == MESSAGEPORT_ERROR_NONE;
+
+    if (ok) {
+        messageport::Message message;
+        message.setInt64 ("Count", 42);
+        message.setString ("Name", "Amarnath");
+        message.setBool ("Done", true);
+
+        std::string parent = toString (getppid ());
+        ok = co_await messageport::sendAsync (port, parent.c_str (), TEST_PARENT_TYPED_PORT, false, message) == MESSAGEPORT_ERROR_NONE;
+    }
+    if (ok) {
+        messageport::Inbox::Received echo = co_await inbox.next ();
+        ok = echo.message.getInt64 ("Count") == 42;
+    }
+
+    test_data->result = ok;
+    g_main_loop_quit (test_data->m_loop);
+}
+
+static bool
+test_send_with_coroutine ()
+{
+    AsyncTestData test_data;
+    test_data.m_loop = g_main_loop_new (NULL, FALSE);
+    test_data.result = false;
+
+    guint timeout_id = g_timeout_add_seconds (5, _update_test_result, &test_data);
+    _sendAndWaitForEcho (&test_data);
+    g_main_loop_run (test_data.m_loop);
+    GSource *timeout = g_main_context_find_source_by_id (NULL, timeout_id);
+    if (timeout) g_source_destroy (timeout);
+    g_main_loop_unref (test_data.m_loop);
+
+    test_assert (test_data.result == true, "Coroutine did not get the echo");
+
+    gchar result[32];
+    test_assert ((read (__pipe[0], &result, sizeof(result)) > 0), "Parent did not received the message");
+    test_assert ((g_strcmp0 (result, "OK") == 0), "Parent got wrong message");
+
+    return true;
+}
+
+static TestTask
+_registerTakenPort (AsyncTestData *test_data)
+{
+    messageport::Inbox inbox;
+    messageport::LocalPort port = co_await messageport::registerPortAsync (TEST_CHILD_TAKEN_PORT, false, inbox.handler ());
+
+    test_data->result = port.error () == MESSAGEPORT_ERROR_INVALID_PARAMETER;
+    g_main_loop_quit (test_data->m_loop);
+}
+
+static bool
+test_register_taken_port_with_coroutine ()
+{
+    AsyncTestData test_data;
+    test_data.m_loop = g_main_loop_new (NULL, FALSE);
+    test_data.result = false;
+
+    messageport::LocalPort owner (TEST_CHILD_TAKEN_PORT, false, [] (const messageport::Sender &, messageport::MessageView) { });
+    test_assert (owner.error () == MESSAGEPORT_ERROR_NONE, "Failed to register port : " + toString (owner.error ()));
+
+    guint timeout_id = g_timeout_add_seconds (5, _update_test_result, &test_data);
+    _registerTakenPort (&test_data);
+    g_main_loop_run (test_data.m_loop);
+    GSource *timeout = g_main_context_find_source_by_id (NULL, timeout_id);
+    if (timeout) g_source_destroy (timeout);
+    g_main_loop_unref (test_data.m_loop);
+
+    test_assert (test_data.result == true, "Registering a taken port did not fail");
+
+    /* the failed registration must have left the port to its owner */
+    bool exists = false;
+    std::string self = toString (getpid ());
+    test_assert (messageport_check_remote_port (self.c_str (), TEST_CHILD_TAKEN_PORT, &exists) == MESSAGEPORT_ERROR_NONE && exists,
+                 "Port got unregistered under its owner");
+
+    return true;
+}
+#endif // HAVE_CXX20
+
 static gboolean
 _on_term (gpointer userdata)
 {
@@ -493,7 +666,7 @@ test_setup ()
     GError *error = NULL;
 
     argv[0] = const_cast<gchar*>("dbus-daemon");
-    argv[1] = const_cast<gchar*>("--config-file="TEST_DBUS_DAEMON_CONF_FILE);
+    argv[1] = const_cast<gchar*>("--config-file=" TEST_DBUS_DAEMON_CONF_FILE);
     argv[2] = const_cast<gchar*>("--print-address=<<fd>>");
     argv[3] = NULL;
 
@@ -569,6 +742,7 @@ int main (int argc, const char *argv[])
         TEST_CASE (test_register_trusted_local_port);
         TEST_CASE(test_get_local_port_name);
         TEST_CASE(test_check_trusted_local_port); 
+        TEST_CASE(test_register_binding_ports);
 
         g_unix_signal_add (SIGTERM, _on_term, m_loop);
 
@@ -584,6 +758,11 @@ int main (int argc, const char *argv[])
         TEST_CASE(test_send_bidirectional_message);
         TEST_CASE(test_send_trusted_message);
         TEST_CASE(test_send_bidirectional_trusted_message);
+        TEST_CASE(test_send_with_binding);
+#ifdef HAVE_CXX20
+        TEST_CASE(test_send_with_coroutine);
+        TEST_CASE(test_register_taken_port_with_coroutine);
+#endif
 
         kill (getppid(), SIGTERM);
     }